@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <ytalloc/ytalloc.h>
+
+// Page allocation from one buddy heap shared by all threads: straight through
+// the heap lock, and through a per-thread cache in front of it. Every
+// iteration allocates a batch of order-0 and order-1 blocks and frees them.
+
+namespace {
+
+constexpr size_t heap_size = 4096 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+constexpr size_t batch = 8;
+constexpr size_t max_threads = 8;
+
+uint8_t *g_storage;
+uintptr_t g_free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+uint8_t g_bitmap[heap_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+alloc_buddy_t g_heap;
+alloc_spinlock_t g_spin;
+alloc_lock_t g_lock;
+
+void setup(const benchmark::State &) {
+    g_storage = new (std::align_val_t(heap_size)) uint8_t[heap_size];
+    alloc_buddy_init(&g_heap, g_storage, heap_size, g_free_heads,
+                     sizeof(g_free_heads), g_bitmap, sizeof(g_bitmap));
+    alloc_lock_spin(&g_lock, &g_spin);
+    alloc_buddy_set_lock(&g_heap, &g_lock);
+}
+
+void teardown(const benchmark::State &) {
+    operator delete[](g_storage, std::align_val_t(heap_size));
+}
+
+size_t block_size(size_t idx) {
+    return YTALLOC_BUDDY_MIN_BLOCK_SIZE << (idx % 2);
+}
+
+} // namespace
+
+static void BM_Locked(benchmark::State &state) {
+    void *ptrs[batch];
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < batch; idx++) {
+            ptrs[idx] = alloc_buddy_locked(&g_heap, block_size(idx));
+        }
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t idx = 0; idx < batch; idx++) {
+            alloc_buddy_free_locked(&g_heap, ptrs[idx], block_size(idx));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+static void BM_Cached(benchmark::State &state) {
+    alloc_buddy_cache_t cache;
+    alloc_buddy_cache_init(&cache, &g_heap, 16, 48);
+
+    void *ptrs[batch];
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < batch; idx++) {
+            ptrs[idx] = alloc_buddy_cache(&cache, block_size(idx));
+        }
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t idx = 0; idx < batch; idx++) {
+            alloc_buddy_cache_free(&cache, ptrs[idx], block_size(idx));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+
+    alloc_buddy_cache_flush(&cache);
+}
+
+BENCHMARK(BM_Locked)
+    ->Setup(setup)
+    ->Teardown(teardown)
+    ->ThreadRange(1, max_threads);
+BENCHMARK(BM_Cached)
+    ->Setup(setup)
+    ->Teardown(teardown)
+    ->ThreadRange(1, max_threads);
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <sys/mman.h>
+#include <ytalloc/ytalloc.h>
+
+// Clears a large buffer carved out of a fresh mapping, once with a plain
+// memset() and once through the zero-aware calloc of each heap. The mapping is
+// made anew for every iteration, so the page faults are part of the cost.
+
+namespace {
+
+constexpr size_t map_size = 16 * 1024 * 1024;
+constexpr size_t buf_size = map_size / 2;
+
+uint8_t *map_fresh() {
+    void *const map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return map == MAP_FAILED ? nullptr : static_cast<uint8_t *>(map);
+}
+
+} // namespace
+
+static void BM_StaticMemset(benchmark::State &state) {
+    for (auto _ : state) {
+        uint8_t *const map = map_fresh();
+        alloc_static_t heap;
+        alloc_static_init(&heap, map, map_size);
+        void *const ptr = alloc_static(&heap, buf_size);
+        std::memset(ptr, 0, buf_size);
+        benchmark::DoNotOptimize(ptr);
+        munmap(map, map_size);
+    }
+}
+
+static void BM_StaticCalloc(benchmark::State &state) {
+    for (auto _ : state) {
+        uint8_t *const map = map_fresh();
+        alloc_static_t heap;
+        alloc_static_init(&heap, map, map_size);
+        alloc_static_set_zeroed(&heap);
+        void *const ptr = alloc_static_calloc(&heap, 1, buf_size);
+        benchmark::DoNotOptimize(ptr);
+        munmap(map, map_size);
+    }
+}
+
+static void BM_BuddyCalloc(benchmark::State &state) {
+    constexpr size_t num_blocks = map_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    static uint8_t bitmap[num_blocks / 8];
+    static uint8_t zero_map[num_blocks / 8];
+
+    for (auto _ : state) {
+        uint8_t *const map = map_fresh();
+        alloc_buddy_t heap;
+        alloc_buddy_init(&heap, map, map_size, free_heads, sizeof(free_heads),
+                         bitmap, sizeof(bitmap));
+        if (state.range(0)) {
+            alloc_buddy_set_zeroed(&heap, zero_map, sizeof(zero_map));
+        }
+        void *const ptr = alloc_buddy_calloc(&heap, 1, buf_size);
+        benchmark::DoNotOptimize(ptr);
+        munmap(map, map_size);
+    }
+}
+
+BENCHMARK(BM_StaticMemset);
+BENCHMARK(BM_StaticCalloc);
+BENCHMARK(BM_BuddyCalloc)->ArgName("zero_map")->Arg(0)->Arg(1);
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <new>
+#include <random>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+// Compares references made of 32-bit handles with raw pointers. Every
+// iteration follows all references in a random order and reads the objects.
+// The ref_bytes counter reports the memory taken by the references.
+
+namespace {
+
+constexpr size_t alloc_size = 32;
+constexpr size_t num_items = 1 << 16;
+
+struct Object {
+    uint64_t value;
+    uint8_t payload[alloc_size - sizeof(uint64_t)];
+};
+
+static_assert(sizeof(Object) == alloc_size);
+
+class HandleFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &) override {
+        storage = new (std::align_val_t(alloc_size)) uint8_t[storage_size];
+        meta.resize(alloc_handle_pool_meta_size(num_items) / sizeof(uint32_t));
+        alloc_handle_pool_init(&pool, storage, storage_size, alloc_size,
+                               meta.data(), meta.size() * sizeof(uint32_t));
+
+        for (size_t idx = 0; idx < num_items; idx++) {
+            void *ptr;
+            handles.push_back(alloc_handle(&pool, &ptr));
+            pointers.push_back(static_cast<Object *>(ptr));
+            pointers.back()->value = idx;
+        }
+
+        std::minstd_rand rng;
+        std::vector<size_t> order(num_items);
+        for (size_t idx = 0; idx < num_items; idx++) {
+            order[idx] = idx;
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+        for (size_t idx = 0; idx < num_items; idx++) {
+            std::swap(handles[idx], handles[order[idx]]);
+            std::swap(pointers[idx], pointers[order[idx]]);
+        }
+    }
+
+    void TearDown(const benchmark::State &) override {
+        operator delete[](storage, std::align_val_t(alloc_size));
+        handles.clear();
+        pointers.clear();
+    }
+
+    static constexpr size_t storage_size = num_items * alloc_size;
+
+    alloc_handle_pool_t pool;
+    uint8_t *storage;
+    std::vector<uint32_t> meta;
+
+    std::vector<alloc_handle_t> handles;
+    std::vector<Object *> pointers;
+};
+
+} // namespace
+
+BENCHMARK_DEFINE_F(HandleFixture, RawPointers)(benchmark::State &state) {
+    uint64_t sum = 0;
+    for (auto _ : state) {
+        for (Object *obj : pointers) {
+            sum += obj->value;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * num_items);
+    state.counters["ref_bytes"] = sizeof(Object *) * pointers.size();
+}
+
+BENCHMARK_DEFINE_F(HandleFixture, Handles)(benchmark::State &state) {
+    uint64_t sum = 0;
+    for (auto _ : state) {
+        for (alloc_handle_t handle : handles) {
+            void *const ptr = alloc_handle_get(&pool, handle);
+            sum += static_cast<Object *>(ptr)->value;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * num_items);
+    state.counters["ref_bytes"] = sizeof(alloc_handle_t) * handles.size();
+}
+
+BENCHMARK_DEFINE_F(HandleFixture, DenseIteration)(benchmark::State &state) {
+    uint64_t sum = 0;
+    for (auto _ : state) {
+        const size_t num_live = alloc_handle_num_live(&pool);
+        for (size_t pos = 0; pos < num_live; pos++) {
+            void *const ptr = alloc_handle_live_at(&pool, pos, nullptr);
+            sum += static_cast<Object *>(ptr)->value;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK_REGISTER_F(HandleFixture, RawPointers);
+BENCHMARK_REGISTER_F(HandleFixture, Handles);
+BENCHMARK_REGISTER_F(HandleFixture, DenseIteration);
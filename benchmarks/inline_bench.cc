@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <ytalloc/inline.h>
+
+// Out-of-line calls into libytalloc.a against the fast paths of inline.h. Build
+// with -DYTALLOC_LTO=ON to let the linker inline the out-of-line ones too.
+
+namespace {
+
+constexpr size_t alloc_size = 64;
+constexpr size_t num_items = 1024;
+constexpr size_t heap_size = num_items * alloc_size;
+
+class InlineFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &) override {
+        storage = new (std::align_val_t(alloc_size)) uint8_t[heap_size];
+        alloc_slab_init(&slab, storage, heap_size, alloc_size);
+        alloc_static_init(&bump, storage, heap_size);
+
+        // Touch every item once, so that the inline path does not fall back
+        // to alloc_slab() for never allocated items.
+        for (size_t idx = 0; idx < num_items; idx++) {
+            ptrs[idx] = alloc_slab(&slab);
+        }
+        alloc_slab_free_bulk(&slab, ptrs, num_items);
+    }
+
+    void TearDown(const benchmark::State &) override {
+        operator delete[](storage, std::align_val_t(alloc_size));
+    }
+
+    uint8_t *storage;
+    alloc_slab_t slab;
+    alloc_static_t bump;
+    void *ptrs[num_items];
+};
+
+} // namespace
+
+BENCHMARK_DEFINE_F(InlineFixture, SlabCall)(benchmark::State &state) {
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < num_items; idx++) {
+            ptrs[idx] = alloc_slab(&slab);
+        }
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t idx = 0; idx < num_items; idx++) {
+            alloc_slab_free(&slab, ptrs[idx]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK_DEFINE_F(InlineFixture, SlabInline)(benchmark::State &state) {
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < num_items; idx++) {
+            ptrs[idx] = alloc_slab_inline(&slab);
+        }
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t idx = 0; idx < num_items; idx++) {
+            alloc_slab_free_inline(&slab, ptrs[idx]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK_DEFINE_F(InlineFixture, StaticCall)(benchmark::State &state) {
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < num_items; idx++) {
+            ptrs[idx] = alloc_static(&bump, alloc_size);
+        }
+        benchmark::DoNotOptimize(ptrs);
+        alloc_static_reset(&bump);
+    }
+    state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK_DEFINE_F(InlineFixture, StaticInline)(benchmark::State &state) {
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < num_items; idx++) {
+            ptrs[idx] = alloc_static_inline(&bump, alloc_size);
+        }
+        benchmark::DoNotOptimize(ptrs);
+        alloc_static_reset(&bump);
+    }
+    state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK_REGISTER_F(InlineFixture, SlabCall);
+BENCHMARK_REGISTER_F(InlineFixture, SlabInline);
+BENCHMARK_REGISTER_F(InlineFixture, StaticCall);
+BENCHMARK_REGISTER_F(InlineFixture, StaticInline);
@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <pthread.h>
+#include <ytalloc/ytalloc.h>
+
+// Contention on one slab heap shared by all threads: every iteration takes a
+// batch of items and gives it back, through the spinlock and the pthread mutex
+// hooks. The PerObject variants take the lock once per item, the Bulk ones
+// once per batch.
+
+namespace {
+
+constexpr size_t alloc_size = 64;
+constexpr size_t batch = 16;
+constexpr size_t max_threads = 8;
+constexpr size_t num_items = 4 * max_threads * batch;
+constexpr size_t heap_size = num_items * alloc_size;
+
+uint8_t *g_storage;
+alloc_slab_t g_heap;
+alloc_spinlock_t g_spin;
+pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+alloc_lock_t g_lock;
+
+void setup(bool spin) {
+    g_storage = new (std::align_val_t(alloc_size)) uint8_t[heap_size];
+    alloc_slab_init(&g_heap, g_storage, heap_size, alloc_size);
+    if (spin) {
+        alloc_lock_spin(&g_lock, &g_spin);
+    } else {
+        alloc_lock_pthread(&g_lock, &g_mutex);
+    }
+    alloc_slab_set_lock(&g_heap, &g_lock);
+}
+
+void setup_spin(const benchmark::State &) {
+    setup(true);
+}
+
+void setup_mutex(const benchmark::State &) {
+    setup(false);
+}
+
+void teardown(const benchmark::State &) {
+    operator delete[](g_storage, std::align_val_t(alloc_size));
+}
+
+} // namespace
+
+static void BM_PerObject(benchmark::State &state) {
+    void *ptrs[batch];
+    for (auto _ : state) {
+        for (void *&ptr : ptrs) {
+            ptr = alloc_slab_locked(&g_heap);
+        }
+        benchmark::DoNotOptimize(ptrs);
+        for (void *ptr : ptrs) {
+            alloc_slab_free_locked(&g_heap, ptr);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+static void BM_Bulk(benchmark::State &state) {
+    void *ptrs[batch];
+    for (auto _ : state) {
+        const size_t num_got = alloc_slab_bulk_locked(&g_heap, ptrs, batch);
+        benchmark::DoNotOptimize(ptrs);
+        alloc_slab_free_bulk_locked(&g_heap, ptrs, num_got);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK(BM_PerObject)
+    ->Name("Spin/PerObject")
+    ->Setup(setup_spin)
+    ->Teardown(teardown)
+    ->ThreadRange(1, max_threads);
+BENCHMARK(BM_Bulk)
+    ->Name("Spin/Bulk")
+    ->Setup(setup_spin)
+    ->Teardown(teardown)
+    ->ThreadRange(1, max_threads);
+BENCHMARK(BM_PerObject)
+    ->Name("Mutex/PerObject")
+    ->Setup(setup_mutex)
+    ->Teardown(teardown)
+    ->ThreadRange(1, max_threads);
+BENCHMARK(BM_Bulk)
+    ->Name("Mutex/Bulk")
+    ->Setup(setup_mutex)
+    ->Teardown(teardown)
+    ->ThreadRange(1, max_threads);
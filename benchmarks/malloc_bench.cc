@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Allocation-heavy workloads through plain malloc() and free(). This file is
+// built twice: malloc_bench runs them on the C library allocator and
+// malloc_bench_ytalloc is linked with libytalloc_malloc.so, the same as running
+// a program with LD_PRELOAD.
+
+namespace {
+
+constexpr size_t num_slots = 4096;
+constexpr size_t batch = 256;
+
+// Replaces random blocks of a live set with new ones, with sizes drawn from a
+// geometric distribution of the given mean, capped at `max_size`.
+void churn(benchmark::State &state, size_t mean_size, size_t max_size) {
+    std::mt19937 rng(state.thread_index());
+    std::uniform_int_distribution<size_t> slot_dist(0, num_slots - 1);
+    std::geometric_distribution<size_t> size_dist(1.0 / mean_size);
+
+    std::vector<void *> slots(num_slots);
+    std::vector<size_t> sizes(batch);
+    std::vector<size_t> picks(batch);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t idx = 0; idx < batch; idx++) {
+            sizes[idx] = std::min(size_dist(rng) + 1, max_size);
+            picks[idx] = slot_dist(rng);
+        }
+        state.ResumeTiming();
+
+        for (size_t idx = 0; idx < batch; idx++) {
+            void *&slot = slots[picks[idx]];
+            free(slot);
+            slot = malloc(sizes[idx]);
+            benchmark::DoNotOptimize(slot);
+        }
+    }
+
+    for (void *slot : slots) {
+        free(slot);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+} // namespace
+
+static void BM_ChurnSmall(benchmark::State &state) {
+    churn(state, 64, 1024);
+}
+
+static void BM_ChurnMixed(benchmark::State &state) {
+    churn(state, 2048, 256 * 1024);
+}
+
+// Builds and tears down a map of strings to vectors, the pattern of most
+// object-heavy C++ code.
+static void BM_Containers(benchmark::State &state) {
+    for (auto _ : state) {
+        std::map<std::string, std::vector<int>> map;
+        for (int idx = 0; idx < 1000; idx++) {
+            map[std::to_string(idx * 7919) + " padding past SSO"].assign(
+                idx % 40, idx);
+        }
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+}
+
+BENCHMARK(BM_ChurnSmall)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_ChurnMixed)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_Containers)->ThreadRange(1, 4)->UseRealTime();
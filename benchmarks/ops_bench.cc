@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+// Replays one allocation trace on every engine through alloc_ops_t. The trace
+// keeps up to max_live blocks of 16 to 1024 bytes alive and frees them in
+// random order.
+
+namespace {
+
+constexpr size_t heap_size = 4 * 1024 * 1024;
+constexpr size_t max_size = 1024;
+constexpr size_t max_live = 512;
+constexpr size_t num_events = 16384;
+
+struct Event {
+    bool is_alloc;
+    uint32_t slot;
+    uint32_t size;
+};
+
+std::vector<Event> make_trace() {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> size_dist(16, max_size);
+    std::vector<uint32_t> live;
+    std::vector<uint32_t> sizes(max_live);
+    std::vector<uint32_t> free_slots;
+    for (uint32_t slot = 0; slot < max_live; slot++) {
+        free_slots.push_back(slot);
+    }
+
+    std::vector<Event> trace;
+    while (trace.size() < num_events) {
+        const bool do_alloc =
+            !free_slots.empty() && (live.empty() || rng() % 2 == 0);
+        if (do_alloc) {
+            const uint32_t slot = free_slots.back();
+            free_slots.pop_back();
+            sizes[slot] = size_dist(rng);
+            live.push_back(slot);
+            trace.push_back({true, slot, sizes[slot]});
+        } else {
+            const size_t pos = rng() % live.size();
+            const uint32_t slot = live[pos];
+            live[pos] = live.back();
+            live.pop_back();
+            free_slots.push_back(slot);
+            trace.push_back({false, slot, sizes[slot]});
+        }
+    }
+    return trace;
+}
+
+const std::vector<Event> g_trace = make_trace();
+
+} // namespace
+
+static void BM_Replay(benchmark::State &state, const char *name) {
+    uint8_t *const storage =
+        new (std::align_val_t(heap_size)) uint8_t[heap_size];
+    std::vector<uintptr_t> free_heads(YTALLOC_BUDDY_MAX_ORDERS);
+    std::vector<uint8_t> bitmap(heap_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8);
+    alloc_list_t list;
+    alloc_static_t bump;
+    alloc_buddy_t buddy;
+    alloc_slab_t slab;
+
+    void *heap;
+    if (std::string(name) == "list") {
+        alloc_list_init(&list, storage, heap_size);
+        heap = &list;
+    } else if (std::string(name) == "static") {
+        alloc_static_init(&bump, storage, heap_size);
+        heap = &bump;
+    } else if (std::string(name) == "buddy") {
+        alloc_buddy_init(&buddy, storage, heap_size, free_heads.data(),
+                         free_heads.size() * sizeof(uintptr_t), bitmap.data(),
+                         bitmap.size());
+        heap = &buddy;
+    } else {
+        alloc_slab_init(&slab, storage, heap_size, max_size);
+        heap = &slab;
+    }
+
+    const alloc_ops_t *const ops = alloc_ops_find(name);
+    std::vector<void *> ptrs(max_live);
+    size_t num_failed = 0;
+    for (auto _ : state) {
+        for (const Event &event : g_trace) {
+            if (event.is_alloc) {
+                ptrs[event.slot] = ops->alloc(heap, event.size);
+                num_failed += ptrs[event.slot] == nullptr;
+            } else {
+                ops->free(heap, ptrs[event.slot], event.size);
+            }
+        }
+        ops->reset(heap);
+    }
+    state.SetItemsProcessed(state.iterations() * g_trace.size());
+    state.counters["failed"] = benchmark::Counter(
+        num_failed, benchmark::Counter::kAvgIterations);
+
+    operator delete[](storage, std::align_val_t(heap_size));
+}
+
+BENCHMARK_CAPTURE(BM_Replay, list, "list");
+BENCHMARK_CAPTURE(BM_Replay, static, "static");
+BENCHMARK_CAPTURE(BM_Replay, buddy, "buddy");
+BENCHMARK_CAPTURE(BM_Replay, slab, "slab");
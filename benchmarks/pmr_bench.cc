@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+#include <memory_resource>
+#include <new>
+#include <unordered_map>
+#include <vector>
+#include <ytalloc/pmr.h>
+
+namespace {
+
+constexpr size_t heap_size = 4 * 1024 * 1024;
+constexpr int num_keys = 4096;
+
+// Node size of std::pmr::unordered_map<int, int> in libstdc++ and libc++.
+constexpr size_t node_size = 32;
+
+template <class Resource>
+void fill_vectors(benchmark::State &state, std::pmr::memory_resource &res) {
+    const int num_items = state.range(0);
+    for (auto _ : state) {
+        std::pmr::vector<std::pmr::vector<int>> outer(&res);
+        for (int idx = 0; idx < 64; idx++) {
+            std::pmr::vector<int> &inner = outer.emplace_back();
+            for (int item = 0; item < num_items; item++) {
+                inner.push_back(item);
+            }
+        }
+        benchmark::DoNotOptimize(outer.data());
+        if constexpr (std::is_same_v<Resource, ytalloc::static_resource>) {
+            outer.clear();
+            static_cast<Resource &>(res).release();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 64 * num_items);
+}
+
+void fill_map(benchmark::State &state, std::pmr::memory_resource &res) {
+    for (auto _ : state) {
+        std::pmr::unordered_map<int, int> map(&res);
+        for (int key = 0; key < num_keys; key++) {
+            map.emplace(key, key);
+        }
+        for (int key = 0; key < num_keys; key += 2) {
+            map.erase(key);
+        }
+        for (int key = 0; key < num_keys; key += 2) {
+            map.emplace(key, key);
+        }
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * num_keys);
+}
+
+class PmrFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &) override {
+        storage = new (std::align_val_t(heap_size)) uint8_t[heap_size];
+    }
+
+    void TearDown(const benchmark::State &) override {
+        operator delete[](storage, std::align_val_t(heap_size));
+    }
+
+    uint8_t *storage;
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[heap_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+};
+
+} // namespace
+
+BENCHMARK_DEFINE_F(PmrFixture, VectorPool)(benchmark::State &state) {
+    std::pmr::unsynchronized_pool_resource res;
+    fill_vectors<void>(state, res);
+}
+
+BENCHMARK_DEFINE_F(PmrFixture, VectorList)(benchmark::State &state) {
+    alloc_list_t heap;
+    alloc_list_init(&heap, storage, heap_size);
+    ytalloc::list_resource res(&heap);
+    fill_vectors<void>(state, res);
+}
+
+BENCHMARK_DEFINE_F(PmrFixture, VectorBuddy)(benchmark::State &state) {
+    alloc_buddy_t heap;
+    alloc_buddy_init(&heap, storage, heap_size, free_heads,
+                     sizeof(free_heads), bitmap, sizeof(bitmap));
+    ytalloc::buddy_resource res(&heap);
+    fill_vectors<void>(state, res);
+}
+
+BENCHMARK_DEFINE_F(PmrFixture, VectorStatic)(benchmark::State &state) {
+    alloc_static_t heap;
+    alloc_static_init(&heap, storage, heap_size);
+    ytalloc::static_resource res(&heap);
+    fill_vectors<ytalloc::static_resource>(state, res);
+}
+
+BENCHMARK_DEFINE_F(PmrFixture, MapPool)(benchmark::State &state) {
+    std::pmr::unsynchronized_pool_resource res;
+    fill_map(state, res);
+}
+
+BENCHMARK_DEFINE_F(PmrFixture, MapList)(benchmark::State &state) {
+    alloc_list_t heap;
+    alloc_list_init(&heap, storage, heap_size);
+    ytalloc::list_resource res(&heap);
+    fill_map(state, res);
+}
+
+BENCHMARK_DEFINE_F(PmrFixture, MapSlab)(benchmark::State &state) {
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, storage, heap_size, node_size);
+    std::pmr::unsynchronized_pool_resource buckets;
+    ytalloc::slab_resource res(&heap, &buckets);
+    fill_map(state, res);
+}
+
+BENCHMARK_REGISTER_F(PmrFixture, VectorPool)->Arg(16)->Arg(1024);
+BENCHMARK_REGISTER_F(PmrFixture, VectorList)->Arg(16)->Arg(1024);
+BENCHMARK_REGISTER_F(PmrFixture, VectorBuddy)->Arg(16)->Arg(1024);
+BENCHMARK_REGISTER_F(PmrFixture, VectorStatic)->Arg(16)->Arg(1024);
+BENCHMARK_REGISTER_F(PmrFixture, MapPool);
+BENCHMARK_REGISTER_F(PmrFixture, MapList);
+BENCHMARK_REGISTER_F(PmrFixture, MapSlab);
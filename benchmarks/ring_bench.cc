@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <random>
+#include <ytalloc/ytalloc.h>
+
+namespace {
+
+constexpr size_t heap_size = 1 << 20;
+constexpr size_t window = 1024;
+constexpr size_t num_sizes = 4096;
+
+/*
+ * Streaming workload: a queue of `window` messages of random size, where each
+ * iteration allocates a new message and frees the oldest one.
+ */
+template <typename Heap> class StreamFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &) override {
+        storage = new (std::align_val_t(64)) uint8_t[heap_size];
+        init();
+
+        std::minstd_rand rng;
+        std::uniform_int_distribution<size_t> size_dist(16, 512);
+        for (size_t &size : sizes) {
+            size = size_dist(rng);
+        }
+        for (size_t idx = 0; idx < window; idx++) {
+            queue[idx] = alloc(sizes[idx % num_sizes]);
+        }
+        head = 0;
+    }
+
+    void TearDown(const benchmark::State &) override {
+        operator delete[](storage, std::align_val_t(64));
+    }
+
+    void run(benchmark::State &state) {
+        size_t round = 0;
+        for (auto _ : state) {
+            free(queue[head]);
+            void *const ptr = alloc(sizes[round++ % num_sizes]);
+            // Touch the message like a producer would.
+            *(volatile uint64_t *)ptr = round;
+            queue[head] = ptr;
+            head = (head + 1) % window;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+  protected:
+    void init();
+    void *alloc(size_t size);
+    void free(void *ptr);
+
+    Heap heap;
+    uint8_t *storage;
+    size_t sizes[num_sizes];
+    void *queue[window];
+    size_t head;
+};
+
+template <> void StreamFixture<alloc_list_t>::init() {
+    alloc_list_init(&heap, storage, heap_size);
+}
+template <> void *StreamFixture<alloc_list_t>::alloc(size_t size) {
+    return alloc_list(&heap, size);
+}
+template <> void StreamFixture<alloc_list_t>::free(void *ptr) {
+    alloc_list_free(&heap, ptr);
+}
+
+template <> void StreamFixture<alloc_ring_t>::init() {
+    alloc_ring_init(&heap, storage, heap_size);
+}
+template <> void *StreamFixture<alloc_ring_t>::alloc(size_t size) {
+    return alloc_ring(&heap, size);
+}
+template <> void StreamFixture<alloc_ring_t>::free(void *ptr) {
+    alloc_ring_free(&heap, ptr);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE_DEFINE_F(StreamFixture, List, alloc_list_t)
+(benchmark::State &state) {
+    run(state);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(StreamFixture, Ring, alloc_ring_t)
+(benchmark::State &state) {
+    run(state);
+}
+
+BENCHMARK_REGISTER_F(StreamFixture, List);
+BENCHMARK_REGISTER_F(StreamFixture, Ring);
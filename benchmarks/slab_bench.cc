@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <ytalloc/ytalloc.h>
+
+namespace {
+
+constexpr size_t alloc_size = 64;
+constexpr size_t num_items = 4096;
+
+class SlabFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &) override {
+        storage = new (std::align_val_t(alloc_size)) uint8_t[heap_size];
+        alloc_slab_init(&heap, storage, heap_size, alloc_size);
+    }
+
+    void TearDown(const benchmark::State &) override {
+        operator delete[](storage, std::align_val_t(alloc_size));
+    }
+
+    static constexpr size_t heap_size = num_items * alloc_size;
+
+    alloc_slab_t heap;
+    uint8_t *storage;
+    void *ptrs[num_items];
+};
+
+} // namespace
+
+BENCHMARK_DEFINE_F(SlabFixture, PerObject)(benchmark::State &state) {
+    const size_t batch = state.range(0);
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < batch; idx++) {
+            ptrs[idx] = alloc_slab(&heap);
+        }
+        benchmark::DoNotOptimize(ptrs);
+        for (size_t idx = 0; idx < batch; idx++) {
+            alloc_slab_free(&heap, ptrs[idx]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK_DEFINE_F(SlabFixture, Bulk)(benchmark::State &state) {
+    const size_t batch = state.range(0);
+    for (auto _ : state) {
+        const size_t num_got = alloc_slab_bulk(&heap, ptrs, batch);
+        benchmark::DoNotOptimize(ptrs);
+        alloc_slab_free_bulk(&heap, ptrs, num_got);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK_REGISTER_F(SlabFixture, PerObject)
+    ->RangeMultiplier(2)
+    ->Range(32, 256);
+BENCHMARK_REGISTER_F(SlabFixture, Bulk)->RangeMultiplier(2)->Range(32, 256);
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include <new>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+// Walks the N-th object of every slab before moving to object N+1. Without
+// colouring the N-th objects of page-aligned slabs share their cache sets and
+// evict each other. Each heap gives up one item to leave room for the colour
+// offsets. Run with --benchmark_perf_counters=L1-DCACHE-LOAD-MISSES
+// (requires libpfm support in Google Benchmark) to see the miss counts.
+
+namespace {
+
+constexpr size_t slab_size = 4096;
+constexpr size_t alloc_size = 256;
+constexpr size_t heap_size = slab_size - YTALLOC_SLAB_COLOUR_ALIGN;
+constexpr size_t num_slabs = 256;
+constexpr size_t items_per_slab = heap_size / alloc_size;
+
+class ColourFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &state) override {
+        storage = new (std::align_val_t(slab_size)) uint8_t[storage_size];
+
+        size_t cursor = 0;
+        alloc_slab_opts_t opts = {};
+        opts.colour_cursor = state.range(0) ? &cursor : nullptr;
+
+        heaps.resize(num_slabs);
+        objects.assign(items_per_slab, std::vector<uint64_t *>());
+        for (size_t slab = 0; slab < num_slabs; slab++) {
+            alloc_slab_init_opts(&heaps[slab], storage + slab * slab_size,
+                                 heap_size, alloc_size, &opts);
+            for (size_t idx = 0; idx < items_per_slab; idx++) {
+                void *const ptr = alloc_slab(&heaps[slab]);
+                objects[idx].push_back(static_cast<uint64_t *>(ptr));
+                *objects[idx].back() = idx;
+            }
+        }
+    }
+
+    void TearDown(const benchmark::State &) override {
+        operator delete[](storage, std::align_val_t(slab_size));
+    }
+
+    static constexpr size_t storage_size = num_slabs * slab_size;
+
+    uint8_t *storage;
+    std::vector<alloc_slab_t> heaps;
+    std::vector<std::vector<uint64_t *>> objects;
+};
+
+} // namespace
+
+BENCHMARK_DEFINE_F(ColourFixture, CrossSlabTraversal)
+(benchmark::State &state) {
+    uint64_t sum = 0;
+    for (auto _ : state) {
+        for (size_t idx = 0; idx < items_per_slab; idx++) {
+            for (size_t rep = 0; rep < 4; rep++) {
+                for (uint64_t *obj : objects[idx]) {
+                    sum += *obj;
+                }
+            }
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * items_per_slab * 4 *
+                            num_slabs);
+}
+
+BENCHMARK_REGISTER_F(ColourFixture, CrossSlabTraversal)
+    ->ArgName("colour")
+    ->Arg(0)
+    ->Arg(1);
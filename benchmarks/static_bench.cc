@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <new>
+#include <ytalloc/ytalloc.h>
+
+// Scaling of bump allocation shared between threads: a mutex around
+// alloc_static(), a shared atomic heap, and per-thread leases from it. Every
+// thread performs a fixed number of allocations, so the heap never runs out.
+
+namespace {
+
+constexpr size_t alloc_size = 32;
+constexpr size_t num_iters = 1 << 18;
+constexpr size_t max_threads = 8;
+constexpr size_t lease_size = 64 * 1024;
+constexpr size_t heap_size =
+    max_threads * (num_iters * alloc_size + 2 * lease_size);
+
+uint8_t *g_storage;
+alloc_static_t g_heap;
+alloc_static_atomic_t g_shared;
+std::mutex g_mutex;
+
+void setup(const benchmark::State &) {
+    g_storage = new (std::align_val_t(64)) uint8_t[heap_size];
+    alloc_static_init(&g_heap, g_storage, heap_size);
+    alloc_static_atomic_init(&g_shared, g_storage, heap_size);
+}
+
+void teardown(const benchmark::State &) {
+    operator delete[](g_storage, std::align_val_t(64));
+}
+
+} // namespace
+
+static void BM_MutexStatic(benchmark::State &state) {
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> guard(g_mutex);
+        benchmark::DoNotOptimize(alloc_static(&g_heap, alloc_size));
+    }
+}
+
+static void BM_AtomicStatic(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(alloc_static_atomic(&g_shared, alloc_size));
+    }
+}
+
+static void BM_LeasedStatic(benchmark::State &state) {
+    alloc_static_t local = {};
+    for (auto _ : state) {
+        void *const ptr = alloc_static_atomic_local(&g_shared, &local,
+                                                    alloc_size, lease_size);
+        benchmark::DoNotOptimize(ptr);
+    }
+}
+
+BENCHMARK(BM_MutexStatic)
+    ->Setup(setup)
+    ->Teardown(teardown)
+    ->Iterations(num_iters)
+    ->ThreadRange(1, max_threads);
+BENCHMARK(BM_AtomicStatic)
+    ->Setup(setup)
+    ->Teardown(teardown)
+    ->Iterations(num_iters)
+    ->ThreadRange(1, max_threads);
+BENCHMARK(BM_LeasedStatic)
+    ->Setup(setup)
+    ->Teardown(teardown)
+    ->Iterations(num_iters)
+    ->ThreadRange(1, max_threads);
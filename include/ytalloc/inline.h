@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * @file inline.h
+ * Inline fast paths for the slab and static heaps.
+ *
+ * Each function handles the common case in place and calls its out-of-line
+ * counterpart from ytalloc.h for everything else, so the two can be mixed
+ * freely on one heap. The fast paths skip the debug-build ownership checks of
+ * the out-of-line functions and are not counted by #alloc_stats_get().
+ */
+
+#include <ytalloc/ytalloc.h>
+
+/**
+ * Same as #alloc_slab().
+ *
+ * An empty free list, which includes carving the never allocated items, and
+ * frees from other threads waiting to be drained are left to #alloc_slab().
+ */
+static inline void *alloc_slab_inline(alloc_slab_t *heap) {
+    uintptr_t *const item = heap->free_head;
+    if (__builtin_expect(item == NULL ||
+                             __atomic_load_n(&heap->remote,
+                                             __ATOMIC_RELAXED) != 0,
+                         0)) {
+        return alloc_slab(heap);
+    }
+
+    heap->free_head = (uintptr_t *)*(uintptr_t *)((uintptr_t)item +
+                                                  heap->link_offset);
+    heap->num_used++;
+    return item;
+}
+
+/**
+ * Same as #alloc_slab_free().
+ */
+static inline void alloc_slab_free_inline(alloc_slab_t *heap, void *ptr) {
+    if (__builtin_expect(ptr == NULL || heap->num_used == 0, 0)) {
+        alloc_slab_free(heap, ptr);
+        return;
+    }
+
+    *(uintptr_t *)((uintptr_t)ptr + heap->link_offset) =
+        (uintptr_t)heap->free_head;
+    heap->free_head = (uintptr_t *)ptr;
+    heap->num_used--;
+}
+
+/**
+ * Same as #alloc_static(). Empty requests and requests that do not fit are left
+ * to #alloc_static().
+ */
+static inline void *alloc_static_inline(alloc_static_t *heap, size_t size) {
+    const uintptr_t ptr = (heap->next + (YTALLOC_STATIC_ALIGN - 1)) &
+                          ~(uintptr_t)(YTALLOC_STATIC_ALIGN - 1);
+    if (__builtin_expect(size == 0 || ptr < heap->next || ptr > heap->end ||
+                             size > heap->end - ptr,
+                         0)) {
+        return alloc_static(heap, size);
+    }
+
+    heap->next = ptr + size;
+    heap->last = ptr;
+    return (void *)ptr;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+/**
+ * @file object_pool.h
+ * Typed object pool over a slab heap (C++17).
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+namespace ytalloc {
+
+/**
+ * Pool of objects of type @a T in a caller-provided region.
+ *
+ * The item size and alignment of the underlying `alloc_slab_t` are derived from
+ * `sizeof(T)` and `alignof(T)` at compile time. Allocation and deallocation pop
+ * and push the slab free list inline; the library is only called to initialize
+ * and clear the pool and to drain frees made by other threads with
+ * #alloc_slab_free_remote().
+ *
+ * The pool is not thread-safe and cannot be copied or moved, because handles
+ * point to it.
+ */
+template <class T> class ObjectPool {
+  public:
+    static constexpr std::size_t item_align =
+        alignof(T) > alignof(std::uintptr_t) ? alignof(T)
+                                             : alignof(std::uintptr_t);
+    static constexpr std::size_t item_size =
+        ((sizeof(T) > sizeof(std::uintptr_t) ? sizeof(T)
+                                             : sizeof(std::uintptr_t)) +
+         item_align - 1) &
+        ~(item_align - 1);
+
+    /// Destroys an object and returns its item to the pool.
+    class Deleter {
+      public:
+        Deleter() noexcept = default;
+        explicit Deleter(ObjectPool *pool) noexcept : m_pool(pool) {}
+
+        void operator()(T *obj) const noexcept {
+            m_pool->destroy(obj);
+        }
+
+      private:
+        ObjectPool *m_pool = nullptr;
+    };
+
+    using Handle = std::unique_ptr<T, Deleter>;
+
+    /**
+     * Creates a pool in the region [@a start, @a start + @a size). The start
+     * is rounded up to a multiple of #item_size, as the slab heap requires.
+     * Aborts if no item fits after rounding.
+     */
+    ObjectPool(void *start, std::size_t size) {
+        const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(start);
+        const std::size_t skip = (item_size - addr % item_size) % item_size;
+        // A region too small for one item is passed on as empty, so that
+        // alloc_slab_init() aborts instead of getting a wrapped size.
+        const std::size_t avail = size >= skip + item_size ? size - skip : 0;
+        alloc_slab_init(&m_heap, reinterpret_cast<void *>(addr + skip), avail,
+                        item_size);
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    /// Destroys the objects that are still in the pool, see #clear().
+    ~ObjectPool() {
+        clear();
+    }
+
+    /**
+     * Constructs an object in place.
+     *
+     * @returns The object or `nullptr` if the pool is full. If the constructor
+     * throws, the item is returned to the pool and the exception propagates.
+     */
+    template <class... Args> T *create(Args &&...args) {
+        void *const item = allocate();
+        if (!item) { return nullptr; }
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            return ::new (item) T(std::forward<Args>(args)...);
+        } else {
+            try {
+                return ::new (item) T(std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(item);
+                throw;
+            }
+        }
+    }
+
+    /// Like #create(), but returns an owning handle (empty if the pool is
+    /// full).
+    template <class... Args> Handle make(Args &&...args) {
+        return Handle(create(std::forward<Args>(args)...), Deleter(this));
+    }
+
+    /// Destroys an object made by #create() and returns its item to the pool.
+    void destroy(T *obj) noexcept {
+        if (!obj) { return; }
+        obj->~T();
+        deallocate(obj);
+    }
+
+    /**
+     * Destroys every object in the pool at once.
+     *
+     * Objects owned by a #Handle must be released from it first. For types
+     * that are not trivially destructible, the free list is walked to find the
+     * live objects, which takes a temporary bitmap of one bit per item.
+     */
+    void clear() {
+        alloc_slab_drain_remote(&m_heap);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            if (m_heap.num_used != 0) { destroy_live(); }
+        }
+        m_heap.num_used = 0;
+        alloc_slab_reclaim(&m_heap);
+    }
+
+    std::size_t size() const noexcept {
+        return m_heap.num_used;
+    }
+
+    std::size_t capacity() const noexcept {
+        return m_heap.num_items;
+    }
+
+    alloc_slab_t *heap() noexcept {
+        return &m_heap;
+    }
+
+  private:
+    // Inline copy of alloc_slab() for a heap without a constructor.
+    void *allocate() noexcept {
+        if (__atomic_load_n(&m_heap.remote, __ATOMIC_RELAXED) != 0) {
+            return alloc_slab(&m_heap);
+        }
+
+        std::uintptr_t *const item = m_heap.free_head;
+        if (!item) { return alloc_slab(&m_heap); }
+        m_heap.free_head = reinterpret_cast<std::uintptr_t *>(*item);
+        m_heap.num_used++;
+        return item;
+    }
+
+    // Inline copy of alloc_slab_free().
+    void deallocate(void *ptr) noexcept {
+        std::uintptr_t *const item = static_cast<std::uintptr_t *>(ptr);
+        *item = reinterpret_cast<std::uintptr_t>(m_heap.free_head);
+        m_heap.free_head = item;
+        m_heap.num_used--;
+    }
+
+    void destroy_live() {
+        const std::uintptr_t first = m_heap.start;
+        std::vector<bool> is_free(m_heap.num_items);
+        for (std::uintptr_t *item = m_heap.free_head; item;
+             item = reinterpret_cast<std::uintptr_t *>(*item)) {
+            is_free[(reinterpret_cast<std::uintptr_t>(item) - first) /
+                    item_size] = true;
+        }
+        for (std::uintptr_t item = first; item < m_heap.fresh;
+             item += item_size) {
+            if (!is_free[(item - first) / item_size]) {
+                reinterpret_cast<T *>(item)->~T();
+            }
+        }
+    }
+
+    alloc_slab_t m_heap;
+};
+
+} // namespace ytalloc
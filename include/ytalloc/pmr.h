@@ -0,0 +1,194 @@
+#pragma once
+
+/**
+ * @file pmr.h
+ * `std::pmr::memory_resource` adapters for the ytalloc heaps (C++17).
+ *
+ * A resource does not own its heap: the heap is initialized by the caller and
+ * must outlive the resource. The resources are not thread-safe unless the heap
+ * has a lock and the `_locked` entry points are used, which they are not.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <ytalloc/ytalloc.h>
+
+namespace ytalloc {
+
+/**
+ * Resource over a list heap.
+ *
+ * List chunks are aligned at `alignof(void *)`. A request for a stricter
+ * alignment is over-allocated, and the chunk start is stored in the word just
+ * before the returned pointer.
+ */
+class list_resource : public std::pmr::memory_resource {
+  public:
+    explicit list_resource(alloc_list_t *heap) noexcept : m_heap(heap) {}
+
+    alloc_list_t *heap() const noexcept {
+        return m_heap;
+    }
+
+  protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        if (align <= alignof(void *)) {
+            void *const ptr = alloc_list(m_heap, bytes);
+            if (!ptr) { throw std::bad_alloc(); }
+            return ptr;
+        }
+
+        void *const chunk = alloc_list(m_heap, bytes + align + sizeof(void *));
+        if (!chunk) { throw std::bad_alloc(); }
+        const std::uintptr_t low =
+            reinterpret_cast<std::uintptr_t>(chunk) + sizeof(void *);
+        const std::uintptr_t ptr = (low + align - 1) & ~(align - 1);
+        reinterpret_cast<void **>(ptr)[-1] = chunk;
+        return reinterpret_cast<void *>(ptr);
+    }
+
+    void do_deallocate(void *ptr, std::size_t, std::size_t align) override {
+        if (align > alignof(void *)) { ptr = static_cast<void **>(ptr)[-1]; }
+        alloc_list_free(m_heap, ptr);
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+  private:
+    alloc_list_t *m_heap;
+};
+
+/**
+ * Resource over a buddy heap. The size given to `deallocate()` is passed on to
+ * #alloc_buddy_free(), so it must be the size given to `allocate()`, as
+ * `std::pmr` requires anyway.
+ */
+class buddy_resource : public std::pmr::memory_resource {
+  public:
+    explicit buddy_resource(alloc_buddy_t *heap) noexcept : m_heap(heap) {}
+
+    alloc_buddy_t *heap() const noexcept {
+        return m_heap;
+    }
+
+  protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        // The heap refuses empty requests, std::pmr does not.
+        const std::size_t size = bytes ? bytes : 1;
+        void *const ptr = alloc_buddy_aligned(m_heap, size, align);
+        if (!ptr) { throw std::bad_alloc(); }
+        return ptr;
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t) override {
+        alloc_buddy_free(m_heap, ptr, bytes ? bytes : 1);
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+  private:
+    alloc_buddy_t *m_heap;
+};
+
+/**
+ * Resource over a slab heap.
+ *
+ * Requests that fit an item go to the slab, others go to @a upstream, so a
+ * container whose node size matches the item size can still allocate its
+ * bucket arrays. Deallocations are told apart by the address.
+ */
+class slab_resource : public std::pmr::memory_resource {
+  public:
+    explicit slab_resource(alloc_slab_t *heap,
+                           std::pmr::memory_resource *upstream =
+                               std::pmr::get_default_resource()) noexcept
+        : m_heap(heap), m_upstream(upstream) {}
+
+    alloc_slab_t *heap() const noexcept {
+        return m_heap;
+    }
+
+    std::pmr::memory_resource *upstream_resource() const noexcept {
+        return m_upstream;
+    }
+
+  protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        if (fits(bytes, align)) {
+            void *const ptr = alloc_slab(m_heap);
+            if (!ptr) { throw std::bad_alloc(); }
+            return ptr;
+        }
+        return m_upstream->allocate(bytes, align);
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes,
+                       std::size_t align) override {
+        const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(ptr);
+        if (addr >= m_heap->start && addr < m_heap->end) {
+            alloc_slab_free(m_heap, ptr);
+        } else {
+            m_upstream->deallocate(ptr, bytes, align);
+        }
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+  private:
+    // Items are aligned at the lowest set bit of their size and colour offset.
+    bool fits(std::size_t bytes, std::size_t align) const noexcept {
+        const std::size_t bits = m_heap->alloc_size | m_heap->colour_off;
+        return bytes <= m_heap->alloc_size && align <= (bits & (~bits + 1));
+    }
+
+    alloc_slab_t *m_heap;
+    std::pmr::memory_resource *m_upstream;
+};
+
+/**
+ * Monotonic resource over a static heap: `deallocate()` does nothing and
+ * `release()` rewinds the whole heap.
+ */
+class static_resource : public std::pmr::memory_resource {
+  public:
+    explicit static_resource(alloc_static_t *heap) noexcept : m_heap(heap) {}
+
+    alloc_static_t *heap() const noexcept {
+        return m_heap;
+    }
+
+    void release() noexcept {
+        alloc_static_reset(m_heap);
+    }
+
+  protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        const std::size_t size = bytes ? bytes : 1;
+        void *const ptr = alloc_static_aligned(m_heap, size, align);
+        if (!ptr) { throw std::bad_alloc(); }
+        return ptr;
+    }
+
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+  private:
+    alloc_static_t *m_heap;
+};
+
+} // namespace ytalloc
@@ -18,12 +18,59 @@
 #ifndef YTALLOC_STATIC_ALIGN
 #define YTALLOC_STATIC_ALIGN 32
 #endif
+#ifndef YTALLOC_BUDDY_CACHE_ORDERS
+#define YTALLOC_BUDDY_CACHE_ORDERS 2
+#endif
+#ifndef YTALLOC_BUDDY_CACHE_MAX
+#define YTALLOC_BUDDY_CACHE_MAX 64
+#endif
+#ifndef YTALLOC_SLAB_COLOUR_ALIGN
+#define YTALLOC_SLAB_COLOUR_ALIGN 64
+#endif
+#ifndef YTALLOC_RING_ALIGN
+#define YTALLOC_RING_ALIGN 16
+#endif
+#ifndef YTALLOC_HANDLE_INDEX_BITS
+#define YTALLOC_HANDLE_INDEX_BITS 20
+#endif
+#ifndef YTALLOC_HEAP_LIST_MAX
+#define YTALLOC_HEAP_LIST_MAX 16384
+#endif
+#ifndef YTALLOC_REGISTRY_PAGE_SHIFT
+#define YTALLOC_REGISTRY_PAGE_SHIFT 12
+#endif
+#ifndef YTALLOC_REGISTRY_ADDR_BITS
+#define YTALLOC_REGISTRY_ADDR_BITS 48
+#endif
+#ifndef YTALLOC_STATS_MAX_THREADS
+#define YTALLOC_STATS_MAX_THREADS 64
+#endif
+#ifndef YTALLOC_STATS_SAMPLE_SHIFT
+#define YTALLOC_STATS_SAMPLE_SHIFT 4
+#endif
+#ifndef YTALLOC_STATS_BATCH
+#define YTALLOC_STATS_BATCH 65536
+#endif
+
+#define ALLOC_HANDLE_NULL 0
 
 #define YTALLOC_BUDDY_MIN_ALLOC_SIZE YTALLOC_BUDDY_MIN_BLOCK_SIZE
+#define YTALLOC_HEAP_NUM_CLASSES     20
+#define YTALLOC_HEAP_SMALL_MAX       1024
+#define YTALLOC_REGISTRY_LEVEL_BITS  12
+#define YTALLOC_STATS_NUM_BUCKETS    32
 
 static_assert(YTALLOC_BUDDY_MAX_ORDERS > 0);
 static_assert(YTALLOC_BUDDY_MIN_BLOCK_SIZE > 0);
 static_assert(YTALLOC_BUDDY_MIN_ALLOC_SIZE > 0);
+static_assert(YTALLOC_BUDDY_CACHE_ORDERS > 0);
+static_assert(YTALLOC_BUDDY_CACHE_MAX > 1);
+static_assert(YTALLOC_SLAB_COLOUR_ALIGN > 0);
+static_assert(YTALLOC_RING_ALIGN >= 8);
+static_assert((YTALLOC_RING_ALIGN & (YTALLOC_RING_ALIGN - 1)) == 0);
+static_assert(YTALLOC_HEAP_LIST_MAX > YTALLOC_HEAP_SMALL_MAX);
+static_assert(YTALLOC_REGISTRY_ADDR_BITS - YTALLOC_REGISTRY_PAGE_SHIFT >
+              2 * YTALLOC_REGISTRY_LEVEL_BITS);
 
 #if __cplusplus
 extern "C" {
@@ -31,6 +78,20 @@ extern "C" {
 
 typedef struct list ytaux_list_t;
 
+typedef void (*alloc_lock_fn)(void *obj);
+typedef bool (*alloc_trylock_fn)(void *obj);
+
+typedef struct {
+    alloc_lock_fn lock;
+    alloc_lock_fn unlock;
+    alloc_trylock_fn trylock;
+    void *obj;
+} alloc_lock_t;
+
+typedef struct {
+    uint32_t locked;
+} alloc_spinlock_t;
+
 typedef struct {
     uintptr_t start;
     uintptr_t end;
@@ -42,6 +103,11 @@ typedef struct {
 #else
     [[gnu::aligned(8)]] uint8_t prv[16];
 #endif
+
+    const alloc_lock_t *lock;
+
+    const void *owner;
+    [[gnu::aligned(64)]] uintptr_t remote;
 } alloc_list_t;
 
 typedef struct {
@@ -49,8 +115,83 @@ typedef struct {
     uintptr_t end;
 
     uintptr_t next;
+    uintptr_t last;
+    uintptr_t dirty_end;
+
+    const alloc_lock_t *lock;
 } alloc_static_t;
 
+typedef struct {
+    uintptr_t next;
+    uintptr_t last;
+} alloc_static_mark_t;
+
+typedef enum {
+    ALLOC_STATIC_LOW,
+    ALLOC_STATIC_HIGH,
+} alloc_static_end_t;
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+
+    uintptr_t low;
+    uintptr_t high;
+
+    const alloc_lock_t *lock;
+} alloc_static_de_t;
+
+typedef struct {
+    alloc_static_end_t end;
+    uintptr_t pos;
+} alloc_static_de_mark_t;
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+
+    [[gnu::aligned(64)]] uintptr_t next;
+} alloc_static_atomic_t;
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+    size_t capacity;
+
+    size_t head;
+    size_t tail;
+    size_t num_used;
+    size_t num_live;
+
+    const alloc_lock_t *lock;
+} alloc_ring_t;
+
+typedef void *(*alloc_page_get_fn)(void *ctx, size_t size);
+typedef void (*alloc_page_put_fn)(void *ctx, void *ptr, size_t size);
+
+typedef struct {
+    alloc_page_get_fn get;
+    alloc_page_put_fn put;
+    void *ctx;
+} alloc_page_source_t;
+
+struct alloc_arena_chunk;
+
+typedef struct {
+    alloc_page_source_t source;
+    size_t chunk_size;
+
+    struct alloc_arena_chunk *chunks;
+    size_t num_chunks;
+
+    const alloc_lock_t *lock;
+} alloc_arena_t;
+
+typedef struct {
+    struct alloc_arena_chunk *chunk;
+    alloc_static_mark_t heap;
+} alloc_arena_mark_t;
+
 typedef struct {
     uintptr_t start;
     uintptr_t end;
@@ -61,32 +202,274 @@ typedef struct {
     uintptr_t *free_heads;
     uint8_t *usage_bitmap;
     size_t bitmap_size;
+    uint8_t *order_map;
+    uint8_t *zero_map;
+
+    const alloc_lock_t *lock;
 } alloc_buddy_t;
 
+typedef struct {
+    alloc_buddy_t *heap;
+    size_t low;
+    size_t high;
+
+    size_t num_cached[YTALLOC_BUDDY_CACHE_ORDERS];
+    void *cached[YTALLOC_BUDDY_CACHE_ORDERS][YTALLOC_BUDDY_CACHE_MAX];
+} alloc_buddy_cache_t;
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+
+    size_t unit_shift;
+    size_t num_units;
+    uint64_t *bitmap;
+    size_t num_words;
+    uint64_t *any_free;
+    uint64_t *all_free;
+    size_t num_summary_words;
+
+    size_t hint;
+    size_t num_used;
+
+    const alloc_lock_t *lock;
+} alloc_bitmap_t;
+
+typedef struct {
+    size_t num_free;
+    size_t num_free_runs;
+    size_t largest_free_run;
+} alloc_bitmap_frag_t;
+
+typedef void (*alloc_slab_ctor_fn)(void *obj, void *arg);
+typedef void (*alloc_slab_dtor_fn)(void *obj, void *arg);
+
+typedef struct {
+    size_t link_offset;
+    alloc_slab_ctor_fn ctor;
+    alloc_slab_dtor_fn dtor;
+    void *ctor_arg;
+    size_t *colour_cursor;
+} alloc_slab_opts_t;
+
 typedef struct {
     uintptr_t start;
     uintptr_t end;
     size_t used_size;
 
     size_t alloc_size;
+    size_t link_offset;
+    size_t colour_off;
     uintptr_t *free_head;
+    uintptr_t fresh;
+    uintptr_t dirty_end;
 
     size_t num_used;
     size_t num_items;
+
+    alloc_slab_ctor_fn ctor;
+    alloc_slab_dtor_fn dtor;
+    void *ctor_arg;
+
+    const alloc_lock_t *lock;
+
+    const void *owner;
+    [[gnu::aligned(64)]] uintptr_t remote;
 } alloc_slab_t;
 
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+    size_t used_size;
+
+    size_t alloc_size;
+    size_t alloc_shift;
+    uint64_t *bitmap;
+    size_t num_words;
+    size_t hint;
+
+    size_t num_used;
+    size_t num_items;
+
+    const alloc_lock_t *lock;
+} alloc_slab_bitmap_t;
+
+typedef uint32_t alloc_handle_t;
+
+typedef struct {
+    alloc_slab_t slab;
+
+    uint32_t *generations;
+    uint32_t *dense;
+    uint32_t *dense_pos;
+    size_t num_live;
+
+    const alloc_lock_t *lock;
+} alloc_handle_pool_t;
+
+typedef struct {
+    alloc_slab_t classes[YTALLOC_HEAP_NUM_CLASSES];
+    uintptr_t slab_start;
+    uintptr_t slab_end;
+    size_t class_shift;
+
+    alloc_list_t *list;
+    alloc_buddy_t *buddy;
+    uint8_t *buddy_log2;
+} alloc_heap_t;
+
+typedef enum {
+    ALLOC_KIND_LIST = 1,
+    ALLOC_KIND_STATIC,
+    ALLOC_KIND_STATIC_DE,
+    ALLOC_KIND_STATIC_ATOMIC,
+    ALLOC_KIND_RING,
+    ALLOC_KIND_BUDDY,
+    ALLOC_KIND_BITMAP,
+    ALLOC_KIND_SLAB,
+    ALLOC_KIND_SLAB_BITMAP,
+} alloc_kind_t;
+
+typedef struct alloc_region {
+    uintptr_t start;
+    uintptr_t end;
+    alloc_kind_t kind;
+    void *heap;
+
+    struct alloc_region *next;
+} alloc_region_t;
+
+typedef struct {
+    uintptr_t *root;
+    uintptr_t pool;
+    uintptr_t pool_end;
+    alloc_region_t *regions;
+
+    alloc_spinlock_t spin;
+    alloc_lock_t lock;
+} alloc_registry_t;
+
+typedef struct {
+    size_t heap_size;
+    size_t used_size;
+    size_t free_size;
+} alloc_ops_stats_t;
+
+typedef struct {
+    const char *name;
+    void *(*alloc)(void *heap, size_t size);
+    void *(*aligned_alloc)(void *heap, size_t size, size_t align);
+    void (*free)(void *heap, void *ptr, size_t size);
+    size_t (*usable_size)(const void *heap, const void *ptr, size_t size);
+    void (*stats)(const void *heap, alloc_ops_stats_t *out);
+    void (*reset)(void *heap);
+} alloc_ops_t;
+
+typedef enum {
+    ALLOC_STATS_OP_ALLOC,
+    ALLOC_STATS_OP_FREE,
+    ALLOC_STATS_NUM_OPS,
+} alloc_stats_op_t;
+
+typedef enum {
+    ALLOC_STATS_TEXT,
+    ALLOC_STATS_JSON,
+} alloc_stats_format_t;
+
+typedef struct {
+    uint64_t num_allocs;
+    uint64_t num_frees;
+    uint64_t num_failed;
+    uint64_t bytes_requested;
+    uint64_t bytes_granted;
+    uint64_t bytes_freed;
+    uint64_t peak_bytes;
+    uint64_t latency[ALLOC_STATS_NUM_OPS][YTALLOC_STATS_NUM_BUCKETS];
+} alloc_stats_t;
+
 typedef int (*alloc_log_fn)(const char *fmt, va_list ap);
 typedef void (*alloc_abort_fn)(void);
 
 void alloc_set_log_fn(alloc_log_fn fn);
 void alloc_set_abort_fn(alloc_abort_fn fn);
 
+void alloc_lock_spin(alloc_lock_t *lock, alloc_spinlock_t *spin);
+void alloc_lock_pthread(alloc_lock_t *lock, void *mutex);
+
 void alloc_list_init(alloc_list_t *heap, void *start, size_t size);
 void *alloc_list(alloc_list_t *heap, size_t size);
 void alloc_list_free(alloc_list_t *heap, void *ptr);
+void alloc_list_set_lock(alloc_list_t *heap, const alloc_lock_t *lock);
+void *alloc_list_locked(alloc_list_t *heap, size_t size);
+void alloc_list_free_locked(alloc_list_t *heap, void *ptr);
+void alloc_list_set_owner(alloc_list_t *heap);
+void alloc_list_free_remote(alloc_list_t *heap, void *ptr);
+size_t alloc_list_drain_remote(alloc_list_t *heap);
+void *alloc_list_at_least(alloc_list_t *heap, size_t size, size_t *out_size);
+size_t alloc_list_usable_size(const alloc_list_t *heap, const void *ptr);
 
 void alloc_static_init(alloc_static_t *heap, void *start, size_t size);
 void *alloc_static(alloc_static_t *heap, size_t size);
+void *alloc_static_aligned(alloc_static_t *heap, size_t size, size_t align);
+bool alloc_static_extend(alloc_static_t *heap, void *ptr, size_t new_size);
+alloc_static_mark_t alloc_static_mark(const alloc_static_t *heap);
+void alloc_static_rewind(alloc_static_t *heap, alloc_static_mark_t mark);
+void alloc_static_reset(alloc_static_t *heap);
+void alloc_static_set_lock(alloc_static_t *heap, const alloc_lock_t *lock);
+void *alloc_static_locked(alloc_static_t *heap, size_t size, size_t align);
+void alloc_static_set_zeroed(alloc_static_t *heap);
+void *alloc_static_calloc(alloc_static_t *heap, size_t num, size_t size);
+
+void alloc_static_de_init(alloc_static_de_t *heap, void *start, size_t size);
+void *alloc_static_de(alloc_static_de_t *heap, alloc_static_end_t end,
+                      size_t size);
+void *alloc_static_de_aligned(alloc_static_de_t *heap, alloc_static_end_t end,
+                              size_t size, size_t align);
+alloc_static_de_mark_t alloc_static_de_mark(const alloc_static_de_t *heap,
+                                            alloc_static_end_t end);
+void alloc_static_de_rewind(alloc_static_de_t *heap,
+                            alloc_static_de_mark_t mark);
+void alloc_static_de_reset(alloc_static_de_t *heap);
+size_t alloc_static_de_num_free(const alloc_static_de_t *heap);
+void alloc_static_de_set_lock(alloc_static_de_t *heap,
+                              const alloc_lock_t *lock);
+void *alloc_static_de_locked(alloc_static_de_t *heap, alloc_static_end_t end,
+                             size_t size, size_t align);
+
+void alloc_static_atomic_init(alloc_static_atomic_t *heap, void *start,
+                              size_t size);
+void *alloc_static_atomic(alloc_static_atomic_t *heap, size_t size);
+void *alloc_static_atomic_aligned(alloc_static_atomic_t *heap, size_t size,
+                                  size_t align);
+void *alloc_static_atomic_local(alloc_static_atomic_t *heap,
+                                alloc_static_t *local, size_t size,
+                                size_t lease_size);
+void alloc_static_atomic_reset(alloc_static_atomic_t *heap);
+size_t alloc_static_atomic_num_used(const alloc_static_atomic_t *heap);
+
+void alloc_ring_init(alloc_ring_t *ring, void *start, size_t size);
+void *alloc_ring(alloc_ring_t *ring, size_t size);
+void alloc_ring_free(alloc_ring_t *ring, void *ptr);
+void alloc_ring_set_lock(alloc_ring_t *ring, const alloc_lock_t *lock);
+void *alloc_ring_locked(alloc_ring_t *ring, size_t size);
+void alloc_ring_free_locked(alloc_ring_t *ring, void *ptr);
+size_t alloc_ring_num_used(const alloc_ring_t *ring);
+size_t alloc_ring_num_live(const alloc_ring_t *ring);
+
+void alloc_page_source_buddy(alloc_page_source_t *src, alloc_buddy_t *buddy);
+void alloc_page_source_mmap(alloc_page_source_t *src);
+
+void alloc_arena_init(alloc_arena_t *arena, const alloc_page_source_t *src,
+                      size_t chunk_size);
+void *alloc_arena(alloc_arena_t *arena, size_t size);
+void *alloc_arena_aligned(alloc_arena_t *arena, size_t size, size_t align);
+void alloc_arena_set_lock(alloc_arena_t *arena, const alloc_lock_t *lock);
+void *alloc_arena_locked(alloc_arena_t *arena, size_t size, size_t align);
+alloc_arena_mark_t alloc_arena_mark(const alloc_arena_t *arena);
+void alloc_arena_rewind(alloc_arena_t *arena, alloc_arena_mark_t mark);
+void alloc_arena_reset(alloc_arena_t *arena);
+void alloc_arena_destroy(alloc_arena_t *arena);
+size_t alloc_arena_num_chunks(const alloc_arena_t *arena);
 
 void alloc_buddy_init(alloc_buddy_t *heap, void *start, size_t size,
                       void *free_heads, size_t free_heads_size, void *bitmap,
@@ -94,18 +477,140 @@ void alloc_buddy_init(alloc_buddy_t *heap, void *start, size_t size,
 void *alloc_buddy(alloc_buddy_t *heap, size_t size);
 void *alloc_buddy_aligned(alloc_buddy_t *heap, size_t size, size_t align);
 void alloc_buddy_free(alloc_buddy_t *heap, void *ptr, size_t size);
+size_t alloc_buddy_bulk(alloc_buddy_t *heap, size_t size, void **out,
+                        size_t n);
+void alloc_buddy_free_bulk(alloc_buddy_t *heap, void **ptrs, size_t n,
+                           size_t size);
+void alloc_buddy_set_lock(alloc_buddy_t *heap, const alloc_lock_t *lock);
+void *alloc_buddy_locked(alloc_buddy_t *heap, size_t size);
+void *alloc_buddy_aligned_locked(alloc_buddy_t *heap, size_t size,
+                                 size_t align);
+void alloc_buddy_free_locked(alloc_buddy_t *heap, void *ptr, size_t size);
+size_t alloc_buddy_bulk_locked(alloc_buddy_t *heap, size_t size, void **out,
+                               size_t n);
+void alloc_buddy_free_bulk_locked(alloc_buddy_t *heap, void **ptrs, size_t n,
+                                  size_t size);
 size_t alloc_buddy_order0_size(const alloc_buddy_t *heap);
 size_t alloc_buddy_heap_size(const alloc_buddy_t *heap);
 size_t alloc_buddy_count_free(const alloc_buddy_t *heap, uint8_t order);
+void alloc_buddy_set_order_map(alloc_buddy_t *heap, void *map,
+                               size_t map_size);
+void *alloc_buddy_at_least(alloc_buddy_t *heap, size_t size,
+                           size_t *out_size);
+size_t alloc_buddy_usable_size(const alloc_buddy_t *heap, const void *ptr);
+void alloc_buddy_set_zeroed(alloc_buddy_t *heap, void *map, size_t map_size);
+void *alloc_buddy_calloc(alloc_buddy_t *heap, size_t num, size_t size);
+
+void alloc_buddy_cache_init(alloc_buddy_cache_t *cache, alloc_buddy_t *heap,
+                            size_t low, size_t high);
+void *alloc_buddy_cache(alloc_buddy_cache_t *cache, size_t size);
+void alloc_buddy_cache_free(alloc_buddy_cache_t *cache, void *ptr,
+                            size_t size);
+void alloc_buddy_cache_flush(alloc_buddy_cache_t *cache);
+size_t alloc_buddy_cache_num_cached(const alloc_buddy_cache_t *cache,
+                                    size_t order);
+
+size_t alloc_bitmap_meta_size(size_t num_units);
+void alloc_bitmap_init(alloc_bitmap_t *heap, void *start, size_t size,
+                       size_t unit_size, void *meta, size_t meta_size);
+void *alloc_bitmap(alloc_bitmap_t *heap, size_t size);
+void alloc_bitmap_free(alloc_bitmap_t *heap, void *ptr, size_t size);
+void alloc_bitmap_set_lock(alloc_bitmap_t *heap, const alloc_lock_t *lock);
+void *alloc_bitmap_locked(alloc_bitmap_t *heap, size_t size);
+void alloc_bitmap_free_locked(alloc_bitmap_t *heap, void *ptr, size_t size);
+bool alloc_bitmap_is_used(const alloc_bitmap_t *heap, const void *ptr);
+size_t alloc_bitmap_num_free(const alloc_bitmap_t *heap);
+size_t alloc_bitmap_num_used(const alloc_bitmap_t *heap);
+size_t alloc_bitmap_num_units(const alloc_bitmap_t *heap);
+void alloc_bitmap_frag(const alloc_bitmap_t *heap, alloc_bitmap_frag_t *out);
 
 void alloc_slab_init(alloc_slab_t *heap, void *start, size_t size,
                      size_t alloc_size);
+void alloc_slab_init_opts(alloc_slab_t *heap, void *start, size_t size,
+                          size_t alloc_size, const alloc_slab_opts_t *opts);
 void *alloc_slab(alloc_slab_t *heap);
+size_t alloc_slab_bulk(alloc_slab_t *heap, void **out, size_t n);
 void alloc_slab_free(alloc_slab_t *heap, void *ptr);
+void alloc_slab_free_bulk(alloc_slab_t *heap, void **ptrs, size_t n);
+void alloc_slab_set_lock(alloc_slab_t *heap, const alloc_lock_t *lock);
+void *alloc_slab_locked(alloc_slab_t *heap);
+size_t alloc_slab_bulk_locked(alloc_slab_t *heap, void **out, size_t n);
+void alloc_slab_free_locked(alloc_slab_t *heap, void *ptr);
+void alloc_slab_free_bulk_locked(alloc_slab_t *heap, void **ptrs, size_t n);
+void alloc_slab_set_owner(alloc_slab_t *heap);
+void alloc_slab_free_remote(alloc_slab_t *heap, void *ptr);
+size_t alloc_slab_drain_remote(alloc_slab_t *heap);
+void alloc_slab_reclaim(alloc_slab_t *heap);
+void *alloc_slab_at_least(alloc_slab_t *heap, size_t size, size_t *out_size);
+size_t alloc_slab_usable_size(const alloc_slab_t *heap, const void *ptr);
+void alloc_slab_set_zeroed(alloc_slab_t *heap);
+void *alloc_slab_calloc(alloc_slab_t *heap);
 size_t alloc_slab_num_free(const alloc_slab_t *heap);
 size_t alloc_slab_num_used(const alloc_slab_t *heap);
 size_t alloc_slab_num_items(const alloc_slab_t *heap);
 
+void alloc_slab_bitmap_init(alloc_slab_bitmap_t *heap, void *start,
+                            size_t size, size_t alloc_size, void *bitmap,
+                            size_t bitmap_size);
+void *alloc_slab_bitmap(alloc_slab_bitmap_t *heap);
+void alloc_slab_bitmap_free(alloc_slab_bitmap_t *heap, void *ptr);
+void alloc_slab_bitmap_set_lock(alloc_slab_bitmap_t *heap,
+                                const alloc_lock_t *lock);
+void *alloc_slab_bitmap_locked(alloc_slab_bitmap_t *heap);
+void alloc_slab_bitmap_free_locked(alloc_slab_bitmap_t *heap, void *ptr);
+bool alloc_slab_bitmap_is_used(const alloc_slab_bitmap_t *heap,
+                               const void *ptr);
+size_t alloc_slab_bitmap_num_free(const alloc_slab_bitmap_t *heap);
+size_t alloc_slab_bitmap_num_used(const alloc_slab_bitmap_t *heap);
+size_t alloc_slab_bitmap_num_items(const alloc_slab_bitmap_t *heap);
+
+size_t alloc_handle_pool_meta_size(size_t num_items);
+void alloc_handle_pool_init(alloc_handle_pool_t *pool, void *start,
+                            size_t size, size_t alloc_size, void *meta,
+                            size_t meta_size);
+alloc_handle_t alloc_handle(alloc_handle_pool_t *pool, void **out_ptr);
+void alloc_handle_free(alloc_handle_pool_t *pool, alloc_handle_t handle);
+void alloc_handle_pool_set_lock(alloc_handle_pool_t *pool,
+                                const alloc_lock_t *lock);
+alloc_handle_t alloc_handle_locked(alloc_handle_pool_t *pool,
+                                   void **out_ptr);
+void alloc_handle_free_locked(alloc_handle_pool_t *pool,
+                              alloc_handle_t handle);
+void *alloc_handle_get(const alloc_handle_pool_t *pool, alloc_handle_t handle);
+size_t alloc_handle_num_live(const alloc_handle_pool_t *pool);
+void *alloc_handle_live_at(const alloc_handle_pool_t *pool, size_t pos,
+                           alloc_handle_t *out_handle);
+
+size_t alloc_heap_meta_size(const alloc_buddy_t *buddy);
+void alloc_heap_init(alloc_heap_t *heap, void *slab_start, size_t slab_size,
+                     alloc_list_t *list, alloc_buddy_t *buddy, void *meta,
+                     size_t meta_size);
+void *alloc_heap(alloc_heap_t *heap, size_t size);
+void alloc_heap_free(alloc_heap_t *heap, void *ptr);
+size_t alloc_heap_class_size(size_t class_idx);
+
+size_t alloc_registry_min_pool_size(void);
+void alloc_registry_init(alloc_registry_t *reg, void *pool, size_t pool_size);
+bool alloc_registry_add(alloc_registry_t *reg, alloc_kind_t kind, void *heap,
+                        const void *start, size_t size);
+void alloc_registry_remove(alloc_registry_t *reg, const void *heap);
+const alloc_region_t *alloc_registry_find(const alloc_registry_t *reg,
+                                          const void *ptr);
+void alloc_registry_free(const alloc_registry_t *reg, void *ptr);
+void alloc_set_registry(alloc_registry_t *reg);
+
+extern const alloc_ops_t alloc_list_ops;
+extern const alloc_ops_t alloc_static_ops;
+extern const alloc_ops_t alloc_buddy_ops;
+extern const alloc_ops_t alloc_slab_ops;
+const alloc_ops_t *alloc_ops_find(const char *name);
+
+bool alloc_stats_enabled(void);
+void alloc_stats_get(alloc_kind_t kind, alloc_stats_t *out);
+void alloc_stats_reset(void);
+size_t alloc_stats_dump(alloc_stats_format_t format, char *buf,
+                        size_t buf_size);
+
 #if __cplusplus
 }
 #endif
@@ -0,0 +1,198 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_lock.h"
+#include "alloc_macros.h"
+#include "alloc_registry.h"
+
+typedef struct alloc_arena_chunk {
+    struct alloc_arena_chunk *prev;
+    size_t size;
+    alloc_static_t heap;
+} alloc_arena_chunk_t;
+
+#define ALLOC_ARENA_HDR_SIZE                                                   \
+    ((sizeof(alloc_arena_chunk_t) + (YTALLOC_STATIC_ALIGN - 1)) &              \
+     ~(size_t)(YTALLOC_STATIC_ALIGN - 1))
+
+static alloc_arena_chunk_t *prv_alloc_arena_grow(alloc_arena_t *arena,
+                                                 size_t size, size_t align);
+static void prv_alloc_arena_release_after(alloc_arena_t *arena,
+                                          alloc_arena_chunk_t *keep);
+
+/**
+ * Initializes a growable arena.
+ *
+ * The arena is a chain of static heaps. Whenever the current chunk is
+ * exhausted, a new one is requested from @a src. Allocations bigger than a
+ * chunk get a chunk of their own. No memory is requested until the first
+ * allocation.
+ *
+ * @param arena      Arena structure pointer.
+ * @param src        Page source that provides the chunks. It is copied.
+ * @param chunk_size Default size of a chunk, including its header.
+ */
+void alloc_arena_init(alloc_arena_t *arena, const alloc_page_source_t *src,
+                      size_t chunk_size) {
+    ASSERT_ALWAYS(arena != NULL);
+    ASSERT_ALWAYS(src != NULL);
+    ASSERT_ALWAYS(src->get != NULL);
+    ASSERTF_ALWAYS(chunk_size > ALLOC_ARENA_HDR_SIZE,
+                   "chunk_size must be > %zu", (size_t)ALLOC_ARENA_HDR_SIZE);
+
+    memset(arena, 0, sizeof(*arena));
+    arena->source = *src;
+    arena->chunk_size = chunk_size;
+}
+
+void *alloc_arena(alloc_arena_t *arena, size_t size) {
+    return alloc_arena_aligned(arena, size, YTALLOC_STATIC_ALIGN);
+}
+
+void *alloc_arena_aligned(alloc_arena_t *arena, size_t size, size_t align) {
+    ASSERT_DEBUG(arena != NULL);
+
+    if (size == 0) { return NULL; }
+
+    alloc_arena_chunk_t *chunk = arena->chunks;
+    if (chunk) {
+        void *const ptr = alloc_static_aligned(&chunk->heap, size, align);
+        if (ptr) { return ptr; }
+    }
+
+    chunk = prv_alloc_arena_grow(arena, size, align);
+    if (!chunk) { return NULL; }
+    return alloc_static_aligned(&chunk->heap, size, align);
+}
+
+void alloc_arena_set_lock(alloc_arena_t *arena, const alloc_lock_t *lock) {
+    ASSERT_DEBUG(arena != NULL);
+    arena->lock = lock;
+}
+
+/**
+ * Locked version of #alloc_arena_aligned().
+ *
+ * The lock is held while a new chunk is taken from the page source, so the
+ * page source does not need to be thread-safe itself.
+ */
+void *alloc_arena_locked(alloc_arena_t *arena, size_t size, size_t align) {
+    ASSERT_DEBUG(arena != NULL);
+    if (size == 0) { return NULL; }
+
+    alloc_lock_acquire(arena->lock);
+    void *const ptr = alloc_arena_aligned(arena, size, align);
+    alloc_lock_release(arena->lock);
+
+    return ptr;
+}
+
+/**
+ * Returns a checkpoint that #alloc_arena_rewind() can return the arena to.
+ */
+alloc_arena_mark_t alloc_arena_mark(const alloc_arena_t *arena) {
+    ASSERT_DEBUG(arena != NULL);
+
+    alloc_arena_mark_t mark = {.chunk = arena->chunks};
+    if (arena->chunks) { mark.heap = alloc_static_mark(&arena->chunks->heap); }
+    return mark;
+}
+
+/**
+ * Frees everything allocated since @a mark was taken and releases the chunks
+ * requested after it. Rewinding to a mark taken before the first allocation
+ * is the same as #alloc_arena_reset().
+ */
+void alloc_arena_rewind(alloc_arena_t *arena, alloc_arena_mark_t mark) {
+    ASSERT_DEBUG(arena != NULL);
+
+    if (!mark.chunk) {
+        alloc_arena_reset(arena);
+        return;
+    }
+
+    prv_alloc_arena_release_after(arena, mark.chunk);
+    ASSERTF_ALWAYS(arena->chunks == mark.chunk,
+                   "mark chunk %p does not belong to the arena", mark.chunk);
+    alloc_static_rewind(&arena->chunks->heap, mark.heap);
+}
+
+/**
+ * Frees everything allocated from the arena.
+ *
+ * The oldest chunk is kept for the following allocations, the rest are given
+ * back to the page source.
+ */
+void alloc_arena_reset(alloc_arena_t *arena) {
+    ASSERT_DEBUG(arena != NULL);
+
+    alloc_arena_chunk_t *oldest = arena->chunks;
+    if (!oldest) { return; }
+    while (oldest->prev) {
+        oldest = oldest->prev;
+    }
+
+    prv_alloc_arena_release_after(arena, oldest);
+    alloc_static_reset(&oldest->heap);
+}
+
+/**
+ * Gives every chunk back to the page source.
+ */
+void alloc_arena_destroy(alloc_arena_t *arena) {
+    ASSERT_DEBUG(arena != NULL);
+    prv_alloc_arena_release_after(arena, NULL);
+}
+
+size_t alloc_arena_num_chunks(const alloc_arena_t *arena) {
+    ASSERT_DEBUG(arena != NULL);
+    return arena->num_chunks;
+}
+
+/**
+ * Requests a chunk that fits an allocation of @a size bytes aligned at
+ * @a align and makes it the current one.
+ */
+static alloc_arena_chunk_t *prv_alloc_arena_grow(alloc_arena_t *arena,
+                                                 size_t size, size_t align) {
+    const size_t pad = align > YTALLOC_STATIC_ALIGN ? align - 1 : 0;
+    if (size > SIZE_MAX - ALLOC_ARENA_HDR_SIZE - pad) { return NULL; }
+
+    size_t chunk_size = ALLOC_ARENA_HDR_SIZE + size + pad;
+    if (chunk_size < arena->chunk_size) { chunk_size = arena->chunk_size; }
+
+    void *const mem = arena->source.get(arena->source.ctx, chunk_size);
+    if (!mem) {
+        LOGF_DEBUG("alloc_arena: page source could not give %zu bytes",
+                   chunk_size);
+        return NULL;
+    }
+
+    alloc_arena_chunk_t *const chunk = mem;
+    chunk->prev = arena->chunks;
+    chunk->size = chunk_size;
+    alloc_static_init(&chunk->heap, (uint8_t *)mem + ALLOC_ARENA_HDR_SIZE,
+                      chunk_size - ALLOC_ARENA_HDR_SIZE);
+
+    arena->chunks = chunk;
+    arena->num_chunks++;
+    return chunk;
+}
+
+/**
+ * Gives the chunks newer than @a keep back to the page source. If @a keep is
+ * `NULL`, all the chunks are given back.
+ */
+static void prv_alloc_arena_release_after(alloc_arena_t *arena,
+                                          alloc_arena_chunk_t *keep) {
+    while (arena->chunks && arena->chunks != keep) {
+        alloc_arena_chunk_t *const chunk = arena->chunks;
+        arena->chunks = chunk->prev;
+        arena->num_chunks--;
+        alloc_static_reset(&chunk->heap);
+        alloc_registry_forget(&chunk->heap);
+        if (arena->source.put) {
+            arena->source.put(arena->source.ctx, chunk, chunk->size);
+        }
+    }
+}
@@ -0,0 +1,439 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_lock.h"
+#include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
+#include "aux/auxmath.h"
+#include "aux/bitmap.h"
+
+static size_t prv_alloc_bitmap_num_words(size_t num_units);
+static size_t prv_alloc_bitmap_index(const alloc_bitmap_t *heap,
+                                     const void *ptr);
+static size_t prv_alloc_bitmap_num_units(const alloc_bitmap_t *heap,
+                                         size_t size);
+
+static size_t prv_alloc_bitmap_find_run(const alloc_bitmap_t *heap,
+                                        size_t from, size_t n);
+static size_t prv_alloc_bitmap_next_nonfull(const alloc_bitmap_t *heap,
+                                            size_t word);
+static size_t prv_alloc_bitmap_count_empty(const alloc_bitmap_t *heap,
+                                           size_t word);
+static size_t prv_alloc_bitmap_word_find_run(uint64_t word, size_t n);
+
+static void prv_alloc_bitmap_mark(alloc_bitmap_t *heap, size_t first,
+                                  size_t n, bool used);
+static void prv_alloc_bitmap_update_summary(alloc_bitmap_t *heap,
+                                            size_t word);
+
+/**
+ * Returns the size of the metadata needed by #alloc_bitmap_init() for a heap
+ * of @a num_units units.
+ */
+size_t alloc_bitmap_meta_size(size_t num_units) {
+    const size_t num_words = prv_alloc_bitmap_num_words(num_units);
+    const size_t num_summary_words = (num_words + 63) / 64;
+    return (num_words + 2 * num_summary_words) * sizeof(uint64_t);
+}
+
+/**
+ * Initializes a heap that allocates contiguous runs of fixed-size units.
+ *
+ * Every unit has a bit in the bitmap, set when the unit is used. Every bitmap
+ * word has a bit in each of the two summary words: `any_free` is set when the
+ * word has a free unit and `all_free` is set when all of its units are free.
+ * The summaries let the scans skip over 4096 used or free units at a time.
+ *
+ * Unlike the buddy heap, a run is not rounded up to a power of two, so the
+ * only internal fragmentation is the rounding of a request up to a whole
+ * number of units.
+ *
+ * @param heap      Heap structure pointer.
+ * @param start     Start of the heap region.
+ * @param size      Size of the heap region.
+ * @param unit_size Size of a unit, a power of two.
+ * @param meta      Metadata storage, aligned at 8 bytes.
+ * @param meta_size Size of @a meta, see #alloc_bitmap_meta_size().
+ */
+void alloc_bitmap_init(alloc_bitmap_t *heap, void *start, size_t size,
+                       size_t unit_size, void *meta, size_t meta_size) {
+    ASSERT_ALWAYS(heap != NULL);
+    ASSERT_ALWAYS(start != NULL);
+    ASSERT_ALWAYS(meta != NULL);
+    ASSERTF_ALWAYS(unit_size > 0 && (unit_size & (unit_size - 1)) == 0,
+                   "unit_size %zu must be a power of two", unit_size);
+    ASSERT_ALWAYS(size >= unit_size);
+    ASSERTF_ALWAYS((uintptr_t)meta % sizeof(uint64_t) == 0,
+                   "meta must be aligned at %zu", sizeof(uint64_t));
+
+    const size_t num_units = size / unit_size;
+    const size_t need_meta_size = alloc_bitmap_meta_size(num_units);
+    ASSERTF_ALWAYS(meta_size >= need_meta_size, "meta_size must be >= %zu",
+                   need_meta_size);
+
+    memset(heap, 0, sizeof(*heap));
+    heap->start = (uintptr_t)start;
+    heap->end = heap->start + size;
+    heap->unit_shift = alloc_calc_log2(unit_size);
+    heap->num_units = num_units;
+    heap->num_words = prv_alloc_bitmap_num_words(num_units);
+    heap->num_summary_words = (heap->num_words + 63) / 64;
+    heap->bitmap = meta;
+    heap->any_free = heap->bitmap + heap->num_words;
+    heap->all_free = heap->any_free + heap->num_summary_words;
+
+    // The bits past the last unit are marked used, so that they are never
+    // found by the scans.
+    memset(heap->bitmap, 0, need_meta_size);
+    if (num_units % 64 != 0) {
+        heap->bitmap[heap->num_words - 1] = ~(uint64_t)0 << (num_units % 64);
+    }
+    for (size_t word = 0; word < heap->num_words; word++) {
+        prv_alloc_bitmap_update_summary(heap, word);
+    }
+
+    alloc_registry_note(ALLOC_KIND_BITMAP, heap, start, size);
+}
+
+/**
+ * Allocates a run of contiguous units.
+ *
+ * The search is next-fit: it starts after the previous allocation and wraps
+ * around once. Each pass reads every bitmap word at most once and skips the
+ * used words 64 at a time using the summary, so an allocation costs at most
+ * `2 * num_units / 64` word reads, and `2 * num_units / 4096` summary reads
+ * when the heap is full.
+ *
+ * @param heap Heap structure pointer.
+ * @param size Size of the allocation in bytes, rounded up to whole units.
+ *
+ * @returns The start of the run or `NULL` if there is no free run long enough.
+ */
+void *alloc_bitmap(alloc_bitmap_t *heap, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_BITMAP, t0, NULL, size, 0);
+        return NULL;
+    }
+    const size_t n = prv_alloc_bitmap_num_units(heap, size);
+
+    size_t first = SIZE_MAX;
+    if (n <= heap->num_units - heap->num_used) {
+        first = prv_alloc_bitmap_find_run(heap, heap->hint, n);
+        if (first == SIZE_MAX && heap->hint != 0) {
+            first = prv_alloc_bitmap_find_run(heap, 0, n);
+        }
+    }
+    if (first == SIZE_MAX) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_BITMAP, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    prv_alloc_bitmap_mark(heap, first, n, true);
+    heap->num_used += n;
+    heap->hint = first + n < heap->num_units ? first + n : 0;
+
+    void *const ptr = (void *)(heap->start + (first << heap->unit_shift));
+    ALLOC_STATS_ALLOC(ALLOC_KIND_BITMAP, t0, ptr, size, n << heap->unit_shift);
+    return ptr;
+}
+
+/**
+ * Frees a run allocated by #alloc_bitmap().
+ *
+ * @param heap Heap structure pointer.
+ * @param ptr  Start of the run.
+ * @param size Size that was passed to #alloc_bitmap().
+ */
+void alloc_bitmap_free(alloc_bitmap_t *heap, void *ptr, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+    ASSERTF_DEBUG(alloc_registry_owns(heap, ptr),
+                  "%p is in a region of another heap", ptr);
+    ALLOC_STATS_START(t0);
+
+    const size_t first = prv_alloc_bitmap_index(heap, ptr);
+    const size_t n = prv_alloc_bitmap_num_units(heap, size);
+    ASSERTF_ALWAYS(n > 0 && first + n <= heap->num_units,
+                   "run of %zu units at %p is outside the heap", n, ptr);
+
+    prv_alloc_bitmap_mark(heap, first, n, false);
+    heap->num_used -= n;
+    ALLOC_STATS_FREE(ALLOC_KIND_BITMAP, t0, 1, n << heap->unit_shift);
+}
+
+void alloc_bitmap_set_lock(alloc_bitmap_t *heap, const alloc_lock_t *lock) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
+
+void *alloc_bitmap_locked(alloc_bitmap_t *heap, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    if (size == 0) { return NULL; }
+
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = alloc_bitmap(heap, size);
+    alloc_lock_release(heap->lock);
+
+    return ptr;
+}
+
+void alloc_bitmap_free_locked(alloc_bitmap_t *heap, void *ptr, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+
+    alloc_lock_acquire(heap->lock);
+    alloc_bitmap_free(heap, ptr, size);
+    alloc_lock_release(heap->lock);
+}
+
+bool alloc_bitmap_is_used(const alloc_bitmap_t *heap, const void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    const size_t idx = prv_alloc_bitmap_index(heap, ptr);
+    return (heap->bitmap[idx / 64] & ((uint64_t)1 << (idx % 64))) != 0;
+}
+
+size_t alloc_bitmap_num_free(const alloc_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->num_units - heap->num_used;
+}
+
+size_t alloc_bitmap_num_used(const alloc_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->num_used;
+}
+
+size_t alloc_bitmap_num_units(const alloc_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->num_units;
+}
+
+/**
+ * Measures the external fragmentation of the heap.
+ *
+ * Any run of at most `largest_free_run` units is guaranteed to be allocated.
+ * The heap is not fragmented when there is at most one free run.
+ *
+ * @param heap Heap structure pointer.
+ * @param out  Receives the number of free units, the number of free runs and
+ *             the length of the largest one.
+ */
+void alloc_bitmap_frag(const alloc_bitmap_t *heap, alloc_bitmap_frag_t *out) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(out != NULL);
+
+    memset(out, 0, sizeof(*out));
+    out->num_free = heap->num_units - heap->num_used;
+
+    size_t run = 0;
+    for (size_t idx = 0; idx < heap->num_words; idx++) {
+        const uint64_t word = heap->bitmap[idx];
+        if (word == 0) {
+            if (run == 0) { out->num_free_runs++; }
+            run += 64;
+            continue;
+        }
+
+        size_t bit = 0;
+        while (bit < 64) {
+            const uint64_t above = ~(uint64_t)0 << bit;
+            if (word & ((uint64_t)1 << bit)) {
+                if (run > out->largest_free_run) {
+                    out->largest_free_run = run;
+                }
+                run = 0;
+
+                const uint64_t free_above = ~word & above;
+                if (free_above == 0) { break; }
+                bit = (size_t)__builtin_ctzll(free_above);
+            } else {
+                const uint64_t used_above = word & above;
+                const size_t stop =
+                    used_above ? (size_t)__builtin_ctzll(used_above) : 64;
+                if (run == 0) { out->num_free_runs++; }
+                run += stop - bit;
+                bit = stop;
+            }
+        }
+    }
+    if (run > out->largest_free_run) { out->largest_free_run = run; }
+}
+
+static size_t prv_alloc_bitmap_num_words(size_t num_units) {
+    return (num_units + 63) / 64;
+}
+
+/**
+ * Converts a run pointer to its first unit index, checking that it points at
+ * a unit.
+ */
+static size_t prv_alloc_bitmap_index(const alloc_bitmap_t *heap,
+                                     const void *ptr) {
+    const uintptr_t addr = (uintptr_t)ptr;
+    ASSERTF_ALWAYS(heap->start <= addr &&
+                       addr < heap->start +
+                                  (heap->num_units << heap->unit_shift),
+                   "ptr %p is outside the heap", ptr);
+
+    const uintptr_t offset = addr - heap->start;
+    ASSERTF_DEBUG((offset & (((uintptr_t)1 << heap->unit_shift) - 1)) == 0,
+                  "ptr %p does not point at the start of a unit", ptr);
+
+    return offset >> heap->unit_shift;
+}
+
+static size_t prv_alloc_bitmap_num_units(const alloc_bitmap_t *heap,
+                                         size_t size) {
+    const size_t unit_mask = ((size_t)1 << heap->unit_shift) - 1;
+    if (size > SIZE_MAX - unit_mask) { return SIZE_MAX; }
+    return (size + unit_mask) >> heap->unit_shift;
+}
+
+/**
+ * Finds the first run of @a n free units that starts at or after @a from.
+ *
+ * @returns The index of the first unit of the run or `SIZE_MAX`.
+ */
+static size_t prv_alloc_bitmap_find_run(const alloc_bitmap_t *heap,
+                                        size_t from, size_t n) {
+    size_t run_start = 0;
+    size_t run_len = 0;
+
+    size_t idx = from / 64;
+    // The units below `from` are treated as used.
+    uint64_t word = heap->bitmap[idx] | ~(~(uint64_t)0 << (from % 64));
+
+    while (true) {
+        if (word == ~(uint64_t)0) {
+            run_len = 0;
+            idx = prv_alloc_bitmap_next_nonfull(heap, idx + 1);
+            if (idx == SIZE_MAX) { return SIZE_MAX; }
+            word = heap->bitmap[idx];
+            continue;
+        }
+
+        if (word == 0) {
+            const size_t num_empty = prv_alloc_bitmap_count_empty(heap, idx);
+            if (run_len == 0) { run_start = idx * 64; }
+            run_len += 64 * num_empty;
+            if (run_len >= n) { return run_start; }
+
+            idx += num_empty;
+            if (idx == heap->num_words) { return SIZE_MAX; }
+            word = heap->bitmap[idx];
+            continue;
+        }
+
+        // The word has both free and used units. A run may continue into its
+        // low units, lie inside it, or start at its high units.
+        const size_t low_free = (size_t)__builtin_ctzll(word);
+        if (run_len != 0 && run_len + low_free >= n) { return run_start; }
+        if (n <= 64) {
+            const size_t bit = prv_alloc_bitmap_word_find_run(word, n);
+            if (bit != 64) { return idx * 64 + bit; }
+        }
+        run_len = (size_t)__builtin_clzll(word);
+        run_start = idx * 64 + 64 - run_len;
+
+        if (++idx == heap->num_words) { return SIZE_MAX; }
+        word = heap->bitmap[idx];
+    }
+}
+
+/**
+ * Returns the index of the first bitmap word at or after @a word that has a
+ * free unit, or `SIZE_MAX`.
+ */
+static size_t prv_alloc_bitmap_next_nonfull(const alloc_bitmap_t *heap,
+                                            size_t word) {
+    if (word >= heap->num_words) { return SIZE_MAX; }
+
+    const size_t summary = word / 64;
+    const uint64_t bits = heap->any_free[summary] & (~(uint64_t)0 << word % 64);
+    if (bits != 0) { return summary * 64 + (size_t)__builtin_ctzll(bits); }
+
+    return bitmap_find_one(heap->any_free, summary + 1,
+                           heap->num_summary_words);
+}
+
+/**
+ * Returns the number of consecutive all-free bitmap words starting at
+ * @a word, which must be all-free, up to the end of its summary word.
+ */
+static size_t prv_alloc_bitmap_count_empty(const alloc_bitmap_t *heap,
+                                           size_t word) {
+    const uint64_t bits = heap->all_free[word / 64] >> (word % 64);
+    ASSERT_DEBUG((bits & 1) != 0);
+    if (bits == ~(uint64_t)0) { return 64; }
+    return (size_t)__builtin_ctzll(~bits);
+}
+
+/**
+ * Returns the position of the lowest run of @a n free bits in @a word, or 64.
+ * @a n must be between 1 and 64.
+ */
+static size_t prv_alloc_bitmap_word_find_run(uint64_t word, size_t n) {
+    // After this, bit `i` is set if the bits `[i, i + n)` are all free.
+    uint64_t starts = ~word;
+    for (size_t len = 1; len < n && starts != 0;) {
+        const size_t shift = len < n - len ? len : n - len;
+        starts &= starts >> shift;
+        len += shift;
+    }
+    return starts ? (size_t)__builtin_ctzll(starts) : 64;
+}
+
+/**
+ * Marks the units `[first, first + n)` as used or free. Freeing checks that
+ * all of them are used before changing anything.
+ */
+static void prv_alloc_bitmap_mark(alloc_bitmap_t *heap, size_t first,
+                                  size_t n, bool used) {
+    const size_t end = first + n;
+
+    if (!used) {
+        for (size_t idx = first; idx < end;) {
+            const size_t bit = idx % 64;
+            const size_t count = 64 - bit < end - idx ? 64 - bit : end - idx;
+            const uint64_t mask = (~(uint64_t)0 >> (64 - count)) << bit;
+            ASSERTF_ALWAYS((heap->bitmap[idx / 64] & mask) == mask,
+                           "double free of a unit in [%zu, %zu)", first, end);
+            idx += count;
+        }
+    }
+
+    for (size_t idx = first; idx < end;) {
+        const size_t bit = idx % 64;
+        const size_t count = 64 - bit < end - idx ? 64 - bit : end - idx;
+        const uint64_t mask = (~(uint64_t)0 >> (64 - count)) << bit;
+        if (used) {
+            ASSERT_DEBUG((heap->bitmap[idx / 64] & mask) == 0);
+            heap->bitmap[idx / 64] |= mask;
+        } else {
+            heap->bitmap[idx / 64] &= ~mask;
+        }
+        prv_alloc_bitmap_update_summary(heap, idx / 64);
+        idx += count;
+    }
+}
+
+static void prv_alloc_bitmap_update_summary(alloc_bitmap_t *heap,
+                                            size_t word) {
+    const uint64_t bit = (uint64_t)1 << (word % 64);
+    uint64_t *const any_free = &heap->any_free[word / 64];
+    uint64_t *const all_free = &heap->all_free[word / 64];
+
+    if (heap->bitmap[word] != ~(uint64_t)0) {
+        *any_free |= bit;
+    } else {
+        *any_free &= ~bit;
+    }
+    if (heap->bitmap[word] == 0) {
+        *all_free |= bit;
+    } else {
+        *all_free &= ~bit;
+    }
+}
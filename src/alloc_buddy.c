@@ -1,12 +1,19 @@
 #include <string.h>
 #include <ytalloc/ytalloc.h>
 
+#include "alloc_lock.h"
 #include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
 #include "aux/auxmath.h"
 
 typedef struct alloc_buddy_tag {
     struct alloc_buddy_tag *prev;
     struct alloc_buddy_tag *next;
+
+    // The usage bitmap only tells whether a block *starts* at an address, so
+    // the order of a free block is kept here to decide if it can be merged.
+    size_t order;
 } alloc_buddy_tag_t;
 
 static size_t prv_alloc_calc_num_orders(size_t heap_size,
@@ -26,6 +33,20 @@ static uintptr_t prv_alloc_get_buddy(const alloc_buddy_t *heap, uintptr_t block,
 static bool prv_alloc_is_block_used(const alloc_buddy_t *heap, uintptr_t block);
 static void prv_alloc_set_block_used(alloc_buddy_t *heap, uintptr_t block,
                                      bool used);
+static void *prv_alloc_buddy_note_order(alloc_buddy_t *heap, void *block,
+                                        size_t order);
+static void prv_alloc_buddy_dirty(alloc_buddy_t *heap, uintptr_t block,
+                                  size_t num_blocks);
+
+static void *prv_alloc_buddy_ops_alloc(void *heap, size_t size);
+static void *prv_alloc_buddy_ops_aligned_alloc(void *heap, size_t size,
+                                               size_t align);
+static void prv_alloc_buddy_ops_free(void *heap, void *ptr, size_t size);
+static size_t prv_alloc_buddy_ops_usable_size(const void *heap,
+                                              const void *ptr, size_t size);
+static void prv_alloc_buddy_ops_stats(const void *heap,
+                                      alloc_ops_stats_t *out);
+static void prv_alloc_buddy_ops_reset(void *heap);
 
 void alloc_buddy_init(alloc_buddy_t *heap, void *v_start, size_t size,
                       void *free_heads, size_t free_heads_size, void *bitmap,
@@ -75,51 +96,207 @@ void alloc_buddy_init(alloc_buddy_t *heap, void *v_start, size_t size,
     alloc_buddy_tag_t *const biggest_block = v_start;
     biggest_block->prev = NULL;
     biggest_block->next = NULL;
+    biggest_block->order = num_orders - 1;
     ASSERT_DEBUG(num_orders > 0);
     heap->free_heads[num_orders - 1] = (uintptr_t)biggest_block;
+
+    alloc_registry_note(ALLOC_KIND_BUDDY, heap, v_start, size);
 }
 
 void *alloc_buddy(alloc_buddy_t *heap, size_t size) {
     ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
 
-    if (size == 0) { return NULL; }
-    if (size > heap->used_size) { return NULL; }
+    if (size == 0 || size > heap->used_size) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, NULL, size, 0);
+        return NULL;
+    }
 
     const size_t order = prv_alloc_calc_block_order(heap, size);
-    return prv_alloc_get_free_block(heap, order);
+    void *const ptr = prv_alloc_buddy_note_order(
+        heap, prv_alloc_get_free_block(heap, order), order);
+    ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, ptr, size,
+                      heap->min_block_size << order);
+    return ptr;
 }
 
 void *alloc_buddy_aligned(alloc_buddy_t *heap, size_t size, size_t align) {
     ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
 
-    if (size == 0) { return NULL; }
-    if (size > heap->used_size) { return NULL; }
+    if (size == 0 || size > heap->used_size) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, NULL, size, 0);
+        return NULL;
+    }
 
     const size_t size_order = prv_alloc_calc_block_order(heap, size);
     const size_t align_order = prv_alloc_calc_block_order(heap, align);
-    return prv_alloc_get_free_aligned_block(heap, size_order, align_order);
+    void *const ptr = prv_alloc_buddy_note_order(
+        heap, prv_alloc_get_free_aligned_block(heap, size_order, align_order),
+        size_order);
+    ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, ptr, size,
+                      heap->min_block_size << size_order);
+    return ptr;
 }
 
 void alloc_buddy_free(alloc_buddy_t *heap, void *ptr, size_t size) {
     ASSERT_DEBUG(heap != NULL);
     if (!ptr) { return; }
+    ASSERTF_DEBUG(alloc_registry_owns(heap, ptr),
+                  "%p is in a region of another heap", ptr);
 
     const uintptr_t block = (uintptr_t)ptr;
     ASSERTF_DEBUG(heap->start <= (uintptr_t)block && (uintptr_t)ptr < heap->end,
                   "%s", "ptr is outside the heap");
 
+    ALLOC_STATS_START(t0);
     const size_t order = prv_alloc_calc_block_order(heap, size);
     ASSERT_DEBUG(order < heap->num_orders);
+    ASSERTF_DEBUG(!heap->order_map ||
+                      heap->order_map[(block - heap->start) /
+                                      heap->min_block_size] == order,
+                  "%p is freed with a size of another order", ptr);
 
     const bool block_is_used = prv_alloc_is_block_used(heap, block);
     ASSERT_ALWAYS(block_is_used);
     prv_alloc_set_block_used(heap, block, false);
+    prv_alloc_buddy_dirty(heap, block, (size_t)1 << order);
 
     alloc_buddy_tag_t *const tag = (alloc_buddy_tag_t *)block;
     tag->prev = NULL;
     tag->next = NULL;
 
     prv_alloc_add_free_block(heap, block, order);
+    ALLOC_STATS_FREE(ALLOC_KIND_BUDDY, t0, 1, heap->min_block_size << order);
+}
+
+/**
+ * Allocates up to @a n blocks that fit @a size at once.
+ *
+ * @param heap Heap structure pointer.
+ * @param size Size of each allocation.
+ * @param out  Array of at least @a n pointers that receives the blocks.
+ * @param n    Number of blocks to allocate.
+ *
+ * @returns The number of blocks stored in @a out. It is less than @a n only if
+ * the heap has run out of blocks of that size.
+ */
+size_t alloc_buddy_bulk(alloc_buddy_t *heap, size_t size, void **out,
+                        size_t n) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(out != NULL || n == 0);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > heap->used_size) {
+        ALLOC_STATS_BULK(ALLOC_KIND_BUDDY, t0, n, 0, size, 0);
+        return 0;
+    }
+
+    const size_t order = prv_alloc_calc_block_order(heap, size);
+    size_t cnt = 0;
+    while (cnt < n) {
+        void *const block = prv_alloc_buddy_note_order(
+            heap, prv_alloc_get_free_block(heap, order), order);
+        if (!block) { break; }
+        out[cnt++] = block;
+    }
+    ALLOC_STATS_BULK(ALLOC_KIND_BUDDY, t0, n, cnt, size,
+                     heap->min_block_size << order);
+    return cnt;
+}
+
+/**
+ * Frees @a n blocks that were allocated with the same @a size.
+ */
+void alloc_buddy_free_bulk(alloc_buddy_t *heap, void **ptrs, size_t n,
+                           size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(ptrs != NULL || n == 0);
+
+    for (size_t idx = 0; idx < n; idx++) {
+        ASSERT_DEBUG(ptrs[idx] != NULL);
+        alloc_buddy_free(heap, ptrs[idx], size);
+    }
+}
+
+void alloc_buddy_set_lock(alloc_buddy_t *heap, const alloc_lock_t *lock) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
+
+void *alloc_buddy_locked(alloc_buddy_t *heap, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > heap->used_size) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    const size_t order = prv_alloc_calc_block_order(heap, size);
+
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = prv_alloc_buddy_note_order(
+        heap, prv_alloc_get_free_block(heap, order), order);
+    alloc_lock_release(heap->lock);
+
+    ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, ptr, size,
+                      heap->min_block_size << order);
+    return ptr;
+}
+
+void *alloc_buddy_aligned_locked(alloc_buddy_t *heap, size_t size,
+                                 size_t align) {
+    ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > heap->used_size) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    const size_t size_order = prv_alloc_calc_block_order(heap, size);
+    const size_t align_order = prv_alloc_calc_block_order(heap, align);
+
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = prv_alloc_buddy_note_order(
+        heap, prv_alloc_get_free_aligned_block(heap, size_order, align_order),
+        size_order);
+    alloc_lock_release(heap->lock);
+
+    ALLOC_STATS_ALLOC(ALLOC_KIND_BUDDY, t0, ptr, size,
+                      heap->min_block_size << size_order);
+    return ptr;
+}
+
+void alloc_buddy_free_locked(alloc_buddy_t *heap, void *ptr, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+
+    alloc_lock_acquire(heap->lock);
+    alloc_buddy_free(heap, ptr, size);
+    alloc_lock_release(heap->lock);
+}
+
+size_t alloc_buddy_bulk_locked(alloc_buddy_t *heap, size_t size, void **out,
+                               size_t n) {
+    ASSERT_DEBUG(heap != NULL);
+
+    alloc_lock_acquire(heap->lock);
+    const size_t cnt = alloc_buddy_bulk(heap, size, out, n);
+    alloc_lock_release(heap->lock);
+
+    return cnt;
+}
+
+void alloc_buddy_free_bulk_locked(alloc_buddy_t *heap, void **ptrs, size_t n,
+                                  size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    if (n == 0) { return; }
+
+    alloc_lock_acquire(heap->lock);
+    alloc_buddy_free_bulk(heap, ptrs, n, size);
+    alloc_lock_release(heap->lock);
 }
 
 size_t alloc_buddy_order0_size(const alloc_buddy_t *heap) {
@@ -144,6 +321,145 @@ size_t alloc_buddy_count_free(const alloc_buddy_t *heap, uint8_t order) {
     return cnt;
 }
 
+/**
+ * Sets the map that records the order of every allocated block, so that
+ * #alloc_buddy_usable_size() can tell the size of a block by its address alone.
+ * Blocks allocated before the map is set are not recorded.
+ *
+ * @param heap     Heap structure pointer.
+ * @param map      One byte per order 0 block, see #alloc_buddy_heap_size() and
+ *                 #alloc_buddy_order0_size(). May be `NULL` to unset the map.
+ * @param map_size Size of @a map.
+ */
+void alloc_buddy_set_order_map(alloc_buddy_t *heap, void *map,
+                               size_t map_size) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_ALWAYS(!map || map_size >= heap->used_size / heap->min_block_size,
+                   "map_size must be >= %zu",
+                   heap->used_size / heap->min_block_size);
+    heap->order_map = map;
+}
+
+/**
+ * Same as #alloc_buddy(), but also tells the size of the block, which is
+ * @a size rounded up to a power of two and to the order 0 block size. The whole
+ * block may be used, but it must be freed with the size stored in
+ * @a out_size or with the original @a size.
+ *
+ * @param heap     Heap structure pointer.
+ * @param size     Minimum size of the block.
+ * @param out_size Receives the block size if the allocation succeeds.
+ */
+void *alloc_buddy_at_least(alloc_buddy_t *heap, size_t size,
+                           size_t *out_size) {
+    ASSERT_DEBUG(out_size != NULL);
+
+    void *const ptr = alloc_buddy(heap, size);
+    if (ptr) {
+        *out_size = heap->min_block_size
+                    << prv_alloc_calc_block_order(heap, size);
+    }
+    return ptr;
+}
+
+/**
+ * Returns the size of the block at @a ptr. The heap must have an order map,
+ * see #alloc_buddy_set_order_map().
+ */
+size_t alloc_buddy_usable_size(const alloc_buddy_t *heap, const void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_ALWAYS(heap->order_map != NULL, "%s", "the heap has no order map");
+
+    const uintptr_t block = (uintptr_t)ptr;
+    ASSERTF_DEBUG(heap->start <= block && block < heap->end, "%s",
+                  "ptr is outside the heap");
+    ASSERT_DEBUG(prv_alloc_is_block_used(heap, block));
+
+    const size_t idx = (block - heap->start) / heap->min_block_size;
+    return heap->min_block_size << heap->order_map[idx];
+}
+
+/**
+ * Tells the heap that its region is zero-filled, e.g. because it was just
+ * mapped with `mmap()`, so that #alloc_buddy_calloc() can skip clearing the
+ * order 0 blocks that have never been handed out. Must be called before
+ * anything is allocated.
+ *
+ * The heap keeps track of such blocks in @a map. Blocks that hold a free list
+ * tag, and blocks that are freed, are no longer known to be zero.
+ *
+ * @param heap     Heap structure pointer.
+ * @param map      One bit per order 0 block, see #alloc_buddy_heap_size() and
+ *                 #alloc_buddy_order0_size().
+ * @param map_size Size of @a map.
+ */
+void alloc_buddy_set_zeroed(alloc_buddy_t *heap, void *map, size_t map_size) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_ALWAYS(map != NULL);
+    const size_t num_blocks = heap->used_size / heap->min_block_size;
+    ASSERTF_ALWAYS(map_size >= (num_blocks + 7) / 8,
+                   "map_size must be >= %zu", (num_blocks + 7) / 8);
+    for (size_t idx = 0; idx < heap->bitmap_size; idx++) {
+        ASSERTF_ALWAYS(heap->usage_bitmap[idx] == 0, "%s",
+                       "the heap has allocated blocks");
+    }
+
+    memset(map, 0xff, map_size);
+    heap->zero_map = map;
+
+    for (size_t order = 0; order < heap->num_orders; order++) {
+        for (const alloc_buddy_tag_t *tag =
+                 (const alloc_buddy_tag_t *)heap->free_heads[order];
+             tag != NULL; tag = tag->next) {
+            prv_alloc_buddy_dirty(heap, (uintptr_t)tag, 1);
+        }
+    }
+}
+
+/**
+ * Allocates a zero-filled array of @a num elements of @a size bytes.
+ *
+ * If the heap has a zero map (see #alloc_buddy_set_zeroed()), only the order 0
+ * blocks that may have been written are cleared. For a big buffer in a fresh
+ * mapping, that is just its first block, so the rest of it is not faulted in.
+ *
+ * @returns The block, which must be freed with size `num * size`, or `NULL`
+ * if the size overflows or there is no free block that fits.
+ */
+void *alloc_buddy_calloc(alloc_buddy_t *heap, size_t num, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+
+    size_t total;
+    if (__builtin_mul_overflow(num, size, &total)) { return NULL; }
+
+    uint8_t *const ptr = alloc_buddy(heap, total);
+    if (!ptr) { return NULL; }
+    if (!heap->zero_map) {
+        memset(ptr, 0, total);
+        return ptr;
+    }
+
+    const size_t first = ((uintptr_t)ptr - heap->start) / heap->min_block_size;
+    for (size_t off = 0; off < total; off += heap->min_block_size) {
+        const size_t idx = first + off / heap->min_block_size;
+        if (heap->zero_map[idx / 8] & (1u << (idx % 8))) { continue; }
+        const size_t rest = total - off;
+        memset(ptr + off, 0,
+               rest < heap->min_block_size ? rest : heap->min_block_size);
+    }
+    return ptr;
+}
+
+const alloc_ops_t alloc_buddy_ops = {
+    .name = "buddy",
+    .alloc = prv_alloc_buddy_ops_alloc,
+    .aligned_alloc = prv_alloc_buddy_ops_aligned_alloc,
+    .free = prv_alloc_buddy_ops_free,
+    .usable_size = prv_alloc_buddy_ops_usable_size,
+    .stats = prv_alloc_buddy_ops_stats,
+    .reset = prv_alloc_buddy_ops_reset,
+};
+
 static size_t prv_alloc_calc_num_orders(size_t heap_size,
                                         size_t *out_min_block_size) {
     ASSERT_DEBUG((heap_size & (heap_size - 1)) == 0);
@@ -204,7 +520,9 @@ static void *prv_alloc_get_free_block(alloc_buddy_t *heap, size_t order) {
         alloc_buddy_tag_t *const buddy_tag = (alloc_buddy_tag_t *)buddy;
         buddy_tag->prev = NULL;
         buddy_tag->next = NULL;
+        buddy_tag->order = order;
         prv_alloc_set_block_used(heap, buddy, false);
+        prv_alloc_buddy_dirty(heap, buddy, 1);
         heap->free_heads[order] = (uintptr_t)buddy_tag;
 
         return higher_block;
@@ -299,13 +617,17 @@ static void prv_alloc_add_free_block(alloc_buddy_t *heap, uintptr_t block,
     // Zero initialize the pointers. The actual values are set below.
     tag->prev = NULL;
     tag->next = NULL;
+    tag->order = order;
+    prv_alloc_buddy_dirty(heap, block, 1);
 
     if (has_buddy) {
         const uintptr_t buddy = prv_alloc_get_buddy(heap, block, order);
         const alloc_buddy_tag_t *const buddy_tag =
             (const alloc_buddy_tag_t *)buddy;
 
-        if (prv_alloc_is_block_used(heap, buddy)) {
+        // A buddy that is split has a smaller block at its start.
+        if (prv_alloc_is_block_used(heap, buddy) ||
+            buddy_tag->order != order) {
             alloc_buddy_tag_t *const head =
                 (alloc_buddy_tag_t *)heap->free_heads[order];
             if (head) { head->prev = tag; }
@@ -370,3 +692,103 @@ static void prv_alloc_set_block_used(alloc_buddy_t *heap, uintptr_t block,
         heap->usage_bitmap[byte_pos] &= ~(1 << bit_pos);
     }
 }
+
+static void *prv_alloc_buddy_note_order(alloc_buddy_t *heap, void *block,
+                                        size_t order) {
+    if (block && heap->order_map) {
+        const size_t idx =
+            ((uintptr_t)block - heap->start) / heap->min_block_size;
+        heap->order_map[idx] = order;
+    }
+    return block;
+}
+
+/**
+ * Clears the zero bits of @a num_blocks order 0 blocks starting at @a block.
+ */
+static void prv_alloc_buddy_dirty(alloc_buddy_t *heap, uintptr_t block,
+                                  size_t num_blocks) {
+    if (!heap->zero_map) { return; }
+
+    const size_t first = (block - heap->start) / heap->min_block_size;
+    for (size_t idx = first; idx < first + num_blocks; idx++) {
+        heap->zero_map[idx / 8] &= ~(1u << (idx % 8));
+    }
+}
+
+static void *prv_alloc_buddy_ops_alloc(void *heap, size_t size) {
+    return alloc_buddy(heap, size);
+}
+
+static void *prv_alloc_buddy_ops_aligned_alloc(void *heap, size_t size,
+                                               size_t align) {
+    return alloc_buddy_aligned(heap, size, align);
+}
+
+static void prv_alloc_buddy_ops_free(void *heap, void *ptr, size_t size) {
+    alloc_buddy_free(heap, ptr, size);
+}
+
+static size_t prv_alloc_buddy_ops_usable_size(const void *v_heap,
+                                              const void *ptr, size_t size) {
+    (void)ptr;
+    const alloc_buddy_t *const heap = v_heap;
+    return heap->min_block_size << prv_alloc_calc_block_order(heap, size);
+}
+
+static void prv_alloc_buddy_ops_stats(const void *v_heap,
+                                      alloc_ops_stats_t *out) {
+    const alloc_buddy_t *const heap = v_heap;
+    out->heap_size = heap->used_size;
+    out->free_size = 0;
+    for (size_t order = 0; order < heap->num_orders; order++) {
+        out->free_size += alloc_buddy_count_free(heap, order) *
+                          (heap->min_block_size << order);
+    }
+    out->used_size = out->heap_size - out->free_size;
+}
+
+/**
+ * Frees every block by initializing the heap again over the same region and
+ * metadata. The lock, the order map and the zero map are kept.
+ *
+ * The blocks still allocated may have been written, so they are marked dirty
+ * in the zero map first. Without an order map their sizes are unknown, and the
+ * whole heap is marked dirty instead.
+ */
+static void prv_alloc_buddy_ops_reset(void *v_heap) {
+    alloc_buddy_t *const heap = v_heap;
+#ifdef YTALLOC_STATS
+    alloc_ops_stats_t stats;
+    prv_alloc_buddy_ops_stats(heap, &stats);
+    if (stats.used_size != 0) {
+        ALLOC_STATS_FREE(ALLOC_KIND_BUDDY, 0, 1, stats.used_size);
+    }
+#endif
+    if (heap->zero_map) {
+        const size_t num_blocks = heap->used_size / heap->min_block_size;
+        for (size_t idx = 0; idx < num_blocks; idx++) {
+            if (!(heap->usage_bitmap[idx / 8] & (1u << (idx % 8)))) {
+                continue;
+            }
+            if (!heap->order_map) {
+                memset(heap->zero_map, 0, (num_blocks + 7) / 8);
+                break;
+            }
+            prv_alloc_buddy_dirty(heap,
+                                  heap->start + idx * heap->min_block_size,
+                                  (size_t)1 << heap->order_map[idx]);
+        }
+    }
+
+    const alloc_lock_t *const lock = heap->lock;
+    uint8_t *const order_map = heap->order_map;
+    uint8_t *const zero_map = heap->zero_map;
+    alloc_buddy_init(heap, (void *)heap->start, heap->end - heap->start,
+                     heap->free_heads, heap->num_orders * sizeof(uintptr_t),
+                     heap->usage_bitmap, heap->bitmap_size);
+    heap->lock = lock;
+    heap->order_map = order_map;
+    heap->zero_map = zero_map;
+    prv_alloc_buddy_dirty(heap, heap->start, 1);
+}
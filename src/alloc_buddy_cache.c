@@ -0,0 +1,138 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+
+static size_t prv_alloc_cache_order(const alloc_buddy_cache_t *cache,
+                                    size_t size);
+static size_t prv_alloc_cache_block_size(const alloc_buddy_cache_t *cache,
+                                         size_t order);
+
+/**
+ * Initializes a cache of small blocks in front of a shared buddy heap.
+ *
+ * The cache belongs to one thread (or CPU) and keeps up to @a high free blocks
+ * of each of the #YTALLOC_BUDDY_CACHE_ORDERS lowest orders. Allocations and
+ * frees of these orders do not touch the heap until the cache runs empty or
+ * full. Then it is refilled or drained to @a low blocks with one acquisition
+ * of the heap lock, see #alloc_buddy_set_lock().
+ *
+ * Cached blocks stay allocated as far as the heap is concerned. Call
+ * #alloc_buddy_cache_flush() to give them back.
+ *
+ * @param cache Cache structure pointer.
+ * @param heap  Buddy heap, shared by all caches.
+ * @param low   Number of blocks left after a refill or a drain, at least 1.
+ * @param high  Maximum number of cached blocks per order, greater than @a low
+ *              and at most #YTALLOC_BUDDY_CACHE_MAX.
+ */
+void alloc_buddy_cache_init(alloc_buddy_cache_t *cache, alloc_buddy_t *heap,
+                            size_t low, size_t high) {
+    ASSERT_ALWAYS(cache != NULL);
+    ASSERT_ALWAYS(heap != NULL);
+    ASSERTF_ALWAYS(0 < low && low < high,
+                   "bad watermarks: low %zu, high %zu", low, high);
+    ASSERTF_ALWAYS(high <= YTALLOC_BUDDY_CACHE_MAX, "high must be <= %d",
+                   YTALLOC_BUDDY_CACHE_MAX);
+
+    memset(cache, 0, sizeof(*cache));
+    cache->heap = heap;
+    cache->low = low;
+    cache->high = high;
+}
+
+/**
+ * Allocates a block from the cache, refilling it from the heap if it is empty.
+ *
+ * Sizes above the cached orders go to the heap directly.
+ */
+void *alloc_buddy_cache(alloc_buddy_cache_t *cache, size_t size) {
+    ASSERT_DEBUG(cache != NULL);
+    if (size == 0) { return NULL; }
+
+    const size_t order = prv_alloc_cache_order(cache, size);
+    if (order >= YTALLOC_BUDDY_CACHE_ORDERS) {
+        return alloc_buddy_locked(cache->heap, size);
+    }
+
+    void **const cached = cache->cached[order];
+    if (cache->num_cached[order] == 0) {
+        const size_t block_size = prv_alloc_cache_block_size(cache, order);
+        cache->num_cached[order] = alloc_buddy_bulk_locked(
+            cache->heap, block_size, cached, cache->low);
+        if (cache->num_cached[order] == 0) { return NULL; }
+    }
+
+    return cached[--cache->num_cached[order]];
+}
+
+/**
+ * Puts a block into the cache, draining the cache to the heap if it is full.
+ *
+ * The blocks that stay in the cache after a drain are the most recently freed
+ * ones, as they are the most likely to still be in the CPU cache.
+ */
+void alloc_buddy_cache_free(alloc_buddy_cache_t *cache, void *ptr,
+                            size_t size) {
+    ASSERT_DEBUG(cache != NULL);
+    if (!ptr) { return; }
+
+    const size_t order = prv_alloc_cache_order(cache, size);
+    if (order >= YTALLOC_BUDDY_CACHE_ORDERS) {
+        alloc_buddy_free_locked(cache->heap, ptr, size);
+        return;
+    }
+
+    void **const cached = cache->cached[order];
+    if (cache->num_cached[order] == cache->high) {
+        const size_t num_drain = cache->high - cache->low;
+        const size_t block_size = prv_alloc_cache_block_size(cache, order);
+        alloc_buddy_free_bulk_locked(cache->heap, cached, num_drain,
+                                     block_size);
+        memmove(cached, cached + num_drain, cache->low * sizeof(void *));
+        cache->num_cached[order] = cache->low;
+    }
+
+    cached[cache->num_cached[order]++] = ptr;
+}
+
+/**
+ * Gives all cached blocks back to the heap, for example when the owning thread
+ * exits.
+ */
+void alloc_buddy_cache_flush(alloc_buddy_cache_t *cache) {
+    ASSERT_DEBUG(cache != NULL);
+
+    for (size_t order = 0; order < YTALLOC_BUDDY_CACHE_ORDERS; order++) {
+        const size_t block_size = prv_alloc_cache_block_size(cache, order);
+        alloc_buddy_free_bulk_locked(cache->heap, cache->cached[order],
+                                     cache->num_cached[order], block_size);
+        cache->num_cached[order] = 0;
+    }
+}
+
+size_t alloc_buddy_cache_num_cached(const alloc_buddy_cache_t *cache,
+                                    size_t order) {
+    ASSERT_DEBUG(cache != NULL);
+    if (order >= YTALLOC_BUDDY_CACHE_ORDERS) { return 0; }
+    return cache->num_cached[order];
+}
+
+/**
+ * Returns the buddy order of @a size, or #YTALLOC_BUDDY_CACHE_ORDERS if it is
+ * too big to be cached.
+ */
+static size_t prv_alloc_cache_order(const alloc_buddy_cache_t *cache,
+                                    size_t size) {
+    size_t block_size = alloc_buddy_order0_size(cache->heap);
+    for (size_t order = 0; order < YTALLOC_BUDDY_CACHE_ORDERS; order++) {
+        if (size <= block_size) { return order; }
+        block_size *= 2;
+    }
+    return YTALLOC_BUDDY_CACHE_ORDERS;
+}
+
+static size_t prv_alloc_cache_block_size(const alloc_buddy_cache_t *cache,
+                                         size_t order) {
+    return alloc_buddy_order0_size(cache->heap) << order;
+}
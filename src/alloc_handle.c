@@ -0,0 +1,194 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_lock.h"
+#include "alloc_macros.h"
+
+#define ALLOC_HANDLE_INDEX_MASK ((UINT32_C(1) << YTALLOC_HANDLE_INDEX_BITS) - 1)
+#define ALLOC_HANDLE_GEN_MASK   (UINT32_MAX >> YTALLOC_HANDLE_INDEX_BITS)
+
+static_assert(YTALLOC_HANDLE_INDEX_BITS > 0 && YTALLOC_HANDLE_INDEX_BITS < 32);
+
+/**
+ * Returns the size of the metadata required by a pool of @a num_items items.
+ */
+size_t alloc_handle_pool_meta_size(size_t num_items) {
+    return 3 * sizeof(uint32_t) * num_items;
+}
+
+/**
+ * Initializes a pool of objects addressed by 32-bit generational handles.
+ *
+ * The objects are allocated from a slab heap built over @a start. The metadata
+ * holds a generation counter per item and a dense array of the live items.
+ *
+ * A generation is odd while its item is live and even while it is free, so a
+ * handle never compares equal to the generation of a free item. Handles are
+ * never `ALLOC_HANDLE_NULL`.
+ *
+ * @param pool       Pool structure pointer.
+ * @param start      Start of the object region, aligned at @a alloc_size.
+ * @param size       Size of the object region.
+ * @param alloc_size Size of an object.
+ * @param meta       Metadata storage, aligned at 4 bytes.
+ * @param meta_size  Size of @a meta, see #alloc_handle_pool_meta_size().
+ */
+void alloc_handle_pool_init(alloc_handle_pool_t *pool, void *start,
+                            size_t size, size_t alloc_size, void *meta,
+                            size_t meta_size) {
+    ASSERT_ALWAYS(pool != NULL);
+    ASSERT_ALWAYS(meta != NULL);
+    ASSERTF_ALWAYS((uintptr_t)meta % alignof(uint32_t) == 0,
+                   "meta must be aligned at %zu", alignof(uint32_t));
+
+    memset(pool, 0, sizeof(*pool));
+    alloc_slab_init(&pool->slab, start, size, alloc_size);
+
+    const size_t num_items = alloc_slab_num_items(&pool->slab);
+    ASSERTF_ALWAYS(num_items <= ALLOC_HANDLE_INDEX_MASK + (size_t)1,
+                   "too many items (%zu) for %d index bits", num_items,
+                   YTALLOC_HANDLE_INDEX_BITS);
+    const size_t need_meta_size = alloc_handle_pool_meta_size(num_items);
+    ASSERTF_ALWAYS(meta_size >= need_meta_size, "meta_size must be >= %zu",
+                   need_meta_size);
+
+    pool->generations = meta;
+    pool->dense = pool->generations + num_items;
+    pool->dense_pos = pool->dense + num_items;
+    memset(pool->generations, 0, sizeof(uint32_t) * num_items);
+}
+
+/**
+ * Allocates an object and returns its handle.
+ *
+ * @param pool    Pool structure pointer.
+ * @param out_ptr Optional pointer that receives the object address.
+ *
+ * @returns The object handle or `ALLOC_HANDLE_NULL` if the pool is full.
+ */
+alloc_handle_t alloc_handle(alloc_handle_pool_t *pool, void **out_ptr) {
+    ASSERT_DEBUG(pool != NULL);
+
+    void *const ptr = alloc_slab(&pool->slab);
+    if (!ptr) {
+        if (out_ptr) { *out_ptr = NULL; }
+        return ALLOC_HANDLE_NULL;
+    }
+
+    const uint32_t idx =
+        (uint32_t)(((uintptr_t)ptr - pool->slab.start) / pool->slab.alloc_size);
+    const uint32_t gen = (pool->generations[idx] + 1) & ALLOC_HANDLE_GEN_MASK;
+    ASSERT_DEBUG(gen % 2 == 1);
+    pool->generations[idx] = gen;
+
+    pool->dense[pool->num_live] = idx;
+    pool->dense_pos[idx] = (uint32_t)pool->num_live;
+    pool->num_live++;
+
+    if (out_ptr) { *out_ptr = ptr; }
+    return (gen << YTALLOC_HANDLE_INDEX_BITS) | idx;
+}
+
+/**
+ * Frees the object referenced by @a handle.
+ *
+ * The last object of the dense array takes the place of the freed one, so
+ * iterate backwards when freeing objects during iteration.
+ *
+ * Aborts if @a handle is stale.
+ */
+void alloc_handle_free(alloc_handle_pool_t *pool, alloc_handle_t handle) {
+    ASSERT_DEBUG(pool != NULL);
+
+    void *const ptr = alloc_handle_get(pool, handle);
+    ASSERTF_ALWAYS(ptr != NULL, "stale or invalid handle 0x%08x", handle);
+
+    const uint32_t idx = handle & ALLOC_HANDLE_INDEX_MASK;
+    pool->generations[idx] = (pool->generations[idx] + 1) &
+                             ALLOC_HANDLE_GEN_MASK;
+
+    const uint32_t pos = pool->dense_pos[idx];
+    const uint32_t last_idx = pool->dense[pool->num_live - 1];
+    pool->dense[pos] = last_idx;
+    pool->dense_pos[last_idx] = pos;
+    pool->num_live--;
+
+    alloc_slab_free(&pool->slab, ptr);
+}
+
+/**
+ * Sets the lock of the `_locked` entry points of @a pool.
+ *
+ * #alloc_handle_get() does not take the lock. It may run concurrently with the
+ * allocation and freeing of other handles.
+ */
+void alloc_handle_pool_set_lock(alloc_handle_pool_t *pool,
+                                const alloc_lock_t *lock) {
+    ASSERT_DEBUG(pool != NULL);
+    pool->lock = lock;
+}
+
+alloc_handle_t alloc_handle_locked(alloc_handle_pool_t *pool,
+                                   void **out_ptr) {
+    ASSERT_DEBUG(pool != NULL);
+
+    alloc_lock_acquire(pool->lock);
+    const alloc_handle_t handle = alloc_handle(pool, out_ptr);
+    alloc_lock_release(pool->lock);
+
+    return handle;
+}
+
+void alloc_handle_free_locked(alloc_handle_pool_t *pool,
+                              alloc_handle_t handle) {
+    ASSERT_DEBUG(pool != NULL);
+
+    alloc_lock_acquire(pool->lock);
+    alloc_handle_free(pool, handle);
+    alloc_lock_release(pool->lock);
+}
+
+/**
+ * Resolves @a handle to the object address.
+ *
+ * @returns The object address or `NULL` if @a handle is stale or invalid.
+ */
+void *alloc_handle_get(const alloc_handle_pool_t *pool,
+                       alloc_handle_t handle) {
+    ASSERT_DEBUG(pool != NULL);
+
+    const uint32_t idx = handle & ALLOC_HANDLE_INDEX_MASK;
+    const uint32_t gen = handle >> YTALLOC_HANDLE_INDEX_BITS;
+    if (idx >= pool->slab.num_items) { return NULL; }
+    if (gen % 2 == 0 || pool->generations[idx] != gen) { return NULL; }
+
+    return (void *)(pool->slab.start + (uintptr_t)idx * pool->slab.alloc_size);
+}
+
+size_t alloc_handle_num_live(const alloc_handle_pool_t *pool) {
+    ASSERT_DEBUG(pool != NULL);
+    return pool->num_live;
+}
+
+/**
+ * Returns the live object at position @a pos of the dense array.
+ *
+ * Positions `[0, alloc_handle_num_live())` hold every live object exactly once,
+ * in no particular order.
+ *
+ * @param pool       Pool structure pointer.
+ * @param pos        Position in the dense array.
+ * @param out_handle Optional pointer that receives the object handle.
+ */
+void *alloc_handle_live_at(const alloc_handle_pool_t *pool, size_t pos,
+                           alloc_handle_t *out_handle) {
+    ASSERT_DEBUG(pool != NULL);
+    ASSERTF_DEBUG(pos < pool->num_live, "pos %zu is out of bounds", pos);
+
+    const uint32_t idx = pool->dense[pos];
+    if (out_handle) {
+        *out_handle =
+            (pool->generations[idx] << YTALLOC_HANDLE_INDEX_BITS) | idx;
+    }
+    return (void *)(pool->slab.start + (uintptr_t)idx * pool->slab.alloc_size);
+}
@@ -0,0 +1,159 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+#include "alloc_size_class.h"
+#include "aux/auxmath.h"
+
+static void *prv_alloc_heap_large(alloc_heap_t *heap, size_t size);
+
+/**
+ * Returns the size of the metadata needed by #alloc_heap_init() to route
+ * requests to @a buddy, one byte per order 0 block.
+ */
+size_t alloc_heap_meta_size(const alloc_buddy_t *buddy) {
+    if (!buddy) { return 0; }
+    return alloc_buddy_heap_size(buddy) / alloc_buddy_order0_size(buddy);
+}
+
+/**
+ * Initializes a general-purpose heap that routes each request to an engine by
+ * its size.
+ *
+ * Requests of up to #YTALLOC_HEAP_SMALL_MAX bytes go to one of the
+ * #YTALLOC_HEAP_NUM_CLASSES slab heaps, requests of up to
+ * #YTALLOC_HEAP_LIST_MAX bytes go to @a list and bigger ones go to @a buddy. A
+ * request that its engine cannot satisfy spills over to the next one.
+ *
+ * The slab region is split into equal power of two parts, one per size class,
+ * so that #alloc_heap_free() finds the class of a pointer with a shift. The
+ * list and buddy heaps are owned by the caller and may be shared with other
+ * users, but must not overlap the slab region.
+ *
+ * @param heap       Heap structure pointer.
+ * @param slab_start Start of the region for the size classes, aligned at 16.
+ * @param slab_size  Size of the region, at least
+ *                   `2 * YTALLOC_HEAP_NUM_CLASSES * YTALLOC_HEAP_SMALL_MAX`.
+ * @param list       Initialized list heap for medium requests (may be `NULL`).
+ * @param buddy      Initialized buddy heap for large requests (may be `NULL`).
+ * @param meta       Metadata storage, see #alloc_heap_meta_size().
+ * @param meta_size  Size of @a meta.
+ */
+void alloc_heap_init(alloc_heap_t *heap, void *slab_start, size_t slab_size,
+                     alloc_list_t *list, alloc_buddy_t *buddy, void *meta,
+                     size_t meta_size) {
+    ASSERT_ALWAYS(heap != NULL);
+    ASSERT_ALWAYS(slab_start != NULL);
+    ASSERTF_ALWAYS((uintptr_t)slab_start % 16 == 0,
+                   "slab_start %p must be aligned at 16", slab_start);
+    ASSERTF_ALWAYS(meta_size >= alloc_heap_meta_size(buddy),
+                   "meta_size must be >= %zu", alloc_heap_meta_size(buddy));
+    ASSERT_ALWAYS(meta != NULL || meta_size == 0);
+
+    const size_t class_shift =
+        alloc_calc_log2(slab_size / YTALLOC_HEAP_NUM_CLASSES);
+    const size_t class_region_size = (size_t)1 << class_shift;
+    ASSERTF_ALWAYS(class_region_size >= 2 * YTALLOC_HEAP_SMALL_MAX,
+                   "slab_size %zu is too small", slab_size);
+
+    memset(heap, 0, sizeof(*heap));
+    heap->slab_start = (uintptr_t)slab_start;
+    heap->slab_end =
+        heap->slab_start + YTALLOC_HEAP_NUM_CLASSES * class_region_size;
+    heap->class_shift = class_shift;
+    heap->list = list;
+    heap->buddy = buddy;
+    heap->buddy_log2 = meta;
+
+    for (size_t idx = 0; idx < YTALLOC_HEAP_NUM_CLASSES; idx++) {
+        const size_t item_size = g_alloc_class_sizes[idx];
+        const uintptr_t region = heap->slab_start + idx * class_region_size;
+        const uintptr_t start =
+            region + (item_size - region % item_size) % item_size;
+        alloc_slab_init(&heap->classes[idx], (void *)start,
+                        region + class_region_size - start, item_size);
+    }
+
+#ifdef YTALLOC_DEBUG
+    for (size_t size = 0; size <= YTALLOC_HEAP_SMALL_MAX; size++) {
+        const size_t class_idx = g_alloc_class_of[(size + 15) / 16];
+        ASSERT_DEBUG(g_alloc_class_sizes[class_idx] >= size);
+        ASSERT_DEBUG(class_idx == 0 ||
+                     g_alloc_class_sizes[class_idx - 1] < size);
+    }
+#endif
+}
+
+/**
+ * Allocates @a size bytes from the engine that fits the size best.
+ *
+ * @returns The allocated block or `NULL` if no engine has room for it.
+ */
+void *alloc_heap(alloc_heap_t *heap, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+
+    if (size <= YTALLOC_HEAP_SMALL_MAX) {
+        const size_t class_idx = g_alloc_class_of[(size + 15) / 16];
+        void *const ptr = alloc_slab(&heap->classes[class_idx]);
+        if (ptr) { return ptr; }
+    }
+
+    if (size <= YTALLOC_HEAP_LIST_MAX && heap->list) {
+        void *const ptr = alloc_list(heap->list, size);
+        if (ptr) { return ptr; }
+    }
+
+    return prv_alloc_heap_large(heap, size);
+}
+
+/**
+ * Frees a block allocated by #alloc_heap(). The engine is found by the region
+ * that @a ptr is in.
+ */
+void alloc_heap_free(alloc_heap_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+
+    const uintptr_t addr = (uintptr_t)ptr;
+    if (addr >= heap->slab_start && addr < heap->slab_end) {
+        const size_t class_idx = (addr - heap->slab_start) >> heap->class_shift;
+        alloc_slab_free(&heap->classes[class_idx], ptr);
+    } else if (heap->list && addr >= heap->list->start &&
+               addr < heap->list->end) {
+        alloc_list_free(heap->list, ptr);
+    } else if (heap->buddy && addr >= heap->buddy->start &&
+               addr < heap->buddy->end) {
+        const size_t page = alloc_buddy_order0_size(heap->buddy);
+        const size_t block = (addr - heap->buddy->start) / page;
+        alloc_buddy_free(heap->buddy, ptr,
+                         (size_t)1 << heap->buddy_log2[block]);
+    } else {
+        ASSERTF_ALWAYS(false, "alloc_heap_free: %p is not in the heap", ptr);
+    }
+}
+
+/**
+ * Returns the item size of the size class @a class_idx.
+ */
+size_t alloc_heap_class_size(size_t class_idx) {
+    ASSERT_ALWAYS(class_idx < YTALLOC_HEAP_NUM_CLASSES);
+    return g_alloc_class_sizes[class_idx];
+}
+
+static void *prv_alloc_heap_large(alloc_heap_t *heap, size_t size) {
+    if (!heap->buddy) { return NULL; }
+
+    const size_t order0_size = alloc_buddy_order0_size(heap->buddy);
+    const size_t block_size =
+        alloc_calc_pow2_ge(size > order0_size ? size : order0_size);
+    if (block_size == 0) { return NULL; }
+
+    void *const ptr = alloc_buddy(heap->buddy, block_size);
+    if (ptr) {
+        const size_t block =
+            ((uintptr_t)ptr - heap->buddy->start) / order0_size;
+        // block_size is a power of two, so its log2 is its trailing zeros.
+        heap->buddy_log2[block] = (uint8_t)__builtin_ctzll(block_size);
+    }
+    return ptr;
+}
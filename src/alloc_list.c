@@ -1,8 +1,12 @@
 #include <string.h>
 #include <ytalloc/ytalloc.h>
 
+#include "alloc_lock.h"
 #include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
 #include "aux/list.h"
+#include "aux/remote.h"
 #include "config.h"
 
 #define ALLOC_LIST_MIN_SIZE 64
@@ -15,12 +19,23 @@ typedef struct {
 } alloc_tag_t;
 
 static alloc_tag_t *prv_alloc_list_find(alloc_list_t *heap, void *chunk_start);
+static void prv_alloc_list_split(alloc_list_t *heap, alloc_tag_t *tag,
+                                 size_t size);
 
 [[maybe_unused]] static void prv_alloc_list_check(alloc_list_t *heap);
 static bool prv_alloc_list_check_node(alloc_list_t *heap, list_node_t *node);
 static bool prv_alloc_list_check_tag(alloc_list_t *heap, alloc_tag_t *tag);
 static bool prv_alloc_list_check_addr(alloc_list_t *heap, uintptr_t addr);
 
+static void *prv_alloc_list_ops_alloc(void *heap, size_t size);
+static void *prv_alloc_list_ops_aligned_alloc(void *heap, size_t size,
+                                              size_t align);
+static void prv_alloc_list_ops_free(void *heap, void *ptr, size_t size);
+static size_t prv_alloc_list_ops_usable_size(const void *heap, const void *ptr,
+                                             size_t size);
+static void prv_alloc_list_ops_stats(const void *heap, alloc_ops_stats_t *out);
+static void prv_alloc_list_ops_reset(void *heap);
+
 void alloc_list_init(alloc_list_t *heap, void *start, size_t size) {
     ASSERT_ALWAYS(heap != NULL);
     ASSERT_ALWAYS(start != NULL);
@@ -56,13 +71,23 @@ void alloc_list_init(alloc_list_t *heap, void *start, size_t size) {
                    "minimum allocation size (%u)",
                    tag->size, ALLOC_LIST_MIN_SIZE);
     }
+
+    alloc_registry_note(ALLOC_KIND_LIST, heap, start, size);
 }
 
 void *alloc_list(alloc_list_t *heap, size_t size) {
     ASSERT_DEBUG(heap != NULL);
     ASSERT_DEBUG(heap->tag_list != NULL);
+    ALLOC_STATS_START(t0);
+    [[maybe_unused]] const size_t requested = size;
+
+    if (__atomic_load_n(&heap->remote, __ATOMIC_RELAXED) != 0) {
+        alloc_list_drain_remote(heap);
+    }
 
     if (size < ALLOC_LIST_MIN_SIZE) { size = ALLOC_LIST_MIN_SIZE; }
+    // Keeps the tag after the chunk, and thus the next chunk, aligned.
+    size = (size + alignof(alloc_tag_t) - 1) & ~(alignof(alloc_tag_t) - 1);
 
 #ifdef YTALLOC_LIST_DO_CHECKS
     prv_alloc_list_check(heap);
@@ -81,27 +106,19 @@ void *alloc_list(alloc_list_t *heap, size_t size) {
         LOGF_DEBUG("alloc_list: could not find a free tag for an allocation "
                    "of size %zu",
                    size);
+        ALLOC_STATS_ALLOC(ALLOC_KIND_LIST, t0, NULL, requested, 0);
         return NULL;
     }
 
-    const size_t extra_size = found_tag->size - size;
-    if (extra_size > sizeof(alloc_tag_t) + ALLOC_LIST_MIN_SIZE) {
-        alloc_tag_t *const new_tag = (alloc_tag_t *)(found_tag->start + size);
-        memset(new_tag, 0, sizeof(*new_tag));
-        new_tag->used = false;
-        new_tag->start = (uintptr_t)new_tag + sizeof(alloc_tag_t);
-        new_tag->size = found_tag->size - size - sizeof(alloc_tag_t);
-
-        found_tag->size = size;
-
-        list_insert(heap->tag_list, &found_tag->node, &new_tag->node);
-    }
+    prv_alloc_list_split(heap, found_tag, size);
 
 #if ALLOC_LIST_DO_CHECKS
     prv_alloc_list_check(heap);
 #endif
 
     found_tag->used = true;
+    ALLOC_STATS_ALLOC(ALLOC_KIND_LIST, t0, (void *)found_tag->start,
+                      requested, found_tag->size);
     return (void *)found_tag->start;
 }
 
@@ -109,6 +126,9 @@ void alloc_list_free(alloc_list_t *heap, void *ptr) {
     ASSERT_DEBUG(heap != NULL);
 
     if (!ptr) { return; }
+    ASSERTF_DEBUG(alloc_registry_owns(heap, ptr),
+                  "%p is in a region of another heap", ptr);
+    ALLOC_STATS_START(t0);
 
 #if ALLOC_LIST_DO_CHECKS
     prv_alloc_list_check(heap);
@@ -119,12 +139,133 @@ void alloc_list_free(alloc_list_t *heap, void *ptr) {
                    "alloc_free: could not find a chunk that starts at %p", ptr);
 
     tag->used = false;
+    ALLOC_STATS_FREE(ALLOC_KIND_LIST, t0, 1, tag->size);
 
 #if ALLOC_LIST_DO_CHECKS
     prv_alloc_list_check(heap);
 #endif
 }
 
+void alloc_list_set_lock(alloc_list_t *heap, const alloc_lock_t *lock) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
+
+void *alloc_list_locked(alloc_list_t *heap, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = alloc_list(heap, size);
+    alloc_lock_release(heap->lock);
+
+    return ptr;
+}
+
+void alloc_list_free_locked(alloc_list_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+
+    alloc_lock_acquire(heap->lock);
+    alloc_list_free(heap, ptr);
+    alloc_lock_release(heap->lock);
+}
+
+/**
+ * Makes the calling thread the owner of @a heap.
+ *
+ * Chunks freed by other threads with #alloc_list_free_remote() are queued and
+ * freed by the owner on its next allocation.
+ */
+void alloc_list_set_owner(alloc_list_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->owner = remote_thread_id();
+}
+
+/**
+ * Frees a chunk from any thread. Only the owner frees it right away, other
+ * threads put it onto a lock-free queue, linked through its first word.
+ */
+void alloc_list_free_remote(alloc_list_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(heap->owner != NULL, "%s", "the heap has no owner");
+    if (!ptr) { return; }
+
+    if (heap->owner == remote_thread_id()) {
+        alloc_list_free(heap, ptr);
+    } else {
+        remote_push(&heap->remote, ptr, (uintptr_t *)ptr);
+    }
+}
+
+/**
+ * Frees the chunks queued by other threads. Only the owner may call this.
+ *
+ * @returns The number of chunks freed.
+ */
+size_t alloc_list_drain_remote(alloc_list_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+
+    size_t cnt = 0;
+    uintptr_t chunk = remote_take(&heap->remote);
+    while (chunk) {
+        const uintptr_t next = *(const uintptr_t *)chunk;
+        alloc_list_free(heap, (void *)chunk);
+        chunk = next;
+        cnt++;
+    }
+    return cnt;
+}
+
+/**
+ * Same as #alloc_list(), but also tells the size of the chunk, which is at
+ * least @a size. The whole chunk may be used.
+ *
+ * @param heap     Heap structure pointer.
+ * @param size     Minimum size of the chunk.
+ * @param out_size Receives the chunk size if the allocation succeeds.
+ */
+void *alloc_list_at_least(alloc_list_t *heap, size_t size, size_t *out_size) {
+    ASSERT_DEBUG(out_size != NULL);
+
+    void *const ptr = alloc_list(heap, size);
+    if (ptr) { *out_size = alloc_list_usable_size(heap, ptr); }
+    return ptr;
+}
+
+/**
+ * Returns the size of the chunk at @a ptr, which may be more than was asked
+ * for: requests are rounded up to `ALLOC_LIST_MIN_SIZE` and to the tag
+ * alignment, and a free chunk is not split if the rest would be too small.
+ *
+ * The tag of a chunk lies right before it, so it is read without walking the
+ * tag list.
+ */
+size_t alloc_list_usable_size(const alloc_list_t *heap, const void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(ptr != NULL);
+
+    const uintptr_t addr = (uintptr_t)ptr;
+    ASSERTF_ALWAYS(addr >= heap->start + sizeof(alloc_tag_t) &&
+                       addr < heap->end && addr % alignof(alloc_tag_t) == 0,
+                   "%p cannot be the start of a chunk", ptr);
+
+    const alloc_tag_t *const tag =
+        (const alloc_tag_t *)(addr - sizeof(alloc_tag_t));
+    ASSERTF_ALWAYS(tag->start == addr,
+                   "could not find a chunk that starts at %p", ptr);
+    return tag->size;
+}
+
+const alloc_ops_t alloc_list_ops = {
+    .name = "list",
+    .alloc = prv_alloc_list_ops_alloc,
+    .aligned_alloc = prv_alloc_list_ops_aligned_alloc,
+    .free = prv_alloc_list_ops_free,
+    .usable_size = prv_alloc_list_ops_usable_size,
+    .stats = prv_alloc_list_ops_stats,
+    .reset = prv_alloc_list_ops_reset,
+};
+
 static alloc_tag_t *prv_alloc_list_find(alloc_list_t *heap, void *chunk_start) {
     ASSERT_DEBUG(heap != NULL);
     ASSERT_DEBUG(heap->tag_list != NULL);
@@ -138,6 +279,26 @@ static alloc_tag_t *prv_alloc_list_find(alloc_list_t *heap, void *chunk_start) {
     return NULL;
 }
 
+/**
+ * Splits the rest of the free chunk of @a tag after @a size bytes off into a
+ * new free chunk, if the rest is big enough for one.
+ */
+static void prv_alloc_list_split(alloc_list_t *heap, alloc_tag_t *tag,
+                                 size_t size) {
+    const size_t extra_size = tag->size - size;
+    if (extra_size > sizeof(alloc_tag_t) + ALLOC_LIST_MIN_SIZE) {
+        alloc_tag_t *const new_tag = (alloc_tag_t *)(tag->start + size);
+        memset(new_tag, 0, sizeof(*new_tag));
+        new_tag->used = false;
+        new_tag->start = (uintptr_t)new_tag + sizeof(alloc_tag_t);
+        new_tag->size = tag->size - size - sizeof(alloc_tag_t);
+
+        tag->size = size;
+
+        list_insert(heap->tag_list, &tag->node, &new_tag->node);
+    }
+}
+
 static void prv_alloc_list_check(alloc_list_t *heap) {
     ASSERT_DEBUG(heap != NULL);
 
@@ -191,3 +352,115 @@ static bool prv_alloc_list_check_addr(alloc_list_t *heap, uintptr_t addr) {
     ASSERT_DEBUG(heap != NULL);
     return heap->start <= addr && addr < heap->end;
 }
+
+static void *prv_alloc_list_ops_alloc(void *heap, size_t size) {
+    return alloc_list(heap, size);
+}
+
+/**
+ * Chunks are only aligned at the tag alignment. If the first free chunk that
+ * fits is misaligned, its head is split off into a free chunk of its own, so
+ * that the tag of the rest lies right before an aligned address.
+ */
+static void *prv_alloc_list_ops_aligned_alloc(void *v_heap, size_t size,
+                                              size_t align) {
+    alloc_list_t *const heap = v_heap;
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(align != 0 && (align & (align - 1)) == 0,
+                  "align %zu is not a power of two", align);
+    if (align <= alignof(alloc_tag_t)) { return alloc_list(heap, size); }
+    ALLOC_STATS_START(t0);
+    [[maybe_unused]] const size_t requested = size;
+
+    if (__atomic_load_n(&heap->remote, __ATOMIC_RELAXED) != 0) {
+        alloc_list_drain_remote(heap);
+    }
+
+    if (size < ALLOC_LIST_MIN_SIZE) { size = ALLOC_LIST_MIN_SIZE; }
+    size = (size + alignof(alloc_tag_t) - 1) & ~(alignof(alloc_tag_t) - 1);
+
+    for (list_node_t *node = heap->tag_list->p_first_node; node != NULL;
+         node = node->p_next) {
+        alloc_tag_t *tag = LIST_NODE_TO_STRUCT(node, alloc_tag_t, node);
+        if (tag->used) { continue; }
+
+        uintptr_t start = tag->start;
+        if (start % align != 0) {
+            // Leave room for the head chunk and the tag of the new one.
+            start += sizeof(alloc_tag_t) + ALLOC_LIST_MIN_SIZE;
+            start = (start + align - 1) & ~(align - 1);
+        }
+        if (start - tag->start + size > tag->size) { continue; }
+
+        if (start != tag->start) {
+            alloc_tag_t *const new_tag =
+                (alloc_tag_t *)(start - sizeof(alloc_tag_t));
+            memset(new_tag, 0, sizeof(*new_tag));
+            new_tag->used = false;
+            new_tag->start = start;
+            new_tag->size = tag->start + tag->size - start;
+
+            tag->size = (uintptr_t)new_tag - tag->start;
+
+            list_insert(heap->tag_list, &tag->node, &new_tag->node);
+            tag = new_tag;
+        }
+        prv_alloc_list_split(heap, tag, size);
+
+        tag->used = true;
+        ALLOC_STATS_ALLOC(ALLOC_KIND_LIST, t0, (void *)tag->start, requested,
+                          tag->size);
+        return (void *)tag->start;
+    }
+
+    ALLOC_STATS_ALLOC(ALLOC_KIND_LIST, t0, NULL, requested, 0);
+    return NULL;
+}
+
+static void prv_alloc_list_ops_free(void *heap, void *ptr, size_t size) {
+    (void)size;
+    alloc_list_free(heap, ptr);
+}
+
+static size_t prv_alloc_list_ops_usable_size(const void *heap, const void *ptr,
+                                             size_t size) {
+    (void)size;
+    return alloc_list_usable_size(heap, ptr);
+}
+
+static void prv_alloc_list_ops_stats(const void *v_heap,
+                                     alloc_ops_stats_t *out) {
+    const alloc_list_t *const heap = v_heap;
+    memset(out, 0, sizeof(*out));
+    out->heap_size = heap->end - heap->start;
+    for (const list_node_t *node = heap->tag_list->p_first_node; node != NULL;
+         node = node->p_next) {
+        const alloc_tag_t *const tag =
+            LIST_NODE_TO_STRUCT(node, alloc_tag_t, node);
+        if (tag->used) {
+            out->used_size += tag->size;
+        } else {
+            out->free_size += tag->size;
+        }
+    }
+}
+
+/**
+ * Frees every chunk by initializing the heap again. The lock and the owner are
+ * kept, chunks queued by other threads are dropped.
+ */
+static void prv_alloc_list_ops_reset(void *v_heap) {
+    alloc_list_t *const heap = v_heap;
+#ifdef YTALLOC_STATS
+    alloc_ops_stats_t stats;
+    prv_alloc_list_ops_stats(heap, &stats);
+    if (stats.used_size != 0) {
+        ALLOC_STATS_FREE(ALLOC_KIND_LIST, 0, 1, stats.used_size);
+    }
+#endif
+    const alloc_lock_t *const lock = heap->lock;
+    const void *const owner = heap->owner;
+    alloc_list_init(heap, (void *)heap->start, heap->end - heap->start);
+    heap->lock = lock;
+    heap->owner = owner;
+}
@@ -0,0 +1,116 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+#include "config.h"
+
+#ifdef YTALLOC_HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+static void prv_alloc_spin_lock(void *obj);
+static void prv_alloc_spin_unlock(void *obj);
+static bool prv_alloc_spin_trylock(void *obj);
+static void prv_alloc_spin_pause(void);
+
+static void prv_alloc_pthread_lock(void *obj);
+static void prv_alloc_pthread_unlock(void *obj);
+static bool prv_alloc_pthread_trylock(void *obj);
+
+/**
+ * Makes @a lock use the spinlock @a spin.
+ *
+ * A spinlock suits heaps whose critical sections are a few dozen instructions
+ * long and whose threads are not oversubscribed.
+ *
+ * @param lock Lock hooks to fill in.
+ * @param spin Spinlock to use. It is initialized as unlocked.
+ */
+void alloc_lock_spin(alloc_lock_t *lock, alloc_spinlock_t *spin) {
+    ASSERT_ALWAYS(lock != NULL);
+    ASSERT_ALWAYS(spin != NULL);
+
+    memset(spin, 0, sizeof(*spin));
+    lock->lock = prv_alloc_spin_lock;
+    lock->unlock = prv_alloc_spin_unlock;
+    lock->trylock = prv_alloc_spin_trylock;
+    lock->obj = spin;
+}
+
+/**
+ * Makes @a lock use a pthread mutex.
+ *
+ * Aborts if the library has been built without pthreads.
+ *
+ * @param lock  Lock hooks to fill in.
+ * @param mutex Initialized `pthread_mutex_t`.
+ */
+void alloc_lock_pthread(alloc_lock_t *lock, void *mutex) {
+    ASSERT_ALWAYS(lock != NULL);
+    ASSERT_ALWAYS(mutex != NULL);
+#ifndef YTALLOC_HAVE_PTHREAD
+    ASSERTF_ALWAYS(false, "%s", "ytalloc has been built without pthreads");
+#endif
+
+    lock->lock = prv_alloc_pthread_lock;
+    lock->unlock = prv_alloc_pthread_unlock;
+    lock->trylock = prv_alloc_pthread_trylock;
+    lock->obj = mutex;
+}
+
+static void prv_alloc_spin_lock(void *obj) {
+    alloc_spinlock_t *const spin = obj;
+    while (__atomic_exchange_n(&spin->locked, 1, __ATOMIC_ACQUIRE) != 0) {
+        // Wait on a plain load so that the cache line stays shared while the
+        // lock is held.
+        while (__atomic_load_n(&spin->locked, __ATOMIC_RELAXED) != 0) {
+            prv_alloc_spin_pause();
+        }
+    }
+}
+
+static void prv_alloc_spin_unlock(void *obj) {
+    alloc_spinlock_t *const spin = obj;
+    __atomic_store_n(&spin->locked, 0, __ATOMIC_RELEASE);
+}
+
+static bool prv_alloc_spin_trylock(void *obj) {
+    alloc_spinlock_t *const spin = obj;
+    return __atomic_load_n(&spin->locked, __ATOMIC_RELAXED) == 0 &&
+           __atomic_exchange_n(&spin->locked, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static void prv_alloc_spin_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+static void prv_alloc_pthread_lock(void *obj) {
+#ifdef YTALLOC_HAVE_PTHREAD
+    const int ret = pthread_mutex_lock(obj);
+    ASSERTF_ALWAYS(ret == 0, "pthread_mutex_lock failed: %d", ret);
+#else
+    (void)obj;
+#endif
+}
+
+static void prv_alloc_pthread_unlock(void *obj) {
+#ifdef YTALLOC_HAVE_PTHREAD
+    const int ret = pthread_mutex_unlock(obj);
+    ASSERTF_ALWAYS(ret == 0, "pthread_mutex_unlock failed: %d", ret);
+#else
+    (void)obj;
+#endif
+}
+
+static bool prv_alloc_pthread_trylock(void *obj) {
+#ifdef YTALLOC_HAVE_PTHREAD
+    return pthread_mutex_trylock(obj) == 0;
+#else
+    (void)obj;
+    return false;
+#endif
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <ytalloc/ytalloc.h>
+
+/*
+ * A heap without a lock is used by one thread only, so its locked entry points
+ * do not lock anything.
+ */
+
+static inline void alloc_lock_acquire(const alloc_lock_t *lock) {
+    if (lock) { lock->lock(lock->obj); }
+}
+
+static inline void alloc_lock_release(const alloc_lock_t *lock) {
+    if (lock) { lock->unlock(lock->obj); }
+}
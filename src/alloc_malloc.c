@@ -0,0 +1,492 @@
+/**
+ * @file alloc_malloc.c
+ * Drop-in replacement of the C allocator, built as `libytalloc_malloc.so`.
+ *
+ * Memory comes from the OS in spans of #PRV_SPAN_SIZE bytes, aligned at their
+ * size, so that the span of a pointer is found by masking it. Each span starts
+ * with a #prv_span_t header:
+ * - small requests go to one slab heap per size class, each span being a slab,
+ * - medium requests go to bitmap heaps with #PRV_MEDIUM_UNIT byte units,
+ * - large requests are mapped one by one, the header preceding the block.
+ *
+ * Every size class and the medium spans have their own mutex.
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_size_class.h"
+
+#define PRV_SPAN_SIZE    ((size_t)1 << 20)
+#define PRV_MIN_ALIGN    16
+#define PRV_SMALL_MAX    YTALLOC_HEAP_SMALL_MAX
+#define PRV_NUM_CLASSES  YTALLOC_HEAP_NUM_CLASSES
+#define PRV_MEDIUM_MAX   (128 * 1024)
+#define PRV_MEDIUM_UNIT  256
+#define PRV_MEDIUM_UNITS (PRV_SPAN_SIZE / PRV_MEDIUM_UNIT)
+
+typedef enum {
+    PRV_SPAN_SMALL = 1,
+    PRV_SPAN_MEDIUM,
+    PRV_SPAN_LARGE,
+} prv_span_kind_t;
+
+typedef struct {
+    uint16_t delta;
+    uint16_t num_units;
+} prv_run_t;
+
+typedef struct prv_span {
+    prv_span_kind_t kind;
+    size_t class_idx;
+    struct prv_span *prev;
+    struct prv_span *next;
+    size_t map_size;
+
+    alloc_slab_t slab;
+    alloc_bitmap_t bitmap;
+    prv_run_t *runs;
+} prv_span_t;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    prv_span_t *spans;
+    prv_span_t *cur;
+} prv_pool_t;
+
+static void *prv_malloc_aligned(size_t size, size_t align);
+static size_t prv_malloc_usable_size(const void *ptr);
+
+static void *prv_malloc_small(size_t class_idx);
+static void prv_malloc_free_small(prv_span_t *span, void *ptr);
+static void *prv_malloc_medium(size_t size, size_t align);
+static void *prv_malloc_medium_run(prv_span_t *span, size_t num_units);
+static void prv_malloc_free_medium(prv_span_t *span, void *ptr);
+static void *prv_malloc_large(size_t size, size_t align);
+
+static prv_span_t *prv_malloc_new_span(prv_pool_t *pool);
+static void prv_malloc_drop_span(prv_pool_t *pool, prv_span_t *span);
+static prv_span_t *prv_malloc_span_of(const void *ptr);
+static void *prv_malloc_map(size_t size, size_t align, size_t off);
+static size_t prv_malloc_page_size(void);
+
+static void prv_malloc_init(void);
+static void prv_malloc_fork_prepare(void);
+static void prv_malloc_fork_parent(void);
+static void prv_malloc_fork_child(void);
+
+static prv_pool_t g_small_pools[PRV_NUM_CLASSES] = {
+    [0 ... PRV_NUM_CLASSES - 1] = {.mutex = PTHREAD_MUTEX_INITIALIZER},
+};
+static prv_pool_t g_medium_pool = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+static size_t g_page_size;
+
+void *malloc(size_t size) {
+    void *const ptr = prv_malloc_aligned(size, PRV_MIN_ALIGN);
+    if (!ptr) { errno = ENOMEM; }
+    return ptr;
+}
+
+void free(void *ptr) {
+    if (!ptr) { return; }
+
+    prv_span_t *const span = prv_malloc_span_of(ptr);
+    switch (span->kind) {
+    case PRV_SPAN_SMALL:
+        prv_malloc_free_small(span, ptr);
+        break;
+    case PRV_SPAN_MEDIUM:
+        prv_malloc_free_medium(span, ptr);
+        break;
+    case PRV_SPAN_LARGE:
+        munmap(span, span->map_size);
+        break;
+    default:
+        ASSERTF_ALWAYS(false, "free: %p was not allocated by malloc", ptr);
+    }
+}
+
+void *calloc(size_t num, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(num, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    void *const ptr = malloc(total);
+    if (!ptr) { return NULL; }
+
+    // Large blocks always come from a fresh mapping, which is already zero.
+    if (prv_malloc_span_of(ptr)->kind != PRV_SPAN_LARGE) {
+        memset(ptr, 0, total);
+    }
+    return ptr;
+}
+
+/**
+ * Resizes a block in place if the new size fits and wastes less than half of
+ * it, otherwise moves it to a new block.
+ */
+void *realloc(void *ptr, size_t size) {
+    if (!ptr) { return malloc(size); }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    const size_t usable = prv_malloc_usable_size(ptr);
+    if (size <= usable && usable - size <= usable / 2) { return ptr; }
+
+    void *const new_ptr = malloc(size);
+    if (!new_ptr) { return NULL; }
+    memcpy(new_ptr, ptr, size < usable ? size : usable);
+    free(ptr);
+    return new_ptr;
+}
+
+void *reallocarray(void *ptr, size_t num, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(num, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, total);
+}
+
+void *memalign(size_t align, size_t size) {
+    if (align == 0 || (align & (align - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *const ptr = prv_malloc_aligned(size, align);
+    if (!ptr) { errno = ENOMEM; }
+    return ptr;
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+    return memalign(align, size);
+}
+
+int posix_memalign(void **out, size_t align, size_t size) {
+    if (align == 0 || align % sizeof(void *) != 0 ||
+        (align & (align - 1)) != 0) {
+        return EINVAL;
+    }
+
+    void *const ptr = prv_malloc_aligned(size, align);
+    if (!ptr) { return ENOMEM; }
+    *out = ptr;
+    return 0;
+}
+
+void *valloc(size_t size) {
+    return memalign(prv_malloc_page_size(), size);
+}
+
+void *pvalloc(size_t size) {
+    const size_t page_size = prv_malloc_page_size();
+    if (size > PTRDIFF_MAX) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return memalign(page_size, (size + page_size - 1) & ~(page_size - 1));
+}
+
+size_t malloc_usable_size(void *ptr) {
+    return ptr ? prv_malloc_usable_size(ptr) : 0;
+}
+
+/**
+ * Picks the engine for a request.
+ *
+ * Requests aligned at more than #PRV_MIN_ALIGN are rounded up to the next power
+ * of two size class, whose items are aligned at their size, or to a medium run
+ * with enough slack to align the pointer. Only alignments over a page go to
+ * the large path.
+ */
+static void *prv_malloc_aligned(size_t size, size_t align) {
+    if (size > PTRDIFF_MAX) { return NULL; }
+    if (size == 0) { size = 1; }
+    if (align < PRV_MIN_ALIGN) { align = PRV_MIN_ALIGN; }
+
+    if (align == PRV_MIN_ALIGN && size <= PRV_SMALL_MAX) {
+        return prv_malloc_small(g_alloc_class_of[(size + 15) / 16]);
+    } else if (align <= PRV_SMALL_MAX && size <= PRV_SMALL_MAX) {
+        size_t pow2 = size > align ? size : align;
+        pow2 = (size_t)1 << (64 - __builtin_clzll(pow2 - 1));
+        return prv_malloc_small(g_alloc_class_of[(pow2 + 15) / 16]);
+    } else if (align <= prv_malloc_page_size() && size <= PRV_MEDIUM_MAX) {
+        return prv_malloc_medium(size, align);
+    } else {
+        return prv_malloc_large(size, align);
+    }
+}
+
+static size_t prv_malloc_usable_size(const void *ptr) {
+    const prv_span_t *const span = prv_malloc_span_of(ptr);
+    switch (span->kind) {
+    case PRV_SPAN_SMALL:
+        return g_alloc_class_sizes[span->class_idx];
+    case PRV_SPAN_MEDIUM: {
+        const size_t unit =
+            ((uintptr_t)ptr - span->bitmap.start) / PRV_MEDIUM_UNIT;
+        const prv_run_t run = span->runs[unit];
+        return (size_t)(run.num_units - run.delta) * PRV_MEDIUM_UNIT;
+    }
+    case PRV_SPAN_LARGE:
+        return (uintptr_t)span + span->map_size - (uintptr_t)ptr;
+    default:
+        ASSERTF_ALWAYS(false, "%p was not allocated by malloc", ptr);
+        return 0;
+    }
+}
+
+static void *prv_malloc_small(size_t class_idx) {
+    prv_pool_t *const pool = &g_small_pools[class_idx];
+    pthread_mutex_lock(&pool->mutex);
+
+    void *ptr = pool->cur ? alloc_slab(&pool->cur->slab) : NULL;
+    if (!ptr) {
+        prv_span_t *span = pool->spans;
+        while (span && alloc_slab_num_free(&span->slab) == 0) {
+            span = span->next;
+        }
+
+        if (!span && (span = prv_malloc_new_span(pool))) {
+            const size_t item_size = g_alloc_class_sizes[class_idx];
+            const uintptr_t span_end = (uintptr_t)span + PRV_SPAN_SIZE;
+            const uintptr_t hdr_end = (uintptr_t)(span + 1);
+            const uintptr_t start =
+                hdr_end + (item_size - hdr_end % item_size) % item_size;
+
+            span->kind = PRV_SPAN_SMALL;
+            span->class_idx = class_idx;
+            alloc_slab_init(&span->slab, (void *)start, span_end - start,
+                            item_size);
+        }
+
+        if (span) {
+            pool->cur = span;
+            ptr = alloc_slab(&span->slab);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+    return ptr;
+}
+
+static void prv_malloc_free_small(prv_span_t *span, void *ptr) {
+    prv_pool_t *const pool = &g_small_pools[span->class_idx];
+    pthread_mutex_lock(&pool->mutex);
+
+    alloc_slab_free(&span->slab, ptr);
+    if (span != pool->cur) {
+        if (alloc_slab_num_used(&span->slab) == 0) {
+            prv_malloc_drop_span(pool, span);
+        } else if (alloc_slab_num_free(&pool->cur->slab) == 0) {
+            pool->cur = span;
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/*
+ * A medium block is a run of units, over-allocated by `align - unit` bytes if
+ * it must be aligned at more than a unit. The run length and the distance from
+ * its start are kept at the unit of the returned pointer.
+ */
+static void *prv_malloc_medium(size_t size, size_t align) {
+    const size_t slack = align > PRV_MEDIUM_UNIT ? align - PRV_MEDIUM_UNIT : 0;
+    const size_t num_units = (size + slack + PRV_MEDIUM_UNIT - 1) /
+                             PRV_MEDIUM_UNIT;
+
+    prv_pool_t *const pool = &g_medium_pool;
+    pthread_mutex_lock(&pool->mutex);
+
+    prv_span_t *span = pool->cur;
+    void *run = span ? prv_malloc_medium_run(span, num_units) : NULL;
+    if (!run) {
+        for (span = pool->spans; span; span = span->next) {
+            if (span == pool->cur) { continue; }
+            if ((run = prv_malloc_medium_run(span, num_units))) { break; }
+        }
+    }
+    if (!run && (span = prv_malloc_new_span(pool))) {
+        const size_t meta_size = alloc_bitmap_meta_size(PRV_MEDIUM_UNITS);
+        const size_t page_size = prv_malloc_page_size();
+        uintptr_t meta = (uintptr_t)(span + 1);
+        meta = (meta + 7) & ~(uintptr_t)7;
+        span->runs = (prv_run_t *)(meta + meta_size);
+        uintptr_t start =
+            (uintptr_t)(span->runs + PRV_MEDIUM_UNITS) + page_size - 1;
+        start &= ~(uintptr_t)(page_size - 1);
+
+        span->kind = PRV_SPAN_MEDIUM;
+        alloc_bitmap_init(&span->bitmap, (void *)start,
+                          (uintptr_t)span + PRV_SPAN_SIZE - start,
+                          PRV_MEDIUM_UNIT, (void *)meta, meta_size);
+        run = prv_malloc_medium_run(span, num_units);
+    }
+
+    void *ptr = NULL;
+    if (run) {
+        pool->cur = span;
+        ptr = (void *)(((uintptr_t)run + align - 1) & ~(uintptr_t)(align - 1));
+        const size_t unit =
+            ((uintptr_t)ptr - span->bitmap.start) / PRV_MEDIUM_UNIT;
+        span->runs[unit].delta =
+            ((uintptr_t)ptr - (uintptr_t)run) / PRV_MEDIUM_UNIT;
+        span->runs[unit].num_units = num_units;
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+    return ptr;
+}
+
+static void *prv_malloc_medium_run(prv_span_t *span, size_t num_units) {
+    if (alloc_bitmap_num_free(&span->bitmap) < num_units) { return NULL; }
+    return alloc_bitmap(&span->bitmap, num_units * PRV_MEDIUM_UNIT);
+}
+
+static void prv_malloc_free_medium(prv_span_t *span, void *ptr) {
+    prv_pool_t *const pool = &g_medium_pool;
+    pthread_mutex_lock(&pool->mutex);
+
+    const size_t unit = ((uintptr_t)ptr - span->bitmap.start) / PRV_MEDIUM_UNIT;
+    const prv_run_t run = span->runs[unit];
+    alloc_bitmap_free(&span->bitmap,
+                      (uint8_t *)ptr - run.delta * PRV_MEDIUM_UNIT,
+                      run.num_units * PRV_MEDIUM_UNIT);
+    if (span != pool->cur && alloc_bitmap_num_used(&span->bitmap) == 0) {
+        prv_malloc_drop_span(pool, span);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/*
+ * A large block has a mapping of its own. The header is in the span-aligned
+ * page before the block, so that masking the block's address finds it, even if
+ * the block itself is aligned at a span or more.
+ */
+static void *prv_malloc_large(size_t size, size_t align) {
+    const size_t page_size = prv_malloc_page_size();
+    const size_t ptr_off =
+        align <= PRV_SPAN_SIZE
+            ? (sizeof(prv_span_t) + align - 1) & ~(align - 1)
+            : PRV_SPAN_SIZE;
+    if (size > PTRDIFF_MAX - ptr_off - page_size) { return NULL; }
+    const size_t map_size = (ptr_off + size + page_size - 1) & ~(page_size - 1);
+
+    prv_span_t *const span =
+        align <= PRV_SPAN_SIZE
+            ? prv_malloc_map(map_size, PRV_SPAN_SIZE, 0)
+            : prv_malloc_map(map_size, align, PRV_SPAN_SIZE);
+    if (!span) { return NULL; }
+
+    span->kind = PRV_SPAN_LARGE;
+    span->map_size = map_size;
+    return (uint8_t *)span + ptr_off;
+}
+
+static prv_span_t *prv_malloc_new_span(prv_pool_t *pool) {
+    prv_span_t *const span = prv_malloc_map(PRV_SPAN_SIZE, PRV_SPAN_SIZE, 0);
+    if (!span) { return NULL; }
+
+    span->map_size = PRV_SPAN_SIZE;
+    span->next = pool->spans;
+    if (pool->spans) { pool->spans->prev = span; }
+    pool->spans = span;
+    return span;
+}
+
+static void prv_malloc_drop_span(prv_pool_t *pool, prv_span_t *span) {
+    if (span->prev) {
+        span->prev->next = span->next;
+    } else {
+        pool->spans = span->next;
+    }
+    if (span->next) { span->next->prev = span->prev; }
+    alloc_registry_forget(span->kind == PRV_SPAN_SMALL ? (void *)&span->slab
+                                                       : (void *)&span->bitmap);
+    munmap(span, span->map_size);
+}
+
+/*
+ * Small and medium pointers are never at the start of their span, large
+ * pointers are at most a span past their header.
+ */
+static prv_span_t *prv_malloc_span_of(const void *ptr) {
+    return (prv_span_t *)(((uintptr_t)ptr - 1) & ~(PRV_SPAN_SIZE - 1));
+}
+
+/*
+ * Maps @a size bytes at an address `A` such that `A + off` is aligned at
+ * @a align. Anonymous mappings are zeroed, so the headers start out zeroed.
+ */
+static void *prv_malloc_map(size_t size, size_t align, size_t off) {
+    const size_t map_size = size + align;
+    void *const map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) { return NULL; }
+
+    const uintptr_t map_start = (uintptr_t)map;
+    const uintptr_t start =
+        ((map_start + off + align - 1) & ~(uintptr_t)(align - 1)) - off;
+    const uintptr_t end = start + size;
+    if (start > map_start) { munmap(map, start - map_start); }
+    if (map_start + map_size > end) {
+        munmap((void *)end, map_start + map_size - end);
+    }
+    return (void *)start;
+}
+
+static size_t prv_malloc_page_size(void) {
+    size_t page_size = __atomic_load_n(&g_page_size, __ATOMIC_RELAXED);
+    if (!page_size) {
+        page_size = sysconf(_SC_PAGESIZE);
+        __atomic_store_n(&g_page_size, page_size, __ATOMIC_RELAXED);
+    }
+    return page_size;
+}
+
+[[gnu::constructor]] static void prv_malloc_init(void) {
+    pthread_atfork(prv_malloc_fork_prepare, prv_malloc_fork_parent,
+                   prv_malloc_fork_child);
+}
+
+/*
+ * A child of a multithreaded process has only the forking thread. The pool
+ * mutexes are held across fork() so that the child sees consistent pools and
+ * can reinitialize the mutexes.
+ */
+static void prv_malloc_fork_prepare(void) {
+    for (size_t idx = 0; idx < PRV_NUM_CLASSES; idx++) {
+        pthread_mutex_lock(&g_small_pools[idx].mutex);
+    }
+    pthread_mutex_lock(&g_medium_pool.mutex);
+}
+
+static void prv_malloc_fork_parent(void) {
+    pthread_mutex_unlock(&g_medium_pool.mutex);
+    for (size_t idx = 0; idx < PRV_NUM_CLASSES; idx++) {
+        pthread_mutex_unlock(&g_small_pools[idx].mutex);
+    }
+}
+
+static void prv_malloc_fork_child(void) {
+    pthread_mutex_init(&g_medium_pool.mutex, NULL);
+    for (size_t idx = 0; idx < PRV_NUM_CLASSES; idx++) {
+        pthread_mutex_init(&g_small_pools[idx].mutex, NULL);
+    }
+}
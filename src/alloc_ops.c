@@ -0,0 +1,31 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+
+static const alloc_ops_t *const g_alloc_ops[] = {
+    &alloc_list_ops,
+    &alloc_static_ops,
+    &alloc_buddy_ops,
+    &alloc_slab_ops,
+};
+
+/**
+ * Finds the operations of an engine by its name, e.g. to pick the engine from
+ * a configuration file.
+ *
+ * @param name One of `"list"`, `"static"`, `"buddy"` and `"slab"`.
+ *
+ * @returns The operations or `NULL` if there is no engine called @a name.
+ */
+const alloc_ops_t *alloc_ops_find(const char *name) {
+    ASSERT_ALWAYS(name != NULL);
+
+    for (size_t idx = 0; idx < sizeof(g_alloc_ops) / sizeof(g_alloc_ops[0]);
+         idx++) {
+        if (strcmp(g_alloc_ops[idx]->name, name) == 0) {
+            return g_alloc_ops[idx];
+        }
+    }
+    return NULL;
+}
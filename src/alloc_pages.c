@@ -0,0 +1,73 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+#include "config.h"
+
+#ifdef YTALLOC_HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+static void *prv_alloc_pages_buddy_get(void *ctx, size_t size);
+static void prv_alloc_pages_buddy_put(void *ctx, void *ptr, size_t size);
+static void *prv_alloc_pages_mmap_get(void *ctx, size_t size);
+static void prv_alloc_pages_mmap_put(void *ctx, void *ptr, size_t size);
+
+/**
+ * Makes @a src hand out blocks of @a buddy.
+ */
+void alloc_page_source_buddy(alloc_page_source_t *src, alloc_buddy_t *buddy) {
+    ASSERT_ALWAYS(src != NULL);
+    ASSERT_ALWAYS(buddy != NULL);
+
+    memset(src, 0, sizeof(*src));
+    src->get = prv_alloc_pages_buddy_get;
+    src->put = prv_alloc_pages_buddy_put;
+    src->ctx = buddy;
+}
+
+/**
+ * Makes @a src map anonymous memory from the OS.
+ *
+ * If the library has been built without mmap support, the source never gives
+ * out any memory.
+ */
+void alloc_page_source_mmap(alloc_page_source_t *src) {
+    ASSERT_ALWAYS(src != NULL);
+
+    memset(src, 0, sizeof(*src));
+    src->get = prv_alloc_pages_mmap_get;
+    src->put = prv_alloc_pages_mmap_put;
+}
+
+static void *prv_alloc_pages_buddy_get(void *ctx, size_t size) {
+    return alloc_buddy(ctx, size);
+}
+
+static void prv_alloc_pages_buddy_put(void *ctx, void *ptr, size_t size) {
+    alloc_buddy_free(ctx, ptr, size);
+}
+
+static void *prv_alloc_pages_mmap_get([[maybe_unused]] void *ctx,
+                                      [[maybe_unused]] size_t size) {
+#ifdef YTALLOC_HAVE_MMAP
+    void *const ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        LOGF_DEBUG("alloc_pages: could not map %zu bytes", size);
+        return NULL;
+    }
+    return ptr;
+#else
+    return NULL;
+#endif
+}
+
+static void prv_alloc_pages_mmap_put([[maybe_unused]] void *ctx,
+                                     [[maybe_unused]] void *ptr,
+                                     [[maybe_unused]] size_t size) {
+#ifdef YTALLOC_HAVE_MMAP
+    const int ret = munmap(ptr, size);
+    ASSERTF_ALWAYS(ret == 0, "could not unmap %zu bytes at %p", size, ptr);
+#endif
+}
@@ -0,0 +1,430 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_lock.h"
+#include "alloc_macros.h"
+#include "alloc_registry.h"
+
+#define PRV_LEVEL_BITS YTALLOC_REGISTRY_LEVEL_BITS
+#define PRV_LEVEL_SIZE ((size_t)1 << PRV_LEVEL_BITS)
+#define PRV_ROOT_SIZE                                                          \
+    ((size_t)1 << (YTALLOC_REGISTRY_ADDR_BITS - YTALLOC_REGISTRY_PAGE_SHIFT -  \
+                   2 * PRV_LEVEL_BITS))
+
+/*
+ * A page shared by several regions has a list of cells in its slot instead of
+ * a region pointer. The slot value then has its lowest bit set.
+ */
+typedef struct alloc_registry_cell {
+    const alloc_region_t *region;
+    struct alloc_registry_cell *next;
+} alloc_registry_cell_t;
+
+static void *prv_alloc_registry_take(alloc_registry_t *reg, size_t size);
+static uintptr_t *prv_alloc_registry_slot(alloc_registry_t *reg,
+                                          uintptr_t page);
+static const uintptr_t *prv_alloc_registry_peek(const alloc_registry_t *reg,
+                                                uintptr_t page);
+static bool prv_alloc_registry_map(alloc_registry_t *reg, uintptr_t page,
+                                   const alloc_region_t *region);
+static void prv_alloc_registry_unmap(alloc_registry_t *reg,
+                                     const alloc_region_t *region);
+static bool prv_alloc_registry_contains(const alloc_region_t *region,
+                                        uintptr_t addr);
+
+static alloc_registry_t *g_alloc_registry;
+
+/**
+ * Returns the smallest pool that #alloc_registry_init() accepts: the root node
+ * and one node of each lower level.
+ */
+size_t alloc_registry_min_pool_size(void) {
+    return (PRV_ROOT_SIZE + 2 * PRV_LEVEL_SIZE) * sizeof(uintptr_t);
+}
+
+/**
+ * Initializes a registry that maps addresses to the heaps that own them.
+ *
+ * The registry is a radix tree over the page numbers of the lower
+ * #YTALLOC_REGISTRY_ADDR_BITS address bits, like a page table with three
+ * levels. A lookup is three dependent loads and takes no lock, so it may run
+ * concurrently with additions and removals, which are serialized by a
+ * spinlock.
+ *
+ * The nodes, region descriptors and cells of the tree are taken from @a pool.
+ * Memory taken from the pool is never given back, because a concurrent lookup
+ * may still read it. Each 2^(#YTALLOC_REGISTRY_PAGE_SHIFT +
+ * #YTALLOC_REGISTRY_LEVEL_BITS) bytes of address space that have a region in
+ * them cost a node of 2^#YTALLOC_REGISTRY_LEVEL_BITS words.
+ *
+ * @param reg       Registry structure pointer.
+ * @param pool      Storage for the tree, aligned at 8 bytes.
+ * @param pool_size Size of @a pool, at least #alloc_registry_min_pool_size().
+ */
+void alloc_registry_init(alloc_registry_t *reg, void *pool, size_t pool_size) {
+    ASSERT_ALWAYS(reg != NULL);
+    ASSERT_ALWAYS(pool != NULL);
+    ASSERTF_ALWAYS((uintptr_t)pool % sizeof(uintptr_t) == 0,
+                   "pool must be aligned at %zu", sizeof(uintptr_t));
+    ASSERTF_ALWAYS(pool_size >= alloc_registry_min_pool_size(),
+                   "pool_size must be >= %zu", alloc_registry_min_pool_size());
+
+    memset(reg, 0, sizeof(*reg));
+    reg->pool = (uintptr_t)pool;
+    reg->pool_end = reg->pool + pool_size;
+    reg->root = prv_alloc_registry_take(reg, PRV_ROOT_SIZE * sizeof(uintptr_t));
+    alloc_lock_spin(&reg->lock, &reg->spin);
+}
+
+/**
+ * Registers the region `[start, start + size)` as owned by @a heap.
+ *
+ * Regions may nest, for example a slab heap in a block of a buddy heap. A
+ * lookup finds the region registered last.
+ *
+ * @returns `false` if the pool has run out, in which case nothing is
+ * registered.
+ */
+bool alloc_registry_add(alloc_registry_t *reg, alloc_kind_t kind, void *heap,
+                        const void *start, size_t size) {
+    ASSERT_ALWAYS(reg != NULL);
+    ASSERT_ALWAYS(start != NULL);
+    ASSERT_ALWAYS(size > 0);
+    ASSERTF_ALWAYS(((uintptr_t)start + size - 1) >>
+                           YTALLOC_REGISTRY_ADDR_BITS ==
+                       0,
+                   "region at %p is above the registry address range", start);
+
+    alloc_lock_acquire(&reg->lock);
+
+    alloc_region_t *const region =
+        prv_alloc_registry_take(reg, sizeof(alloc_region_t));
+    bool ok = region != NULL;
+    if (ok) {
+        region->start = (uintptr_t)start;
+        region->end = region->start + size;
+        region->kind = kind;
+        region->heap = heap;
+
+        const uintptr_t first = region->start >> YTALLOC_REGISTRY_PAGE_SHIFT;
+        const uintptr_t last = (region->end - 1) >> YTALLOC_REGISTRY_PAGE_SHIFT;
+        for (uintptr_t page = first; ok && page <= last; page++) {
+            ok = prv_alloc_registry_map(reg, page, region);
+        }
+
+        if (ok) {
+            region->next = reg->regions;
+            reg->regions = region;
+        } else {
+            prv_alloc_registry_unmap(reg, region);
+        }
+    }
+
+    alloc_lock_release(&reg->lock);
+
+    if (!ok) {
+        LOGF_DEBUG("alloc_registry_add: out of pool for the region at %p",
+                   start);
+    }
+    return ok;
+}
+
+/**
+ * Unregisters the region of @a heap, if it has one.
+ */
+void alloc_registry_remove(alloc_registry_t *reg, const void *heap) {
+    ASSERT_ALWAYS(reg != NULL);
+
+    alloc_lock_acquire(&reg->lock);
+
+    for (alloc_region_t **link = &reg->regions; *link; link = &(*link)->next) {
+        alloc_region_t *const region = *link;
+        if (region->heap == heap) {
+            *link = region->next;
+            prv_alloc_registry_unmap(reg, region);
+            break;
+        }
+    }
+
+    alloc_lock_release(&reg->lock);
+}
+
+/**
+ * Finds the region that @a ptr is in.
+ *
+ * @returns The region or `NULL` if @a ptr is not in a registered region.
+ */
+const alloc_region_t *alloc_registry_find(const alloc_registry_t *reg,
+                                          const void *ptr) {
+    ASSERT_DEBUG(reg != NULL);
+
+    const uintptr_t addr = (uintptr_t)ptr;
+    if (addr >> YTALLOC_REGISTRY_ADDR_BITS != 0) { return NULL; }
+
+    const uintptr_t *const slot =
+        prv_alloc_registry_peek(reg, addr >> YTALLOC_REGISTRY_PAGE_SHIFT);
+    if (!slot) { return NULL; }
+
+    const uintptr_t value = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if ((value & 1) == 0) {
+        const alloc_region_t *const region = (const alloc_region_t *)value;
+        return region && prv_alloc_registry_contains(region, addr) ? region
+                                                                   : NULL;
+    }
+
+    for (const alloc_registry_cell_t *cell =
+             (const alloc_registry_cell_t *)(value & ~(uintptr_t)1);
+         cell; cell = __atomic_load_n(&cell->next, __ATOMIC_ACQUIRE)) {
+        if (prv_alloc_registry_contains(cell->region, addr)) {
+            return cell->region;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Frees @a ptr into the heap that owns it.
+ *
+ * Only the engines that free by pointer alone are supported: list, ring, slab
+ * and bitmap slab heaps. Aborts for the others and for unregistered pointers.
+ */
+void alloc_registry_free(const alloc_registry_t *reg, void *ptr) {
+    if (!ptr) { return; }
+
+    const alloc_region_t *const region = alloc_registry_find(reg, ptr);
+    ASSERTF_ALWAYS(region != NULL,
+                   "alloc_registry_free: %p is not in a registered region",
+                   ptr);
+
+    switch (region->kind) {
+    case ALLOC_KIND_LIST:
+        alloc_list_free(region->heap, ptr);
+        break;
+    case ALLOC_KIND_RING:
+        alloc_ring_free(region->heap, ptr);
+        break;
+    case ALLOC_KIND_SLAB:
+        alloc_slab_free(region->heap, ptr);
+        break;
+    case ALLOC_KIND_SLAB_BITMAP:
+        alloc_slab_bitmap_free(region->heap, ptr);
+        break;
+    default:
+        ASSERTF_ALWAYS(false,
+                       "alloc_registry_free: heaps of kind %d need a size to "
+                       "free %p",
+                       (int)region->kind, ptr);
+    }
+}
+
+/**
+ * Makes every heap initialized from now on register its region in @a reg.
+ * Pass `NULL` to stop registering.
+ *
+ * While a registry is set, debug builds also check that the pointers freed into
+ * a heap are in one of its regions or in no registered region at all.
+ *
+ * A heap stays registered until it is initialized again or removed with
+ * #alloc_registry_remove(). Remove it before its memory or its structure is
+ * reused for anything else, or lookups will still return it.
+ *
+ * Initializing a heap again over the same region keeps its registration, so
+ * resetting a heap takes nothing from the pool. If the pool runs out while a
+ * heap is being registered, the program is aborted.
+ */
+void alloc_set_registry(alloc_registry_t *reg) {
+    __atomic_store_n(&g_alloc_registry, reg, __ATOMIC_RELEASE);
+}
+
+void alloc_registry_note(alloc_kind_t kind, void *heap, const void *start,
+                         size_t size) {
+    alloc_registry_t *const reg =
+        __atomic_load_n(&g_alloc_registry, __ATOMIC_ACQUIRE);
+    if (!reg) { return; }
+
+    alloc_lock_acquire(&reg->lock);
+    bool registered = false;
+    for (const alloc_region_t *region = reg->regions; region;
+         region = region->next) {
+        if (region->heap != heap) { continue; }
+        registered = region->kind == kind &&
+                     region->start == (uintptr_t)start &&
+                     region->end == (uintptr_t)start + size;
+        break;
+    }
+    alloc_lock_release(&reg->lock);
+    if (registered) { return; }
+
+    // A heap structure may be initialized again over another region.
+    alloc_registry_remove(reg, heap);
+    const bool ok = alloc_registry_add(reg, kind, heap, start, size);
+    ASSERTF_ALWAYS(ok, "the registry pool is out of space for the heap at %p",
+                   heap);
+}
+
+void alloc_registry_forget(const void *heap) {
+    alloc_registry_t *const reg =
+        __atomic_load_n(&g_alloc_registry, __ATOMIC_ACQUIRE);
+    if (reg) { alloc_registry_remove(reg, heap); }
+}
+
+/*
+ * Walks the slot of the page of @a ptr like #alloc_registry_find(), without
+ * taking the lock. Regions nest, so every region that contains @a ptr is
+ * checked, not only the newest.
+ */
+bool alloc_registry_owns(const void *heap, const void *ptr) {
+    const alloc_registry_t *const reg =
+        __atomic_load_n(&g_alloc_registry, __ATOMIC_ACQUIRE);
+    if (!reg) { return true; }
+
+    const uintptr_t addr = (uintptr_t)ptr;
+    if (addr >> YTALLOC_REGISTRY_ADDR_BITS != 0) { return true; }
+
+    const uintptr_t *const slot =
+        prv_alloc_registry_peek(reg, addr >> YTALLOC_REGISTRY_PAGE_SHIFT);
+    if (!slot) { return true; }
+
+    const uintptr_t value = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if ((value & 1) == 0) {
+        const alloc_region_t *const region = (const alloc_region_t *)value;
+        return !region || !prv_alloc_registry_contains(region, addr) ||
+               region->heap == heap;
+    }
+
+    bool in_region = false;
+    for (const alloc_registry_cell_t *cell =
+             (const alloc_registry_cell_t *)(value & ~(uintptr_t)1);
+         cell; cell = __atomic_load_n(&cell->next, __ATOMIC_ACQUIRE)) {
+        if (!prv_alloc_registry_contains(cell->region, addr)) { continue; }
+        if (cell->region->heap == heap) { return true; }
+        in_region = true;
+    }
+    return !in_region;
+}
+
+static void *prv_alloc_registry_take(alloc_registry_t *reg, size_t size) {
+    size = (size + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
+    if (reg->pool_end - reg->pool < size) { return NULL; }
+
+    void *const ptr = (void *)reg->pool;
+    reg->pool += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+/*
+ * Returns the slot of @a page, creating the nodes on the way. The nodes are
+ * zeroed before they are published, so a concurrent lookup sees either no node
+ * or an empty one.
+ */
+static uintptr_t *prv_alloc_registry_slot(alloc_registry_t *reg,
+                                          uintptr_t page) {
+    uintptr_t *node = reg->root;
+    const size_t idxs[2] = {
+        page >> (2 * PRV_LEVEL_BITS),
+        (page >> PRV_LEVEL_BITS) & (PRV_LEVEL_SIZE - 1),
+    };
+
+    for (size_t level = 0; level < 2; level++) {
+        uintptr_t *next = (uintptr_t *)node[idxs[level]];
+        if (!next) {
+            next = prv_alloc_registry_take(reg,
+                                           PRV_LEVEL_SIZE * sizeof(uintptr_t));
+            if (!next) { return NULL; }
+            __atomic_store_n(&node[idxs[level]], (uintptr_t)next,
+                             __ATOMIC_RELEASE);
+        }
+        node = next;
+    }
+
+    return &node[page & (PRV_LEVEL_SIZE - 1)];
+}
+
+// Returns the slot of @a page or `NULL` if its nodes do not exist.
+static const uintptr_t *prv_alloc_registry_peek(const alloc_registry_t *reg,
+                                                uintptr_t page) {
+    const uintptr_t *const mid = (const uintptr_t *)__atomic_load_n(
+        &reg->root[page >> (2 * PRV_LEVEL_BITS)], __ATOMIC_ACQUIRE);
+    if (!mid) { return NULL; }
+
+    const uintptr_t *const leaf = (const uintptr_t *)__atomic_load_n(
+        &mid[(page >> PRV_LEVEL_BITS) & (PRV_LEVEL_SIZE - 1)],
+        __ATOMIC_ACQUIRE);
+    if (!leaf) { return NULL; }
+
+    return &leaf[page & (PRV_LEVEL_SIZE - 1)];
+}
+
+static bool prv_alloc_registry_map(alloc_registry_t *reg, uintptr_t page,
+                                   const alloc_region_t *region) {
+    uintptr_t *const slot = prv_alloc_registry_slot(reg, page);
+    if (!slot) { return false; }
+
+    const uintptr_t old = *slot;
+    if (old == 0) {
+        __atomic_store_n(slot, (uintptr_t)region, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    alloc_registry_cell_t *const cell =
+        prv_alloc_registry_take(reg, sizeof(alloc_registry_cell_t));
+    if (!cell) { return false; }
+    cell->region = region;
+
+    if (old & 1) {
+        cell->next = (alloc_registry_cell_t *)(old & ~(uintptr_t)1);
+    } else {
+        alloc_registry_cell_t *const old_cell =
+            prv_alloc_registry_take(reg, sizeof(alloc_registry_cell_t));
+        if (!old_cell) { return false; }
+        old_cell->region = (const alloc_region_t *)old;
+        cell->next = old_cell;
+    }
+
+    __atomic_store_n(slot, (uintptr_t)cell | 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*
+ * Removes @a region from the slots of its pages. Unlinked cells are left as
+ * they are, so that a lookup that has just loaded one can still follow it.
+ */
+static void prv_alloc_registry_unmap(alloc_registry_t *reg,
+                                     const alloc_region_t *region) {
+    const uintptr_t first = region->start >> YTALLOC_REGISTRY_PAGE_SHIFT;
+    const uintptr_t last = (region->end - 1) >> YTALLOC_REGISTRY_PAGE_SHIFT;
+
+    for (uintptr_t page = first; page <= last; page++) {
+        uintptr_t *const slot = (uintptr_t *)prv_alloc_registry_peek(reg, page);
+        if (!slot) { continue; }
+
+        const uintptr_t value = *slot;
+        if (value == (uintptr_t)region) {
+            __atomic_store_n(slot, 0, __ATOMIC_RELEASE);
+            continue;
+        }
+        if ((value & 1) == 0) { continue; }
+
+        alloc_registry_cell_t *const head =
+            (alloc_registry_cell_t *)(value & ~(uintptr_t)1);
+        if (head->region == region) {
+            const uintptr_t next = (uintptr_t)head->next;
+            __atomic_store_n(slot, next ? next | 1 : 0, __ATOMIC_RELEASE);
+            continue;
+        }
+        for (alloc_registry_cell_t *prev = head; prev->next;
+             prev = prev->next) {
+            if (prev->next->region == region) {
+                __atomic_store_n(&prev->next, prev->next->next,
+                                 __ATOMIC_RELEASE);
+                break;
+            }
+        }
+    }
+}
+
+static bool prv_alloc_registry_contains(const alloc_region_t *region,
+                                        uintptr_t addr) {
+    return addr >= region->start && addr < region->end;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <ytalloc/ytalloc.h>
+
+/*
+ * Hooks for the heap engines into the registry set with #alloc_set_registry().
+ * They do nothing if no registry is set. alloc_registry_forget() must be called
+ * wherever the memory of a heap is given back, so that the region does not
+ * outlive it.
+ */
+
+void alloc_registry_note(alloc_kind_t kind, void *heap, const void *start,
+                         size_t size);
+void alloc_registry_forget(const void *heap);
+bool alloc_registry_owns(const void *heap, const void *ptr);
@@ -0,0 +1,218 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_lock.h"
+#include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
+
+#define ALLOC_RING_HDR_SIZE YTALLOC_RING_ALIGN
+
+#define ALLOC_RING_FLAG_RELEASED ((size_t)1 << 0)
+#define ALLOC_RING_FLAG_PAD      ((size_t)1 << 1)
+#define ALLOC_RING_FLAGS_MASK    ((size_t)YTALLOC_RING_ALIGN - 1)
+
+static_assert(YTALLOC_RING_ALIGN >= sizeof(size_t));
+
+/**
+ * Chunk header. `tag` holds the size of the chunk, including the header, and
+ * the flags in the bits below #YTALLOC_RING_ALIGN.
+ */
+typedef struct {
+    size_t tag;
+} alloc_ring_hdr_t;
+
+static alloc_ring_hdr_t *prv_alloc_ring_hdr(const alloc_ring_t *ring,
+                                            size_t offset);
+static void *prv_alloc_ring_place(alloc_ring_t *ring, size_t need);
+static void prv_alloc_ring_reclaim(alloc_ring_t *ring);
+
+/**
+ * Initializes a ring heap.
+ *
+ * Allocations are carved from a circular buffer one after another, each with a
+ * header of #YTALLOC_RING_ALIGN bytes. Freeing the oldest allocation advances
+ * the tail in O(1). Allocations freed out of order are only marked as released
+ * and are reclaimed once the tail reaches them.
+ *
+ * @param ring  Ring structure pointer.
+ * @param start Start of the ring region, aligned at #YTALLOC_RING_ALIGN.
+ * @param size  Size of the ring region.
+ */
+void alloc_ring_init(alloc_ring_t *ring, void *start, size_t size) {
+    ASSERT_ALWAYS(ring != NULL);
+    ASSERT_ALWAYS(start != NULL);
+    ASSERTF_ALWAYS((uintptr_t)start % YTALLOC_RING_ALIGN == 0,
+                   "start must be %d-byte aligned", YTALLOC_RING_ALIGN);
+    ASSERTF_ALWAYS(size >= 2 * ALLOC_RING_HDR_SIZE, "size must be >= %d",
+                   2 * ALLOC_RING_HDR_SIZE);
+
+    memset(ring, 0, sizeof(*ring));
+    ring->start = (uintptr_t)start;
+    ring->end = ring->start + size;
+    ring->capacity = size & ~(size_t)(YTALLOC_RING_ALIGN - 1);
+
+    alloc_registry_note(ALLOC_KIND_RING, ring, start, size);
+}
+
+void *alloc_ring(alloc_ring_t *ring, size_t size) {
+    ASSERT_DEBUG(ring != NULL);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > ring->capacity - ALLOC_RING_HDR_SIZE) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_RING, t0, NULL, size, 0);
+        return NULL;
+    }
+    const size_t need = ALLOC_RING_HDR_SIZE +
+                        ((size + (YTALLOC_RING_ALIGN - 1)) &
+                         ~(size_t)(YTALLOC_RING_ALIGN - 1));
+
+    if (ring->num_used == 0) {
+        // Start over at the beginning to keep the allocations contiguous.
+        ring->head = 0;
+        ring->tail = 0;
+    }
+
+    if (ring->head >= ring->tail) {
+        // The free space is [head, capacity) followed by [0, tail).
+        const bool full = ring->num_used != 0 && ring->head == ring->tail;
+        const bool fits_at_head = ring->capacity - ring->head >= need;
+        if (full || (!fits_at_head && ring->tail < need)) {
+            ALLOC_STATS_ALLOC(ALLOC_KIND_RING, t0, NULL, size, 0);
+            return NULL;
+        }
+
+        if (!fits_at_head) {
+            // Skip the end of the buffer with a released padding chunk. The
+            // space left there is a multiple of the header size, so it fits a
+            // header.
+            const size_t pad = ring->capacity - ring->head;
+            if (pad != 0) {
+                alloc_ring_hdr_t *const hdr =
+                    prv_alloc_ring_hdr(ring, ring->head);
+                hdr->tag = pad | ALLOC_RING_FLAG_PAD | ALLOC_RING_FLAG_RELEASED;
+                ring->num_used += pad;
+            }
+            ring->head = 0;
+        }
+    } else if (ring->tail - ring->head < need) {
+        // The free space is [head, tail).
+        ALLOC_STATS_ALLOC(ALLOC_KIND_RING, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    void *const ptr = prv_alloc_ring_place(ring, need);
+    ALLOC_STATS_ALLOC(ALLOC_KIND_RING, t0, ptr, size, need);
+    return ptr;
+}
+
+void alloc_ring_free(alloc_ring_t *ring, void *ptr) {
+    ASSERT_DEBUG(ring != NULL);
+    if (!ptr) { return; }
+    ASSERTF_DEBUG(alloc_registry_owns(ring, ptr),
+                  "%p is in a region of another heap", ptr);
+    ALLOC_STATS_START(t0);
+
+    const uintptr_t addr = (uintptr_t)ptr;
+    ASSERTF_ALWAYS(ring->start + ALLOC_RING_HDR_SIZE <= addr &&
+                       addr < ring->start + ring->capacity,
+                   "ptr %p is outside the ring", ptr);
+
+    const size_t offset = addr - ALLOC_RING_HDR_SIZE - ring->start;
+    alloc_ring_hdr_t *const hdr = prv_alloc_ring_hdr(ring, offset);
+    ASSERTF_ALWAYS((hdr->tag & ALLOC_RING_FLAG_RELEASED) == 0,
+                   "double free of %p", ptr);
+
+    hdr->tag |= ALLOC_RING_FLAG_RELEASED;
+    ring->num_live--;
+    ALLOC_STATS_FREE(ALLOC_KIND_RING, t0, 1,
+                     hdr->tag & ~ALLOC_RING_FLAGS_MASK);
+
+    if (offset == ring->tail) { prv_alloc_ring_reclaim(ring); }
+}
+
+void alloc_ring_set_lock(alloc_ring_t *ring, const alloc_lock_t *lock) {
+    ASSERT_DEBUG(ring != NULL);
+    ring->lock = lock;
+}
+
+void *alloc_ring_locked(alloc_ring_t *ring, size_t size) {
+    ASSERT_DEBUG(ring != NULL);
+    if (size == 0) { return NULL; }
+
+    alloc_lock_acquire(ring->lock);
+    void *const ptr = alloc_ring(ring, size);
+    alloc_lock_release(ring->lock);
+
+    return ptr;
+}
+
+void alloc_ring_free_locked(alloc_ring_t *ring, void *ptr) {
+    ASSERT_DEBUG(ring != NULL);
+    if (!ptr) { return; }
+
+    alloc_lock_acquire(ring->lock);
+    alloc_ring_free(ring, ptr);
+    alloc_lock_release(ring->lock);
+}
+
+/**
+ * Returns the number of bytes taken by the live and not yet reclaimed chunks,
+ * including their headers.
+ */
+size_t alloc_ring_num_used(const alloc_ring_t *ring) {
+    ASSERT_DEBUG(ring != NULL);
+    return ring->num_used;
+}
+
+/**
+ * Returns the number of allocations that have not been freed.
+ */
+size_t alloc_ring_num_live(const alloc_ring_t *ring) {
+    ASSERT_DEBUG(ring != NULL);
+    return ring->num_live;
+}
+
+static alloc_ring_hdr_t *prv_alloc_ring_hdr(const alloc_ring_t *ring,
+                                            size_t offset) {
+    return (alloc_ring_hdr_t *)(ring->start + offset);
+}
+
+/**
+ * Puts a chunk of @a need bytes at the head. The caller checks the space.
+ */
+static void *prv_alloc_ring_place(alloc_ring_t *ring, size_t need) {
+    alloc_ring_hdr_t *const hdr = prv_alloc_ring_hdr(ring, ring->head);
+    hdr->tag = need;
+
+    ring->head += need;
+    if (ring->head == ring->capacity) { ring->head = 0; }
+    ring->num_used += need;
+    ring->num_live++;
+
+    return (uint8_t *)hdr + ALLOC_RING_HDR_SIZE;
+}
+
+/**
+ * Advances the tail past every released chunk it points at.
+ */
+static void prv_alloc_ring_reclaim(alloc_ring_t *ring) {
+    while (ring->num_used > 0) {
+        const alloc_ring_hdr_t *const hdr =
+            prv_alloc_ring_hdr(ring, ring->tail);
+        if ((hdr->tag & ALLOC_RING_FLAG_RELEASED) == 0) { break; }
+
+        const size_t chunk_size = hdr->tag & ~ALLOC_RING_FLAGS_MASK;
+        ASSERT_DEBUG(chunk_size >= ALLOC_RING_HDR_SIZE);
+        ASSERT_DEBUG(chunk_size <= ring->num_used);
+
+        ring->num_used -= chunk_size;
+        ring->tail += chunk_size;
+        if (ring->tail == ring->capacity) { ring->tail = 0; }
+    }
+
+    if (ring->num_used == 0) {
+        ring->head = 0;
+        ring->tail = 0;
+    }
+}
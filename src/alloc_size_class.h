@@ -0,0 +1,43 @@
+#pragma once
+
+#include <ytalloc/ytalloc.h>
+
+/*
+ * Size classes of #alloc_heap_t and of the malloc replacement. They are spaced
+ * by 16 bytes up to 128 and then by a quarter of the previous power of two:
+ * 160, 192, 224, 256, 320, ..., 1024. Both tables below are expanded from these
+ * formulas by the preprocessor, so the hot paths only index them.
+ */
+#define PRV_CLASS_GROUP(S) ((size_t)(63 - __builtin_clzll((S) - 1)) - 7)
+#define PRV_CLASS_OF(S)                                                        \
+    ((S) <= 128 ? ((S) + 15) / 16 - ((S) != 0)                                 \
+                : 8 + 4 * PRV_CLASS_GROUP(S) +                                 \
+                      ((S) - (128 << PRV_CLASS_GROUP(S)) +                     \
+                       (32 << PRV_CLASS_GROUP(S)) - 1) /                       \
+                          (32 << PRV_CLASS_GROUP(S)) -                         \
+                      1)
+#define PRV_CLASS_SIZE(C)                                                      \
+    ((C) < 8 ? 16 * ((C) + 1)                                                  \
+             : (128 << ((C) - 8) / 4) + ((C) % 4 + 1) * (32 << ((C) - 8) / 4))
+
+#define PRV_OF_1(I)  PRV_CLASS_OF((unsigned long long)(I) * 16)
+#define PRV_OF_4(I)                                                            \
+    PRV_OF_1(I), PRV_OF_1(I + 1), PRV_OF_1(I + 2), PRV_OF_1(I + 3)
+#define PRV_OF_16(I)                                                           \
+    PRV_OF_4(I), PRV_OF_4(I + 4), PRV_OF_4(I + 8), PRV_OF_4(I + 12)
+#define PRV_SIZE_4(C)                                                          \
+    PRV_CLASS_SIZE(C), PRV_CLASS_SIZE(C + 1), PRV_CLASS_SIZE(C + 2),           \
+        PRV_CLASS_SIZE(C + 3)
+
+// Class of a request, indexed by the request size rounded up to 16 bytes.
+static const uint8_t g_alloc_class_of[YTALLOC_HEAP_SMALL_MAX / 16 + 1] = {
+    PRV_OF_16(0), PRV_OF_16(16), PRV_OF_16(32), PRV_OF_16(48), PRV_OF_1(64),
+};
+
+static const uint16_t g_alloc_class_sizes[YTALLOC_HEAP_NUM_CLASSES] = {
+    PRV_SIZE_4(0),  PRV_SIZE_4(4),  PRV_SIZE_4(8),
+    PRV_SIZE_4(12), PRV_SIZE_4(16),
+};
+
+static_assert(PRV_CLASS_SIZE(YTALLOC_HEAP_NUM_CLASSES - 1) ==
+              YTALLOC_HEAP_SMALL_MAX);
@@ -1,10 +1,63 @@
 #include <string.h>
 #include <ytalloc/ytalloc.h>
 
+#include "alloc_lock.h"
 #include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
+#include "aux/remote.h"
+
+static uintptr_t *prv_alloc_slab_link(const alloc_slab_t *heap, void *item);
+static void prv_alloc_slab_reset_items(alloc_slab_t *heap);
+static void *prv_alloc_slab_carve(alloc_slab_t *heap);
+static size_t prv_alloc_slab_pop_chain(alloc_slab_t *heap, void **out,
+                                       size_t n);
+static void prv_alloc_slab_construct(const alloc_slab_t *heap, void **items,
+                                     size_t n, uintptr_t fresh);
+static void prv_alloc_slab_chain(const alloc_slab_t *heap, void **ptrs,
+                                 size_t n);
+
+static void *prv_alloc_slab_ops_alloc(void *heap, size_t size);
+static void *prv_alloc_slab_ops_aligned_alloc(void *heap, size_t size,
+                                              size_t align);
+static void prv_alloc_slab_ops_free(void *heap, void *ptr, size_t size);
+static size_t prv_alloc_slab_ops_usable_size(const void *heap, const void *ptr,
+                                             size_t size);
+static void prv_alloc_slab_ops_stats(const void *heap, alloc_ops_stats_t *out);
+static void prv_alloc_slab_ops_reset(void *heap);
 
 void alloc_slab_init(alloc_slab_t *heap, void *v_start, size_t size,
                      size_t alloc_size) {
+    alloc_slab_init_opts(heap, v_start, size, alloc_size, NULL);
+}
+
+/**
+ * Initializes a slab heap with optional object caching.
+ *
+ * If @a opts has a constructor, it is called on an item the first time the
+ * item is allocated. Freed items stay constructed on the free list, so the
+ * constructor is not called again until the heap is reclaimed using
+ * #alloc_slab_reclaim(), which calls the destructor on every constructed item.
+ *
+ * While an item is free, the word at `opts->link_offset` holds the free list
+ * link. The constructed state must not live there: either reserve a word in the
+ * object or make @a alloc_size big enough to put the link after the payload.
+ *
+ * If @a opts has a colour cursor, the first item is placed at an offset that is
+ * a multiple of #YTALLOC_SLAB_COLOUR_ALIGN. The offset is taken from the space
+ * left over after the items and rotates every time the cursor is used, so that
+ * heaps sharing one cursor do not put their N-th items into the same cache
+ * sets. Coloured items are only aligned at the greatest common divisor of
+ * @a alloc_size and #YTALLOC_SLAB_COLOUR_ALIGN.
+ *
+ * @param heap       Heap structure pointer.
+ * @param v_start    Start of the heap region, aligned at @a alloc_size.
+ * @param size       Size of the heap region.
+ * @param alloc_size Size of an item.
+ * @param opts       Optional caching parameters (may be `NULL`).
+ */
+void alloc_slab_init_opts(alloc_slab_t *heap, void *v_start, size_t size,
+                          size_t alloc_size, const alloc_slab_opts_t *opts) {
     ASSERT_ALWAYS(heap != NULL);
     ASSERT_ALWAYS(v_start != NULL);
     ASSERTF_ALWAYS((uintptr_t)v_start % alloc_size == 0,
@@ -17,50 +70,310 @@ void alloc_slab_init(alloc_slab_t *heap, void *v_start, size_t size,
 
     memset(heap, 0, sizeof(alloc_slab_t));
 
+    if (opts) {
+        ASSERTF_ALWAYS(opts->link_offset + sizeof(uintptr_t) <= alloc_size,
+                       "link_offset (%zu) does not fit in alloc_size (%zu)",
+                       opts->link_offset, alloc_size);
+        ASSERTF_ALWAYS(opts->link_offset % alignof(uintptr_t) == 0,
+                       "link_offset (%zu) must be aligned at %zu",
+                       opts->link_offset, alignof(uintptr_t));
+        heap->link_offset = opts->link_offset;
+        heap->ctor = opts->ctor;
+        heap->dtor = opts->dtor;
+        heap->ctor_arg = opts->ctor_arg;
+    }
+
     const size_t used_size =
         (size % alloc_size == 0) ? size : (size - size % alloc_size);
 
+    if (opts && opts->colour_cursor) {
+        const size_t num_colours =
+            (size - used_size) / YTALLOC_SLAB_COLOUR_ALIGN + 1;
+        const size_t colour = *opts->colour_cursor % num_colours;
+        *opts->colour_cursor = colour + 1;
+        heap->colour_off = colour * YTALLOC_SLAB_COLOUR_ALIGN;
+    }
+
     heap->start = (uintptr_t)v_start;
     heap->end = heap->start + size;
     heap->used_size = used_size;
     heap->alloc_size = alloc_size;
     heap->num_items = used_size / alloc_size;
+    heap->dirty_end = heap->end;
 
-    for (size_t idx = 0; idx < size / alloc_size; idx++) {
-        uintptr_t *const ptr_to_next = v_start + alloc_size * idx;
-        if (idx + 1 == size / alloc_size) {
-            *ptr_to_next = 0;
-        } else {
-            *ptr_to_next = (uintptr_t)ptr_to_next + alloc_size;
-        }
-    }
-    heap->free_head = v_start;
+    prv_alloc_slab_reset_items(heap);
+
+    alloc_registry_note(ALLOC_KIND_SLAB, heap, v_start, size);
 }
 
 void *alloc_slab(alloc_slab_t *heap) {
     ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(!heap->owner || heap->owner == remote_thread_id());
+    ALLOC_STATS_START(t0);
 
-    if (heap->free_head == NULL) {
-        return NULL;
-    } else {
-        void *ptr = heap->free_head;
-        const uintptr_t next = *heap->free_head;
-        heap->free_head = (uintptr_t *)next;
+    if (__atomic_load_n(&heap->remote, __ATOMIC_RELAXED) != 0) {
+        alloc_slab_drain_remote(heap);
+    }
+
+    void *ptr = heap->free_head;
+    if (ptr) {
+        heap->free_head = (uintptr_t *)*prv_alloc_slab_link(heap, ptr);
         heap->num_used++;
-        return ptr;
+    } else if ((ptr = prv_alloc_slab_carve(heap))) {
+        heap->num_used++;
+        if (heap->ctor) { heap->ctor(ptr, heap->ctor_arg); }
+    }
+    ALLOC_STATS_ALLOC(ALLOC_KIND_SLAB, t0, ptr, heap->alloc_size,
+                      heap->alloc_size);
+    return ptr;
+}
+
+/**
+ * Allocates up to @a n items at once.
+ *
+ * Unlinks a whole chain from the free list, carves the rest from the never
+ * allocated items and updates the usage counter once instead of doing it per
+ * item.
+ *
+ * @param heap Heap structure pointer.
+ * @param out  Array of at least @a n pointers that receives the items.
+ * @param n    Number of items to allocate.
+ *
+ * @returns The number of items stored in @a out. It is less than @a n only if
+ * the heap has run out of free items.
+ */
+size_t alloc_slab_bulk(alloc_slab_t *heap, void **out, size_t n) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(out != NULL || n == 0);
+    ASSERT_DEBUG(!heap->owner || heap->owner == remote_thread_id());
+    ALLOC_STATS_START(t0);
+
+    if (__atomic_load_n(&heap->remote, __ATOMIC_RELAXED) != 0) {
+        alloc_slab_drain_remote(heap);
     }
+
+    const uintptr_t fresh = heap->fresh;
+    const size_t cnt = prv_alloc_slab_pop_chain(heap, out, n);
+    prv_alloc_slab_construct(heap, out, cnt, fresh);
+    ALLOC_STATS_BULK(ALLOC_KIND_SLAB, t0, n, cnt, heap->alloc_size,
+                     heap->alloc_size);
+    return cnt;
 }
 
 void alloc_slab_free(alloc_slab_t *heap, void *ptr) {
     ASSERT_DEBUG(heap != NULL);
     if (!ptr) { return; }
+    ASSERTF_DEBUG(alloc_registry_owns(heap, ptr),
+                  "%p is in a region of another heap", ptr);
+    ALLOC_STATS_START(t0);
 
-    uintptr_t *const ptr_to_next = ptr;
-    *ptr_to_next = (uintptr_t)heap->free_head;
-    heap->free_head = ptr_to_next;
+    *prv_alloc_slab_link(heap, ptr) = (uintptr_t)heap->free_head;
+    heap->free_head = ptr;
 
     ASSERT_ALWAYS(heap->num_used > 0);
     heap->num_used--;
+    ALLOC_STATS_FREE(ALLOC_KIND_SLAB, t0, 1, heap->alloc_size);
+}
+
+/**
+ * Frees @a n items at once.
+ *
+ * Links the items into a chain that is prepended to the free list as a whole,
+ * so that the free list head and the usage counter are updated only once.
+ *
+ * @param heap Heap structure pointer.
+ * @param ptrs Array of @a n pointers previously returned by #alloc_slab() or
+ *             #alloc_slab_bulk(). `NULL` entries are not allowed.
+ * @param n    Number of items to free.
+ */
+void alloc_slab_free_bulk(alloc_slab_t *heap, void **ptrs, size_t n) {
+    ASSERT_DEBUG(heap != NULL);
+    if (n == 0) { return; }
+    ASSERT_DEBUG(ptrs != NULL);
+    ASSERT_ALWAYS(heap->num_used >= n);
+    ALLOC_STATS_START(t0);
+
+    prv_alloc_slab_chain(heap, ptrs, n);
+    *prv_alloc_slab_link(heap, ptrs[n - 1]) = (uintptr_t)heap->free_head;
+    heap->free_head = ptrs[0];
+
+    heap->num_used -= n;
+    ALLOC_STATS_FREE(ALLOC_KIND_SLAB, t0, n, heap->alloc_size);
+}
+
+void alloc_slab_set_lock(alloc_slab_t *heap, const alloc_lock_t *lock) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
+
+/**
+ * Locked version of #alloc_slab().
+ *
+ * The remote queue is drained and the item is unlinked under the lock, but the
+ * constructor, if any, is called after the lock is released.
+ */
+void *alloc_slab_locked(alloc_slab_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
+
+    alloc_lock_acquire(heap->lock);
+    if (__atomic_load_n(&heap->remote, __ATOMIC_RELAXED) != 0) {
+        alloc_slab_drain_remote(heap);
+    }
+    const uintptr_t fresh = heap->fresh;
+    void *ptr = NULL;
+    const size_t cnt = prv_alloc_slab_pop_chain(heap, &ptr, 1);
+    alloc_lock_release(heap->lock);
+
+    if (cnt != 0) { prv_alloc_slab_construct(heap, &ptr, 1, fresh); }
+    ALLOC_STATS_ALLOC(ALLOC_KIND_SLAB, t0, ptr, heap->alloc_size,
+                      heap->alloc_size);
+    return ptr;
+}
+
+/**
+ * Locked version of #alloc_slab_bulk(). The new items are constructed after
+ * the lock is released.
+ */
+size_t alloc_slab_bulk_locked(alloc_slab_t *heap, void **out, size_t n) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(out != NULL || n == 0);
+    ALLOC_STATS_START(t0);
+
+    alloc_lock_acquire(heap->lock);
+    if (__atomic_load_n(&heap->remote, __ATOMIC_RELAXED) != 0) {
+        alloc_slab_drain_remote(heap);
+    }
+    const uintptr_t fresh = heap->fresh;
+    const size_t cnt = prv_alloc_slab_pop_chain(heap, out, n);
+    alloc_lock_release(heap->lock);
+
+    prv_alloc_slab_construct(heap, out, cnt, fresh);
+    ALLOC_STATS_BULK(ALLOC_KIND_SLAB, t0, n, cnt, heap->alloc_size,
+                     heap->alloc_size);
+    return cnt;
+}
+
+void alloc_slab_free_locked(alloc_slab_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+
+    alloc_lock_acquire(heap->lock);
+    alloc_slab_free(heap, ptr);
+    alloc_lock_release(heap->lock);
+}
+
+/**
+ * Locked version of #alloc_slab_free_bulk().
+ *
+ * The items are linked to each other before the lock is taken, so only the
+ * splice of the chain into the free list is done under the lock.
+ */
+void alloc_slab_free_bulk_locked(alloc_slab_t *heap, void **ptrs, size_t n) {
+    ASSERT_DEBUG(heap != NULL);
+    if (n == 0) { return; }
+    ASSERT_DEBUG(ptrs != NULL);
+    ALLOC_STATS_START(t0);
+
+    prv_alloc_slab_chain(heap, ptrs, n);
+
+    alloc_lock_acquire(heap->lock);
+    ASSERT_ALWAYS(heap->num_used >= n);
+    *prv_alloc_slab_link(heap, ptrs[n - 1]) = (uintptr_t)heap->free_head;
+    heap->free_head = ptrs[0];
+    heap->num_used -= n;
+    alloc_lock_release(heap->lock);
+    ALLOC_STATS_FREE(ALLOC_KIND_SLAB, t0, n, heap->alloc_size);
+}
+
+/**
+ * Makes the calling thread the owner of @a heap.
+ *
+ * Only the owner may allocate from the heap and free items with
+ * #alloc_slab_free(). Other threads free items with #alloc_slab_free_remote(),
+ * which puts them onto a lock-free queue. The owner takes the whole queue back
+ * into the free list on its next allocation.
+ */
+void alloc_slab_set_owner(alloc_slab_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->owner = remote_thread_id();
+}
+
+/**
+ * Frees an item from any thread.
+ *
+ * The owner frees the item right away. Other threads queue it without taking
+ * a lock and without touching the free list. Queued items still count as used
+ * until the owner drains the queue.
+ */
+void alloc_slab_free_remote(alloc_slab_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(heap->owner != NULL, "%s", "the heap has no owner");
+    if (!ptr) { return; }
+
+    if (heap->owner == remote_thread_id()) {
+        alloc_slab_free(heap, ptr);
+    } else {
+        remote_push(&heap->remote, ptr, prv_alloc_slab_link(heap, ptr));
+    }
+}
+
+/**
+ * Moves the items freed by other threads into the free list. Only the owner may
+ * call this, or any thread that holds the heap lock.
+ *
+ * @returns The number of items moved.
+ */
+size_t alloc_slab_drain_remote(alloc_slab_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+
+    const uintptr_t first = remote_take(&heap->remote);
+    if (!first) { return 0; }
+
+    // The queue is already linked through the same words as the free list, so
+    // it is spliced in as a whole.
+    size_t cnt = 1;
+    uintptr_t last = first;
+    for (uintptr_t next; (next = *prv_alloc_slab_link(heap, (void *)last));
+         last = next) {
+        cnt++;
+    }
+    *prv_alloc_slab_link(heap, (void *)last) = (uintptr_t)heap->free_head;
+    heap->free_head = (uintptr_t *)first;
+
+    ASSERT_ALWAYS(heap->num_used >= cnt);
+    heap->num_used -= cnt;
+    // Items freed by other threads are counted here, once they are really free.
+    ALLOC_STATS_FREE(ALLOC_KIND_SLAB, 0, cnt, heap->alloc_size);
+    return cnt;
+}
+
+/**
+ * Destroys every constructed item and makes the heap pristine again.
+ *
+ * All items must be free. The destructor, if any, is called on every item that
+ * has ever been allocated. After this the heap region may be reused for other
+ * purposes or the heap may be used again, in which case the items are
+ * constructed anew.
+ *
+ * @param heap Heap structure pointer.
+ */
+void alloc_slab_reclaim(alloc_slab_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_ALWAYS(heap->num_used == 0,
+                   "cannot reclaim a heap with %zu used items",
+                   heap->num_used);
+
+    if (heap->dtor) {
+        for (uintptr_t item = heap->start + heap->colour_off;
+             item < heap->fresh;
+             item += heap->alloc_size) {
+            heap->dtor((void *)item, heap->ctor_arg);
+        }
+    }
+
+    if (heap->fresh > heap->dirty_end) { heap->dirty_end = heap->fresh; }
+    prv_alloc_slab_reset_items(heap);
 }
 
 size_t alloc_slab_num_free(const alloc_slab_t *heap) {
@@ -77,3 +390,217 @@ size_t alloc_slab_num_items(const alloc_slab_t *heap) {
     ASSERT_DEBUG(heap != NULL);
     return heap->num_items;
 }
+
+/**
+ * Same as #alloc_slab(), but fails if an item is smaller than @a size and tells
+ * the item size otherwise.
+ *
+ * @param heap     Heap structure pointer.
+ * @param size     Minimum size of the item.
+ * @param out_size Receives the item size if the allocation succeeds.
+ */
+void *alloc_slab_at_least(alloc_slab_t *heap, size_t size, size_t *out_size) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(out_size != NULL);
+
+    if (size > heap->alloc_size) { return NULL; }
+    void *const ptr = alloc_slab(heap);
+    if (ptr) { *out_size = heap->alloc_size; }
+    return ptr;
+}
+
+/**
+ * Returns the size of the item at @a ptr, which is the item size of the heap.
+ */
+size_t alloc_slab_usable_size(const alloc_slab_t *heap, const void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(heap->start <= (uintptr_t)ptr && (uintptr_t)ptr < heap->end,
+                  "%s", "ptr is outside the heap");
+    (void)ptr;
+    return heap->alloc_size;
+}
+
+/**
+ * Tells the heap that its never allocated items are zero-filled, e.g. because
+ * the region was just mapped with `mmap()`. #alloc_slab_calloc() then returns
+ * such items without clearing them.
+ */
+void alloc_slab_set_zeroed(alloc_slab_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->dirty_end = heap->fresh;
+}
+
+/**
+ * Allocates a zero-filled item. The heap must not have a constructor.
+ *
+ * Items that have never been allocated since #alloc_slab_set_zeroed() are not
+ * touched at all, which saves both the `memset()` and the page faults it would
+ * cause.
+ */
+void *alloc_slab_calloc(alloc_slab_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(heap->ctor == NULL, "%s",
+                  "calloc would clear the constructed state");
+
+    // Items from here on have never been allocated.
+    const uintptr_t clean =
+        heap->fresh > heap->dirty_end ? heap->fresh : heap->dirty_end;
+
+    void *const ptr = alloc_slab(heap);
+    if (!ptr) { return NULL; }
+    if ((uintptr_t)ptr < clean) { memset(ptr, 0, heap->alloc_size); }
+    return ptr;
+}
+
+const alloc_ops_t alloc_slab_ops = {
+    .name = "slab",
+    .alloc = prv_alloc_slab_ops_alloc,
+    .aligned_alloc = prv_alloc_slab_ops_aligned_alloc,
+    .free = prv_alloc_slab_ops_free,
+    .usable_size = prv_alloc_slab_ops_usable_size,
+    .stats = prv_alloc_slab_ops_stats,
+    .reset = prv_alloc_slab_ops_reset,
+};
+
+static uintptr_t *prv_alloc_slab_link(const alloc_slab_t *heap, void *item) {
+    return (uintptr_t *)((uintptr_t)item + heap->link_offset);
+}
+
+/**
+ * Makes every item of the heap never allocated.
+ *
+ * The free list only holds freed items. The never allocated ones start at
+ * `heap->fresh` and are carved in address order when the free list is empty,
+ * so that initializing a heap does not write to its items.
+ */
+static void prv_alloc_slab_reset_items(alloc_slab_t *heap) {
+    heap->free_head = NULL;
+    heap->fresh = heap->start + heap->colour_off;
+}
+
+/**
+ * Takes the next never allocated item without constructing it.
+ *
+ * @returns The item or `NULL` if every item has been allocated.
+ */
+static void *prv_alloc_slab_carve(alloc_slab_t *heap) {
+    const uintptr_t items_end =
+        heap->start + heap->colour_off + heap->num_items * heap->alloc_size;
+    if (heap->fresh >= items_end) { return NULL; }
+    void *const item = (void *)heap->fresh;
+    heap->fresh += heap->alloc_size;
+    return item;
+}
+
+/**
+ * Unlinks up to @a n items from the head of the free list and carves the rest
+ * from the never allocated items, without constructing them.
+ *
+ * @returns The number of items stored in @a out.
+ */
+static size_t prv_alloc_slab_pop_chain(alloc_slab_t *heap, void **out,
+                                       size_t n) {
+    uintptr_t *item = heap->free_head;
+    size_t cnt = 0;
+    while (cnt < n && item != NULL) {
+        uintptr_t *const next = (uintptr_t *)*prv_alloc_slab_link(heap, item);
+        if (next) { __builtin_prefetch(next, 1); }
+        out[cnt++] = item;
+        item = next;
+    }
+
+    heap->free_head = item;
+
+    void *fresh_item;
+    while (cnt < n && (fresh_item = prv_alloc_slab_carve(heap))) {
+        out[cnt++] = fresh_item;
+    }
+
+    heap->num_used += cnt;
+    return cnt;
+}
+
+/**
+ * Calls the constructor on the items of @a items that were never allocated
+ * before `heap->fresh` was @a fresh.
+ */
+static void prv_alloc_slab_construct(const alloc_slab_t *heap, void **items,
+                                     size_t n, uintptr_t fresh) {
+    if (!heap->ctor) { return; }
+    for (size_t idx = 0; idx < n; idx++) {
+        if ((uintptr_t)items[idx] >= fresh) {
+            heap->ctor(items[idx], heap->ctor_arg);
+        }
+    }
+}
+
+/**
+ * Links each of the @a n items to the next one. The link of the last item is
+ * left for the caller.
+ */
+static void prv_alloc_slab_chain(const alloc_slab_t *heap, void **ptrs,
+                                 size_t n) {
+    constexpr size_t prefetch_dist = 8;
+
+    for (size_t idx = 0; idx + 1 < n; idx++) {
+        if (idx + prefetch_dist < n) {
+            __builtin_prefetch(ptrs[idx + prefetch_dist], 1);
+        }
+        ASSERT_DEBUG(ptrs[idx] != NULL);
+        *prv_alloc_slab_link(heap, ptrs[idx]) = (uintptr_t)ptrs[idx + 1];
+    }
+    ASSERT_DEBUG(ptrs[n - 1] != NULL);
+}
+
+static void *prv_alloc_slab_ops_alloc(void *v_heap, size_t size) {
+    alloc_slab_t *const heap = v_heap;
+    if (size > heap->alloc_size) { return NULL; }
+    return alloc_slab(heap);
+}
+
+/**
+ * Items are aligned at the lowest set bit of the item size and the colour
+ * offset, stricter alignments cannot be met.
+ */
+static void *prv_alloc_slab_ops_aligned_alloc(void *v_heap, size_t size,
+                                              size_t align) {
+    alloc_slab_t *const heap = v_heap;
+    const size_t bits = heap->alloc_size | heap->colour_off;
+    if (align > (bits & -bits)) { return NULL; }
+    return prv_alloc_slab_ops_alloc(heap, size);
+}
+
+static void prv_alloc_slab_ops_free(void *heap, void *ptr, size_t size) {
+    (void)size;
+    alloc_slab_free(heap, ptr);
+}
+
+static size_t prv_alloc_slab_ops_usable_size(const void *heap,
+                                             const void *ptr, size_t size) {
+    (void)size;
+    return alloc_slab_usable_size(heap, ptr);
+}
+
+static void prv_alloc_slab_ops_stats(const void *v_heap,
+                                     alloc_ops_stats_t *out) {
+    const alloc_slab_t *const heap = v_heap;
+    out->heap_size = heap->num_items * heap->alloc_size;
+    out->used_size = heap->num_used * heap->alloc_size;
+    out->free_size = out->heap_size - out->used_size;
+}
+
+/**
+ * Frees every item at once and reclaims the heap, see #alloc_slab_reclaim().
+ * Items queued by other threads are dropped.
+ */
+static void prv_alloc_slab_ops_reset(void *v_heap) {
+    alloc_slab_t *const heap = v_heap;
+    __atomic_store_n(&heap->remote, 0, __ATOMIC_RELAXED);
+    // The items queued by other threads are still counted as used.
+    if (heap->num_used != 0) {
+        ALLOC_STATS_FREE(ALLOC_KIND_SLAB, 0, 1,
+                         heap->num_used * heap->alloc_size);
+    }
+    heap->num_used = 0;
+    alloc_slab_reclaim(heap);
+}
@@ -0,0 +1,179 @@
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_lock.h"
+#include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
+#include "aux/auxmath.h"
+#include "aux/bitmap.h"
+
+static size_t prv_alloc_slab_bitmap_index(const alloc_slab_bitmap_t *heap,
+                                          const void *ptr);
+
+/**
+ * Initializes a slab heap that tracks free items using a bitmap.
+ *
+ * Unlike #alloc_slab_init(), the items are not used to store free list links,
+ * so @a alloc_size may be as small as one byte. The cost is one bit of
+ * @a bitmap per item.
+ *
+ * @param heap        Heap structure pointer.
+ * @param v_start     Start of the heap region.
+ * @param size        Size of the heap region.
+ * @param alloc_size  Size of an item.
+ * @param bitmap      Bitmap storage, aligned at 8 bytes.
+ * @param bitmap_size Size of @a bitmap in bytes.
+ */
+void alloc_slab_bitmap_init(alloc_slab_bitmap_t *heap, void *v_start,
+                            size_t size, size_t alloc_size, void *bitmap,
+                            size_t bitmap_size) {
+    ASSERT_ALWAYS(heap != NULL);
+    ASSERT_ALWAYS(v_start != NULL);
+    ASSERT_ALWAYS(bitmap != NULL);
+    ASSERT_ALWAYS(alloc_size > 0);
+    ASSERT_ALWAYS(size >= alloc_size);
+    ASSERTF_ALWAYS((uintptr_t)bitmap % sizeof(uint64_t) == 0,
+                   "bitmap must be aligned at %zu", sizeof(uint64_t));
+
+    const size_t num_items = size / alloc_size;
+    const size_t num_words = (num_items + 63) / 64;
+    const size_t need_bitmap_size = num_words * sizeof(uint64_t);
+    ASSERTF_ALWAYS(bitmap_size >= need_bitmap_size,
+                   "bitmap_size must be >= %zu", need_bitmap_size);
+
+    memset(heap, 0, sizeof(*heap));
+    heap->start = (uintptr_t)v_start;
+    heap->end = heap->start + size;
+    heap->used_size = num_items * alloc_size;
+    heap->alloc_size = alloc_size;
+    heap->alloc_shift = (alloc_size & (alloc_size - 1)) == 0
+                            ? alloc_calc_log2(alloc_size)
+                            : SIZE_MAX;
+    heap->bitmap = bitmap;
+    heap->num_words = num_words;
+    heap->num_items = num_items;
+
+    // The bits past the last item are marked used, so that they are never
+    // found by the scans.
+    memset(heap->bitmap, 0, need_bitmap_size);
+    if (num_items % 64 != 0) {
+        heap->bitmap[num_words - 1] = ~(uint64_t)0 << (num_items % 64);
+    }
+
+    alloc_registry_note(ALLOC_KIND_SLAB_BITMAP, heap, v_start, size);
+}
+
+void *alloc_slab_bitmap(alloc_slab_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
+
+    // All the words before the hint are full.
+    const size_t idx = bitmap_find_zero(heap->bitmap, heap->hint,
+                                        heap->num_words);
+    if (idx == SIZE_MAX) {
+        heap->hint = heap->num_words;
+        ALLOC_STATS_ALLOC(ALLOC_KIND_SLAB_BITMAP, t0, NULL, heap->alloc_size,
+                          heap->alloc_size);
+        return NULL;
+    }
+
+    heap->hint = idx / 64;
+    heap->bitmap[idx / 64] |= (uint64_t)1 << (idx % 64);
+    heap->num_used++;
+
+    void *const ptr = (void *)(heap->start + idx * heap->alloc_size);
+    ALLOC_STATS_ALLOC(ALLOC_KIND_SLAB_BITMAP, t0, ptr, heap->alloc_size,
+                      heap->alloc_size);
+    return ptr;
+}
+
+void alloc_slab_bitmap_free(alloc_slab_bitmap_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+    ASSERTF_DEBUG(alloc_registry_owns(heap, ptr),
+                  "%p is in a region of another heap", ptr);
+    ALLOC_STATS_START(t0);
+
+    const size_t idx = prv_alloc_slab_bitmap_index(heap, ptr);
+    const size_t word = idx / 64;
+    const uint64_t mask = (uint64_t)1 << (idx % 64);
+
+    ASSERTF_ALWAYS((heap->bitmap[word] & mask) != 0,
+                   "double free of item #%zu at %p", idx, ptr);
+    heap->bitmap[word] &= ~mask;
+    heap->num_used--;
+
+    if (word < heap->hint) { heap->hint = word; }
+    ALLOC_STATS_FREE(ALLOC_KIND_SLAB_BITMAP, t0, 1, heap->alloc_size);
+}
+
+void alloc_slab_bitmap_set_lock(alloc_slab_bitmap_t *heap,
+                                const alloc_lock_t *lock) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
+
+void *alloc_slab_bitmap_locked(alloc_slab_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = alloc_slab_bitmap(heap);
+    alloc_lock_release(heap->lock);
+
+    return ptr;
+}
+
+void alloc_slab_bitmap_free_locked(alloc_slab_bitmap_t *heap, void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    if (!ptr) { return; }
+
+    alloc_lock_acquire(heap->lock);
+    alloc_slab_bitmap_free(heap, ptr);
+    alloc_lock_release(heap->lock);
+}
+
+bool alloc_slab_bitmap_is_used(const alloc_slab_bitmap_t *heap,
+                               const void *ptr) {
+    ASSERT_DEBUG(heap != NULL);
+    const size_t idx = prv_alloc_slab_bitmap_index(heap, ptr);
+    return (heap->bitmap[idx / 64] & ((uint64_t)1 << (idx % 64))) != 0;
+}
+
+size_t alloc_slab_bitmap_num_free(const alloc_slab_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->num_items - heap->num_used;
+}
+
+size_t alloc_slab_bitmap_num_used(const alloc_slab_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->num_used;
+}
+
+size_t alloc_slab_bitmap_num_items(const alloc_slab_bitmap_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->num_items;
+}
+
+/**
+ * Converts an item pointer to its index, checking that it points at an item.
+ */
+static size_t prv_alloc_slab_bitmap_index(const alloc_slab_bitmap_t *heap,
+                                          const void *ptr) {
+    const uintptr_t addr = (uintptr_t)ptr;
+    ASSERTF_ALWAYS(heap->start <= addr &&
+                       addr < heap->start + heap->used_size,
+                   "ptr %p is outside the heap", ptr);
+
+    const uintptr_t offset = addr - heap->start;
+    size_t idx;
+    if (heap->alloc_shift != SIZE_MAX) {
+        idx = offset >> heap->alloc_shift;
+    } else {
+        idx = offset / heap->alloc_size;
+    }
+    ASSERTF_DEBUG(idx * heap->alloc_size == offset,
+                  "ptr %p does not point at the start of an item", ptr);
+
+    return idx;
+}
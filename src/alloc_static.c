@@ -1,12 +1,28 @@
 #include <string.h>
 
+#include "alloc_lock.h"
 #include "alloc_macros.h"
+#include "alloc_registry.h"
+#include "alloc_stats.h"
 #include "ytalloc/ytalloc.h"
 
 static_assert((YTALLOC_STATIC_ALIGN == 1) || (YTALLOC_STATIC_ALIGN == 2) ||
               (YTALLOC_STATIC_ALIGN == 4) || (YTALLOC_STATIC_ALIGN == 8) ||
               (YTALLOC_STATIC_ALIGN == 16) || (YTALLOC_STATIC_ALIGN == 32));
 
+static size_t prv_alloc_static_round_size(size_t size);
+static void prv_alloc_static_note_dirty(alloc_static_t *heap);
+
+static void *prv_alloc_static_ops_alloc(void *heap, size_t size);
+static void *prv_alloc_static_ops_aligned_alloc(void *heap, size_t size,
+                                                size_t align);
+static void prv_alloc_static_ops_free(void *heap, void *ptr, size_t size);
+static size_t prv_alloc_static_ops_usable_size(const void *heap,
+                                               const void *ptr, size_t size);
+static void prv_alloc_static_ops_stats(const void *heap,
+                                       alloc_ops_stats_t *out);
+static void prv_alloc_static_ops_reset(void *heap);
+
 void alloc_static_init(alloc_static_t *heap, void *start, size_t size) {
     ASSERT_ALWAYS(heap != NULL);
     ASSERT_ALWAYS(start != NULL);
@@ -19,20 +35,555 @@ void alloc_static_init(alloc_static_t *heap, void *start, size_t size) {
     heap->end = heap->start + size;
 
     heap->next = heap->start;
+    heap->dirty_end = heap->end;
+
+    alloc_registry_note(ALLOC_KIND_STATIC, heap, start, size);
 }
 
 void *alloc_static(alloc_static_t *heap, size_t size) {
+    return alloc_static_aligned(heap, size, YTALLOC_STATIC_ALIGN);
+}
+
+/**
+ * Allocates @a size bytes aligned at @a align.
+ *
+ * Only the start of the allocation is aligned, the next allocation starts
+ * right after its end.
+ *
+ * @param heap  Heap structure pointer.
+ * @param size  Allocation size.
+ * @param align Alignment, a power of two.
+ *
+ * @returns Pointer to the allocation or `NULL` if there is not enough space.
+ */
+void *alloc_static_aligned(alloc_static_t *heap, size_t size, size_t align) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(align != 0 && (align & (align - 1)) == 0,
+                  "align (%zu) must be a power of two", align);
+    ALLOC_STATS_START(t0);
+
+    const uintptr_t ptr = (heap->next + (align - 1)) & ~(align - 1);
+    if (size == 0 || ptr < heap->next || ptr > heap->end ||
+        size > heap->end - ptr) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    // The padding before the allocation counts as granted.
+    ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC, t0, (void *)ptr, size,
+                      ptr + size - heap->next);
+    heap->next = ptr + size;
+    heap->last = ptr;
+
+    return (void *)ptr;
+}
+
+/**
+ * Resizes the most recent allocation in place.
+ *
+ * @param heap     Heap structure pointer.
+ * @param ptr      Pointer returned by the most recent allocation.
+ * @param new_size New size of the allocation, may be less than the old one.
+ *
+ * @returns `true` if the allocation has been resized, `false` if @a ptr is not
+ * the most recent allocation or there is not enough space.
+ */
+bool alloc_static_extend(alloc_static_t *heap, void *ptr, size_t new_size) {
+    ASSERT_DEBUG(heap != NULL);
+
+    const uintptr_t addr = (uintptr_t)ptr;
+    if (addr == 0 || addr != heap->last) { return false; }
+    if (new_size > heap->end - addr) { return false; }
+
+    prv_alloc_static_note_dirty(heap);
+    const uintptr_t next = addr + new_size;
+    if (next < heap->next) {
+        ALLOC_STATS_FREE(ALLOC_KIND_STATIC, 0, 1, heap->next - next);
+    } else if (next > heap->next) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC, 0, ptr, next - heap->next,
+                          next - heap->next);
+    }
+    heap->next = next;
+    return true;
+}
+
+/**
+ * Returns a checkpoint that #alloc_static_rewind() can return the heap to.
+ */
+alloc_static_mark_t alloc_static_mark(const alloc_static_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return (alloc_static_mark_t){.next = heap->next, .last = heap->last};
+}
+
+/**
+ * Frees everything allocated since @a mark was taken.
+ *
+ * Marks nest like a stack: rewinding to a mark invalidates every mark taken
+ * after it.
+ *
+ * @param heap Heap structure pointer.
+ * @param mark Mark returned by #alloc_static_mark() for this heap.
+ */
+void alloc_static_rewind(alloc_static_t *heap, alloc_static_mark_t mark) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_ALWAYS(heap->start <= mark.next && mark.next <= heap->next,
+                   "mark %p is not below the heap top %p", (void *)mark.next,
+                   (void *)heap->next);
+
+    prv_alloc_static_note_dirty(heap);
+    if (mark.next != heap->next) {
+        ALLOC_STATS_FREE(ALLOC_KIND_STATIC, 0, 1, heap->next - mark.next);
+    }
+    heap->next = mark.next;
+    heap->last = mark.last;
+}
+
+/**
+ * Frees everything allocated from the heap.
+ */
+void alloc_static_reset(alloc_static_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    prv_alloc_static_note_dirty(heap);
+    if (heap->next != heap->start) {
+        ALLOC_STATS_FREE(ALLOC_KIND_STATIC, 0, 1, heap->next - heap->start);
+    }
+    heap->next = heap->start;
+    heap->last = 0;
+}
+
+void alloc_static_set_lock(alloc_static_t *heap, const alloc_lock_t *lock) {
     ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
 
+/**
+ * Locked version of #alloc_static_aligned().
+ *
+ * When the heap is shared by many threads and nothing is freed,
+ * #alloc_static_atomic() scales better.
+ */
+void *alloc_static_locked(alloc_static_t *heap, size_t size, size_t align) {
+    ASSERT_DEBUG(heap != NULL);
     if (size == 0) { return NULL; }
 
-    uintptr_t new_next = heap->next + size;
-    new_next =
-        (new_next + (YTALLOC_STATIC_ALIGN - 1)) & ~(YTALLOC_STATIC_ALIGN - 1);
-    if (new_next > heap->end) { return NULL; }
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = alloc_static_aligned(heap, size, align);
+    alloc_lock_release(heap->lock);
+
+    return ptr;
+}
 
-    void *const ptr = (void *)heap->next;
-    heap->next = new_next;
+/**
+ * Tells the heap that its memory above the current top is zero-filled, e.g.
+ * because the region was just mapped with `mmap()`. #alloc_static_calloc() then
+ * clears only the memory that has been handed out before.
+ */
+void alloc_static_set_zeroed(alloc_static_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->dirty_end = heap->next;
+}
+
+/**
+ * Allocates a zero-filled array of @a num elements of @a size bytes.
+ *
+ * Memory that has never been handed out since #alloc_static_set_zeroed() is
+ * known to be zero and is not cleared again. That saves both the time of the
+ * `memset()` and, for a fresh mapping, the page faults it would cause.
+ *
+ * @returns Pointer to the allocation or `NULL` if the size overflows or there
+ * is not enough space.
+ */
+void *alloc_static_calloc(alloc_static_t *heap, size_t num, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
 
+    size_t total;
+    if (__builtin_mul_overflow(num, size, &total)) { return NULL; }
+
+    // Memory from here on has never been handed out.
+    const uintptr_t clean =
+        heap->next > heap->dirty_end ? heap->next : heap->dirty_end;
+
+    void *const ptr = alloc_static(heap, total);
+    if (ptr && (uintptr_t)ptr < clean) {
+        const size_t dirty = clean - (uintptr_t)ptr;
+        memset(ptr, 0, dirty < total ? dirty : total);
+    }
     return ptr;
 }
+
+/**
+ * Initializes a double-ended static heap.
+ *
+ * The heap allocates from both ends of one buffer: the low end grows up and
+ * the high end grows down. An allocation fails only if the two ends would
+ * meet. Each end has its own marks.
+ *
+ * @param heap  Heap structure pointer.
+ * @param start Start of the heap region, aligned at #YTALLOC_STATIC_ALIGN.
+ * @param size  Size of the heap region.
+ */
+void alloc_static_de_init(alloc_static_de_t *heap, void *start, size_t size) {
+    ASSERT_ALWAYS(heap != NULL);
+    ASSERT_ALWAYS(start != NULL);
+    ASSERTF_ALWAYS((uintptr_t)start % YTALLOC_STATIC_ALIGN == 0,
+                   "start must be %d-byte aligned", YTALLOC_STATIC_ALIGN);
+
+    memset(heap, 0, sizeof(*heap));
+
+    heap->start = (uintptr_t)start;
+    heap->end = heap->start + size;
+
+    heap->low = heap->start;
+    heap->high = heap->end;
+
+    alloc_registry_note(ALLOC_KIND_STATIC_DE, heap, start, size);
+}
+
+void *alloc_static_de(alloc_static_de_t *heap, alloc_static_end_t end,
+                      size_t size) {
+    return alloc_static_de_aligned(heap, end, size, YTALLOC_STATIC_ALIGN);
+}
+
+/**
+ * Allocates @a size bytes aligned at @a align from the end @a end.
+ *
+ * @returns Pointer to the allocation or `NULL` if the ends would overlap.
+ */
+void *alloc_static_de_aligned(alloc_static_de_t *heap, alloc_static_end_t end,
+                              size_t size, size_t align) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(align != 0 && (align & (align - 1)) == 0,
+                  "align (%zu) must be a power of two", align);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > heap->high - heap->low) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_DE, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    uintptr_t ptr;
+    if (end == ALLOC_STATIC_LOW) {
+        ptr = (heap->low + (align - 1)) & ~(align - 1);
+        if (ptr < heap->low || ptr > heap->high || size > heap->high - ptr) {
+            ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_DE, t0, NULL, size, 0);
+            return NULL;
+        }
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_DE, t0, (void *)ptr, size,
+                          ptr + size - heap->low);
+        heap->low = ptr + size;
+    } else {
+        ASSERT_DEBUG(end == ALLOC_STATIC_HIGH);
+        ptr = (heap->high - size) & ~(align - 1);
+        if (ptr < heap->low) {
+            ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_DE, t0, NULL, size, 0);
+            return NULL;
+        }
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_DE, t0, (void *)ptr, size,
+                          heap->high - ptr);
+        heap->high = ptr;
+    }
+
+    return (void *)ptr;
+}
+
+/**
+ * Returns a checkpoint of the end @a end for #alloc_static_de_rewind().
+ */
+alloc_static_de_mark_t alloc_static_de_mark(const alloc_static_de_t *heap,
+                                            alloc_static_end_t end) {
+    ASSERT_DEBUG(heap != NULL);
+    return (alloc_static_de_mark_t){
+        .end = end,
+        .pos = end == ALLOC_STATIC_LOW ? heap->low : heap->high,
+    };
+}
+
+/**
+ * Frees everything allocated from the end of @a mark since it was taken. The
+ * other end is not affected.
+ */
+void alloc_static_de_rewind(alloc_static_de_t *heap,
+                            alloc_static_de_mark_t mark) {
+    ASSERT_DEBUG(heap != NULL);
+
+    if (mark.end == ALLOC_STATIC_LOW) {
+        ASSERTF_ALWAYS(heap->start <= mark.pos && mark.pos <= heap->low,
+                       "mark %p is not below the low top %p",
+                       (void *)mark.pos, (void *)heap->low);
+        if (mark.pos != heap->low) {
+            ALLOC_STATS_FREE(ALLOC_KIND_STATIC_DE, 0, 1, heap->low - mark.pos);
+        }
+        heap->low = mark.pos;
+    } else {
+        ASSERTF_ALWAYS(heap->high <= mark.pos && mark.pos <= heap->end,
+                       "mark %p is not above the high top %p",
+                       (void *)mark.pos, (void *)heap->high);
+        if (mark.pos != heap->high) {
+            ALLOC_STATS_FREE(ALLOC_KIND_STATIC_DE, 0, 1,
+                             mark.pos - heap->high);
+        }
+        heap->high = mark.pos;
+    }
+}
+
+/**
+ * Frees everything allocated from both ends.
+ */
+void alloc_static_de_reset(alloc_static_de_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    if (heap->low != heap->start || heap->high != heap->end) {
+        ALLOC_STATS_FREE(ALLOC_KIND_STATIC_DE, 0, 1,
+                         (heap->low - heap->start) + (heap->end - heap->high));
+    }
+    heap->low = heap->start;
+    heap->high = heap->end;
+}
+
+/**
+ * Returns the number of bytes left between the two ends.
+ */
+size_t alloc_static_de_num_free(const alloc_static_de_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    return heap->high - heap->low;
+}
+
+void alloc_static_de_set_lock(alloc_static_de_t *heap,
+                              const alloc_lock_t *lock) {
+    ASSERT_DEBUG(heap != NULL);
+    heap->lock = lock;
+}
+
+void *alloc_static_de_locked(alloc_static_de_t *heap, alloc_static_end_t end,
+                             size_t size, size_t align) {
+    ASSERT_DEBUG(heap != NULL);
+    if (size == 0) { return NULL; }
+
+    alloc_lock_acquire(heap->lock);
+    void *const ptr = alloc_static_de_aligned(heap, end, size, align);
+    alloc_lock_release(heap->lock);
+
+    return ptr;
+}
+
+/**
+ * Initializes a static heap that can be shared by several threads.
+ *
+ * Allocations reserve space with a single atomic fetch-add, or a
+ * compare-and-swap loop if they need more than #YTALLOC_STATIC_ALIGN
+ * alignment. Threads that allocate often should lease sub-chunks using
+ * #alloc_static_atomic_local() instead of bouncing the cache line of `next`.
+ *
+ * @param heap  Heap structure pointer.
+ * @param start Start of the heap region, aligned at #YTALLOC_STATIC_ALIGN.
+ * @param size  Size of the heap region.
+ */
+void alloc_static_atomic_init(alloc_static_atomic_t *heap, void *start,
+                              size_t size) {
+    ASSERT_ALWAYS(heap != NULL);
+    ASSERT_ALWAYS(start != NULL);
+    ASSERTF_ALWAYS((uintptr_t)start % YTALLOC_STATIC_ALIGN == 0,
+                   "start must be %d-byte aligned", YTALLOC_STATIC_ALIGN);
+
+    memset(heap, 0, sizeof(*heap));
+
+    heap->start = (uintptr_t)start;
+    heap->end = heap->start + size;
+
+    __atomic_store_n(&heap->next, heap->start, __ATOMIC_RELAXED);
+
+    alloc_registry_note(ALLOC_KIND_STATIC_ATOMIC, heap, start, size);
+}
+
+/**
+ * Allocates @a size bytes aligned at #YTALLOC_STATIC_ALIGN. Thread-safe.
+ *
+ * The size is rounded up to #YTALLOC_STATIC_ALIGN, which keeps `next` aligned
+ * without a compare-and-swap.
+ *
+ * @returns Pointer to the allocation or `NULL` if there is not enough space.
+ */
+void *alloc_static_atomic(alloc_static_atomic_t *heap, size_t size) {
+    ASSERT_DEBUG(heap != NULL);
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > heap->end - heap->start) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, NULL, size, 0);
+        return NULL;
+    }
+    const size_t rounded_size = prv_alloc_static_round_size(size);
+
+    // Do not push `next` further once the heap is exhausted. This bounds how
+    // far past the end failed allocations can move it.
+    if (__atomic_load_n(&heap->next, __ATOMIC_RELAXED) >= heap->end) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    const uintptr_t ptr =
+        __atomic_fetch_add(&heap->next, rounded_size, __ATOMIC_RELAXED);
+    if (ptr > heap->end || rounded_size > heap->end - ptr) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, NULL, size, 0);
+        return NULL;
+    }
+
+    ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, (void *)ptr, size,
+                      rounded_size);
+    return (void *)ptr;
+}
+
+/**
+ * Allocates @a size bytes aligned at @a align. Thread-safe.
+ *
+ * @returns Pointer to the allocation or `NULL` if there is not enough space.
+ */
+void *alloc_static_atomic_aligned(alloc_static_atomic_t *heap, size_t size,
+                                  size_t align) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERTF_DEBUG(align != 0 && (align & (align - 1)) == 0,
+                  "align (%zu) must be a power of two", align);
+
+    if (align <= YTALLOC_STATIC_ALIGN) {
+        return alloc_static_atomic(heap, size);
+    }
+
+    ALLOC_STATS_START(t0);
+
+    if (size == 0 || size > heap->end - heap->start) {
+        ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, NULL, size, 0);
+        return NULL;
+    }
+    const size_t rounded_size = prv_alloc_static_round_size(size);
+
+    uintptr_t cur = __atomic_load_n(&heap->next, __ATOMIC_RELAXED);
+    uintptr_t ptr;
+    do {
+        ptr = (cur + (align - 1)) & ~(align - 1);
+        if (ptr < cur || ptr > heap->end || rounded_size > heap->end - ptr) {
+            ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, NULL, size, 0);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&heap->next, &cur, ptr + rounded_size,
+                                          true, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+
+    ALLOC_STATS_ALLOC(ALLOC_KIND_STATIC_ATOMIC, t0, (void *)ptr, size,
+                      rounded_size);
+    return (void *)ptr;
+}
+
+/**
+ * Allocates @a size bytes from the thread-local lease @a local.
+ *
+ * When @a local is exhausted, a new lease of @a lease_size bytes is taken from
+ * the shared @a heap and @a local is reinitialized over it; the rest of the
+ * old lease is abandoned. Allocations bigger than half a lease go directly to
+ * @a heap.
+ *
+ * @param heap       Shared heap structure pointer.
+ * @param local      Static heap owned by the calling thread. A zero-filled one
+ *                   has no lease yet.
+ * @param size       Allocation size.
+ * @param lease_size Size of a lease.
+ *
+ * @returns Pointer to the allocation or `NULL` if there is not enough space.
+ */
+void *alloc_static_atomic_local(alloc_static_atomic_t *heap,
+                                alloc_static_t *local, size_t size,
+                                size_t lease_size) {
+    ASSERT_DEBUG(heap != NULL);
+    ASSERT_DEBUG(local != NULL);
+
+    void *ptr = alloc_static(local, size);
+    if (ptr) { return ptr; }
+    if (size == 0) { return NULL; }
+
+    if (size > lease_size / 2) { return alloc_static_atomic(heap, size); }
+
+    void *const lease = alloc_static_atomic(heap, lease_size);
+    if (!lease) { return NULL; }
+    alloc_static_init(local, lease, lease_size);
+
+    return alloc_static(local, size);
+}
+
+/**
+ * Frees everything allocated from the heap. Not thread-safe.
+ */
+void alloc_static_atomic_reset(alloc_static_atomic_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    if (alloc_static_atomic_num_used(heap) != 0) {
+        ALLOC_STATS_FREE(ALLOC_KIND_STATIC_ATOMIC, 0, 1,
+                         alloc_static_atomic_num_used(heap));
+    }
+    __atomic_store_n(&heap->next, heap->start, __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns the number of bytes handed out so far, including padding.
+ */
+size_t alloc_static_atomic_num_used(const alloc_static_atomic_t *heap) {
+    ASSERT_DEBUG(heap != NULL);
+    const uintptr_t next = __atomic_load_n(&heap->next, __ATOMIC_RELAXED);
+    return (next < heap->end ? next : heap->end) - heap->start;
+}
+
+/**
+ * Rounds @a size up to a multiple of #YTALLOC_STATIC_ALIGN.
+ */
+const alloc_ops_t alloc_static_ops = {
+    .name = "static",
+    .alloc = prv_alloc_static_ops_alloc,
+    .aligned_alloc = prv_alloc_static_ops_aligned_alloc,
+    .free = prv_alloc_static_ops_free,
+    .usable_size = prv_alloc_static_ops_usable_size,
+    .stats = prv_alloc_static_ops_stats,
+    .reset = prv_alloc_static_ops_reset,
+};
+
+static size_t prv_alloc_static_round_size(size_t size) {
+    return (size + (YTALLOC_STATIC_ALIGN - 1)) &
+           ~(size_t)(YTALLOC_STATIC_ALIGN - 1);
+}
+
+static void *prv_alloc_static_ops_alloc(void *heap, size_t size) {
+    return alloc_static(heap, size);
+}
+
+static void *prv_alloc_static_ops_aligned_alloc(void *heap, size_t size,
+                                                size_t align) {
+    return alloc_static_aligned(heap, size, align);
+}
+
+// Memory is only given back by a reset.
+static void prv_alloc_static_ops_free(void *heap, void *ptr, size_t size) {
+    (void)heap;
+    (void)ptr;
+    (void)size;
+}
+
+static size_t prv_alloc_static_ops_usable_size(const void *heap,
+                                               const void *ptr, size_t size) {
+    (void)heap;
+    (void)ptr;
+    return size;
+}
+
+static void prv_alloc_static_ops_stats(const void *v_heap,
+                                       alloc_ops_stats_t *out) {
+    const alloc_static_t *const heap = v_heap;
+    out->heap_size = heap->end - heap->start;
+    out->used_size = heap->next - heap->start;
+    out->free_size = heap->end - heap->next;
+}
+
+static void prv_alloc_static_ops_reset(void *heap) {
+    alloc_static_reset(heap);
+}
+
+/**
+ * Raises the high-water mark of handed out memory to the heap top before the
+ * top is lowered.
+ */
+static void prv_alloc_static_note_dirty(alloc_static_t *heap) {
+    if (heap->next > heap->dirty_end) { heap->dirty_end = heap->next; }
+}
@@ -0,0 +1,453 @@
+/**
+ * @file alloc_stats.c
+ * Allocation counters and latency histograms of all heap engines.
+ *
+ * Each thread records into a slot of its own, so that the counters are plain
+ * stores to a cache line that no other thread writes. The threads past
+ * #YTALLOC_STATS_MAX_THREADS share one more slot, which is updated with atomic
+ * additions instead. #alloc_stats_get() adds up the slots.
+ *
+ * The high-water mark needs the live byte count of all threads at once. Each
+ * slot keeps the change it has made to it and adds the change to the shared
+ * count only when it reaches #YTALLOC_STATS_BATCH bytes either way, so the
+ * mark is exact for a single thread and to within that many bytes per other
+ * thread.
+ */
+
+#include <string.h>
+#include <ytalloc/ytalloc.h>
+
+#include "alloc_macros.h"
+#include "alloc_stats.h"
+
+#if defined(YTALLOC_STATS) && defined(YTALLOC_HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+#define PRV_NUM_KINDS (ALLOC_KIND_SLAB_BITMAP + 1)
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} prv_writer_t;
+
+static void prv_alloc_stats_put(prv_writer_t *writer, const char *str);
+static void prv_alloc_stats_put_u64(prv_writer_t *writer, uint64_t val);
+static void prv_alloc_stats_put_kind(prv_writer_t *writer,
+                                     alloc_stats_format_t format,
+                                     alloc_kind_t kind,
+                                     const alloc_stats_t *stats);
+
+static const char *const g_alloc_stats_kind_names[PRV_NUM_KINDS] = {
+    [ALLOC_KIND_LIST] = "list",
+    [ALLOC_KIND_STATIC] = "static",
+    [ALLOC_KIND_STATIC_DE] = "static_de",
+    [ALLOC_KIND_STATIC_ATOMIC] = "static_atomic",
+    [ALLOC_KIND_RING] = "ring",
+    [ALLOC_KIND_BUDDY] = "buddy",
+    [ALLOC_KIND_BITMAP] = "bitmap",
+    [ALLOC_KIND_SLAB] = "slab",
+    [ALLOC_KIND_SLAB_BITMAP] = "slab_bitmap",
+};
+
+#ifdef YTALLOC_STATS
+
+typedef struct {
+    alloc_stats_t kinds[PRV_NUM_KINDS];
+    int64_t pending[PRV_NUM_KINDS];
+    bool claimed;
+    bool shared;
+} prv_slot_t;
+
+static prv_slot_t *prv_alloc_stats_slot(void);
+static void prv_alloc_stats_add(const prv_slot_t *slot, uint64_t *counter,
+                                uint64_t val);
+static void prv_alloc_stats_add_live(prv_slot_t *slot, alloc_kind_t kind,
+                                     int64_t delta);
+static uint64_t prv_alloc_stats_ticks(void);
+#ifdef YTALLOC_HAVE_PTHREAD
+static void prv_alloc_stats_make_key(void);
+static void prv_alloc_stats_release(void *v_slot);
+#endif
+
+static prv_slot_t g_alloc_stats_slots[YTALLOC_STATS_MAX_THREADS + 1] = {
+    [YTALLOC_STATS_MAX_THREADS] = {.claimed = true, .shared = true},
+};
+static int64_t g_alloc_stats_live[PRV_NUM_KINDS];
+static uint64_t g_alloc_stats_peak[PRV_NUM_KINDS];
+
+// The library is position-independent, where the default TLS model would call
+// __tls_get_addr() on every operation.
+static _Thread_local prv_slot_t *g_alloc_stats_slot
+    __attribute__((tls_model("initial-exec")));
+_Thread_local uint32_t g_alloc_stats_countdown;
+
+#ifdef YTALLOC_HAVE_PTHREAD
+static pthread_once_t g_alloc_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_alloc_stats_key;
+#endif
+
+#endif
+
+/**
+ * Tells whether ytalloc has been built with the statistics. If not, the
+ * engines do not record anything and #alloc_stats_get() returns zeros.
+ */
+bool alloc_stats_enabled(void) {
+#ifdef YTALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Adds up the statistics of all heaps of the kind @a kind.
+ *
+ * Only the entry points of ytalloc.h are counted, not the fast paths of
+ * inline.h. Bulk operations count each item, but are timed as one operation.
+ * Allocations that fail count neither as allocations nor towards the byte
+ * counts. Resetting or rewinding a heap counts as one free of all the bytes it
+ * gives back. Resizing the most recent allocation of a static heap counts the
+ * bytes it adds as an allocation and the bytes it gives back as a free.
+ *
+ * Every 2^#YTALLOC_STATS_SAMPLE_SHIFT-th operation of a thread is timed with
+ * the CPU tick counter (`rdtsc` on x86, `cntvct_el0` on AArch64). Bucket `i` of
+ * a latency histogram counts the operations that took `[2^i, 2^(i + 1))`
+ * ticks, bucket 0 those that took less than 2.
+ *
+ * @param kind Heap kind.
+ * @param out  Receives the statistics.
+ */
+void alloc_stats_get(alloc_kind_t kind, alloc_stats_t *out) {
+    ASSERT_ALWAYS(out != NULL);
+    ASSERTF_ALWAYS(kind >= ALLOC_KIND_LIST && kind < PRV_NUM_KINDS,
+                   "unknown heap kind %d", (int)kind);
+
+    memset(out, 0, sizeof(*out));
+
+#ifdef YTALLOC_STATS
+    // Every field is a counter, apart from the peak, which is the greatest of
+    // the slot estimates and the shared mark.
+    static_assert(sizeof(alloc_stats_t) % sizeof(uint64_t) == 0);
+    uint64_t *const sum = (uint64_t *)out;
+    uint64_t peak =
+        __atomic_load_n(&g_alloc_stats_peak[kind], __ATOMIC_RELAXED);
+    int64_t live = __atomic_load_n(&g_alloc_stats_live[kind], __ATOMIC_RELAXED);
+    for (size_t idx = 0; idx <= YTALLOC_STATS_MAX_THREADS; idx++) {
+        const prv_slot_t *const slot = &g_alloc_stats_slots[idx];
+        const uint64_t *const counters = (const uint64_t *)&slot->kinds[kind];
+        for (size_t pos = 0; pos < sizeof(alloc_stats_t) / sizeof(uint64_t);
+             pos++) {
+            sum[pos] += __atomic_load_n(&counters[pos], __ATOMIC_RELAXED);
+        }
+        live += __atomic_load_n(&slot->pending[kind], __ATOMIC_RELAXED);
+
+        const uint64_t slot_peak =
+            __atomic_load_n(&slot->kinds[kind].peak_bytes, __ATOMIC_RELAXED);
+        if (slot_peak > peak) { peak = slot_peak; }
+    }
+
+    if (live > 0 && (uint64_t)live > peak) { peak = live; }
+    out->peak_bytes = peak;
+#endif
+}
+
+/**
+ * Zeroes all statistics. Operations that run concurrently may be lost.
+ */
+void alloc_stats_reset(void) {
+#ifdef YTALLOC_STATS
+    for (size_t idx = 0; idx <= YTALLOC_STATS_MAX_THREADS; idx++) {
+        prv_slot_t *const slot = &g_alloc_stats_slots[idx];
+        memset(slot->kinds, 0, sizeof(slot->kinds));
+        memset(slot->pending, 0, sizeof(slot->pending));
+    }
+    memset(g_alloc_stats_live, 0, sizeof(g_alloc_stats_live));
+    memset(g_alloc_stats_peak, 0, sizeof(g_alloc_stats_peak));
+#endif
+}
+
+/**
+ * Writes the statistics of every heap kind that has been used into @a buf,
+ * either as lines of text or as one JSON object keyed by the kind names.
+ *
+ * Like `snprintf()`, the output is cut to fit @a buf_size, terminator
+ * included, and the return value tells how long it would have been.
+ *
+ * @param format   Output format.
+ * @param buf      Output buffer, may be `NULL` if @a buf_size is 0.
+ * @param buf_size Size of @a buf.
+ *
+ * @returns The length of the whole output, without the terminator.
+ */
+size_t alloc_stats_dump(alloc_stats_format_t format, char *buf,
+                        size_t buf_size) {
+    ASSERT_ALWAYS(buf != NULL || buf_size == 0);
+    ASSERT_ALWAYS(format == ALLOC_STATS_TEXT || format == ALLOC_STATS_JSON);
+
+    prv_writer_t writer = {.buf = buf, .size = buf_size, .len = 0};
+    if (format == ALLOC_STATS_JSON) { prv_alloc_stats_put(&writer, "{"); }
+
+    bool first = true;
+    for (int kind = ALLOC_KIND_LIST; kind < PRV_NUM_KINDS; kind++) {
+        alloc_stats_t stats;
+        alloc_stats_get(kind, &stats);
+        if (stats.num_allocs == 0 && stats.num_frees == 0 &&
+            stats.num_failed == 0) {
+            continue;
+        }
+
+        if (format == ALLOC_STATS_JSON && !first) {
+            prv_alloc_stats_put(&writer, ",");
+        }
+        prv_alloc_stats_put_kind(&writer, format, kind, &stats);
+        first = false;
+    }
+
+    if (format == ALLOC_STATS_JSON) { prv_alloc_stats_put(&writer, "}"); }
+    if (buf_size > 0) {
+        buf[writer.len < buf_size ? writer.len : buf_size - 1] = '\0';
+    }
+    return writer.len;
+}
+
+#ifdef YTALLOC_STATS
+
+uint64_t alloc_stats_sample(void) {
+    g_alloc_stats_countdown = (1u << YTALLOC_STATS_SAMPLE_SHIFT) - 1;
+    return prv_alloc_stats_ticks();
+}
+
+void alloc_stats_note(alloc_kind_t kind, alloc_stats_op_t op, uint64_t t0,
+                      size_t num, size_t num_failed, size_t requested,
+                      size_t granted) {
+    prv_slot_t *const slot = prv_alloc_stats_slot();
+    alloc_stats_t *const stats = &slot->kinds[kind];
+
+    if (op == ALLOC_STATS_OP_ALLOC) {
+        if (num > 0) {
+            prv_alloc_stats_add(slot, &stats->num_allocs, num);
+            prv_alloc_stats_add(slot, &stats->bytes_requested, num * requested);
+            prv_alloc_stats_add(slot, &stats->bytes_granted, num * granted);
+            prv_alloc_stats_add_live(slot, kind, (int64_t)(num * granted));
+        }
+        if (num_failed > 0) {
+            prv_alloc_stats_add(slot, &stats->num_failed, num_failed);
+        }
+    } else {
+        prv_alloc_stats_add(slot, &stats->num_frees, num);
+        prv_alloc_stats_add(slot, &stats->bytes_freed, num * granted);
+        prv_alloc_stats_add_live(slot, kind, -(int64_t)(num * granted));
+    }
+
+    if (t0 != 0) {
+        const uint64_t ticks = prv_alloc_stats_ticks() - t0;
+        size_t bucket = ticks > 1 ? 63 - __builtin_clzll(ticks) : 0;
+        if (bucket >= YTALLOC_STATS_NUM_BUCKETS) {
+            bucket = YTALLOC_STATS_NUM_BUCKETS - 1;
+        }
+        prv_alloc_stats_add(slot, &stats->latency[op][bucket], 1);
+    }
+}
+
+#endif
+
+static void prv_alloc_stats_put(prv_writer_t *writer, const char *str) {
+    for (; *str; str++, writer->len++) {
+        if (writer->len + 1 < writer->size) { writer->buf[writer->len] = *str; }
+    }
+}
+
+static void prv_alloc_stats_put_u64(prv_writer_t *writer, uint64_t val) {
+    char digits[21];
+    size_t pos = sizeof(digits) - 1;
+    digits[pos] = '\0';
+    do {
+        digits[--pos] = '0' + val % 10;
+        val /= 10;
+    } while (val != 0);
+    prv_alloc_stats_put(writer, &digits[pos]);
+}
+
+/**
+ * Writes one heap kind. The text format has a line of counters and a line per
+ * non-empty histogram, with `bucket:count` pairs. The JSON format has a member
+ * per counter and the histograms as arrays of all buckets.
+ */
+static void prv_alloc_stats_put_kind(prv_writer_t *writer,
+                                     alloc_stats_format_t format,
+                                     alloc_kind_t kind,
+                                     const alloc_stats_t *stats) {
+    static const char *const counter_names[] = {
+        "allocs",          "frees",       "failed",     "bytes_requested",
+        "bytes_granted",   "bytes_freed", "peak_bytes",
+    };
+    static const char *const op_names[ALLOC_STATS_NUM_OPS] = {"alloc", "free"};
+    const uint64_t counters[] = {
+        stats->num_allocs,      stats->num_frees,     stats->num_failed,
+        stats->bytes_requested, stats->bytes_granted, stats->bytes_freed,
+        stats->peak_bytes,
+    };
+    const bool json = format == ALLOC_STATS_JSON;
+
+    prv_alloc_stats_put(writer, json ? "\"" : "");
+    prv_alloc_stats_put(writer, g_alloc_stats_kind_names[kind]);
+    prv_alloc_stats_put(writer, json ? "\":{" : ":");
+    for (size_t idx = 0; idx < sizeof(counters) / sizeof(counters[0]); idx++) {
+        prv_alloc_stats_put(writer, json ? (idx ? ",\"" : "\"") : " ");
+        prv_alloc_stats_put(writer, counter_names[idx]);
+        prv_alloc_stats_put(writer, json ? "\":" : "=");
+        prv_alloc_stats_put_u64(writer, counters[idx]);
+    }
+    prv_alloc_stats_put(writer, json ? "" : "\n");
+
+    for (int op = 0; op < ALLOC_STATS_NUM_OPS; op++) {
+        const uint64_t *const hist = stats->latency[op];
+        if (json) {
+            prv_alloc_stats_put(writer, ",\"");
+            prv_alloc_stats_put(writer, op_names[op]);
+            prv_alloc_stats_put(writer, "_latency\":[");
+            for (size_t bucket = 0; bucket < YTALLOC_STATS_NUM_BUCKETS;
+                 bucket++) {
+                if (bucket) { prv_alloc_stats_put(writer, ","); }
+                prv_alloc_stats_put_u64(writer, hist[bucket]);
+            }
+            prv_alloc_stats_put(writer, "]");
+            continue;
+        }
+
+        bool empty = true;
+        for (size_t bucket = 0; bucket < YTALLOC_STATS_NUM_BUCKETS; bucket++) {
+            if (hist[bucket] == 0) { continue; }
+            if (empty) {
+                prv_alloc_stats_put(writer, "  ");
+                prv_alloc_stats_put(writer, op_names[op]);
+                prv_alloc_stats_put(writer, "_latency:");
+                empty = false;
+            }
+            prv_alloc_stats_put(writer, " ");
+            prv_alloc_stats_put_u64(writer, bucket);
+            prv_alloc_stats_put(writer, ":");
+            prv_alloc_stats_put_u64(writer, hist[bucket]);
+        }
+        if (!empty) { prv_alloc_stats_put(writer, "\n"); }
+    }
+    prv_alloc_stats_put(writer, json ? "}" : "");
+}
+
+#ifdef YTALLOC_STATS
+
+/**
+ * Returns the slot of the calling thread, claiming a free one on the first
+ * call. The slot is given back when the thread exits.
+ */
+static prv_slot_t *prv_alloc_stats_slot(void) {
+    prv_slot_t *slot = g_alloc_stats_slot;
+    if (slot) { return slot; }
+
+    slot = &g_alloc_stats_slots[YTALLOC_STATS_MAX_THREADS];
+    for (size_t idx = 0; idx < YTALLOC_STATS_MAX_THREADS; idx++) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(&g_alloc_stats_slots[idx].claimed,
+                                        &expected, true, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            slot = &g_alloc_stats_slots[idx];
+            break;
+        }
+    }
+
+#ifdef YTALLOC_HAVE_PTHREAD
+    if (!slot->shared) {
+        pthread_once(&g_alloc_stats_once, prv_alloc_stats_make_key);
+        pthread_setspecific(g_alloc_stats_key, slot);
+    }
+#endif
+
+    g_alloc_stats_slot = slot;
+    return slot;
+}
+
+/**
+ * Adds @a val to a counter of @a slot. Only the owner writes to a slot that is
+ * not shared, so a plain store is enough there.
+ */
+static void prv_alloc_stats_add(const prv_slot_t *slot, uint64_t *counter,
+                                uint64_t val) {
+    if (slot->shared) {
+        __atomic_fetch_add(counter, val, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(counter,
+                         __atomic_load_n(counter, __ATOMIC_RELAXED) + val,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Changes the live byte count of @a kind and raises its high-water mark.
+ */
+static void prv_alloc_stats_add_live(prv_slot_t *slot, alloc_kind_t kind,
+                                     int64_t delta) {
+    int64_t pending = delta;
+    if (!slot->shared) {
+        pending += __atomic_load_n(&slot->pending[kind], __ATOMIC_RELAXED);
+        if (pending < YTALLOC_STATS_BATCH && pending > -YTALLOC_STATS_BATCH) {
+            __atomic_store_n(&slot->pending[kind], pending, __ATOMIC_RELAXED);
+            // The slot keeps its own estimate of the mark, which misses only
+            // the changes that other threads have not added yet.
+            uint64_t *const peak = &slot->kinds[kind].peak_bytes;
+            const int64_t live =
+                __atomic_load_n(&g_alloc_stats_live[kind], __ATOMIC_RELAXED) +
+                pending;
+            if (delta > 0 && live > 0 &&
+                (uint64_t)live > __atomic_load_n(peak, __ATOMIC_RELAXED)) {
+                __atomic_store_n(peak, live, __ATOMIC_RELAXED);
+            }
+            return;
+        }
+        __atomic_store_n(&slot->pending[kind], 0, __ATOMIC_RELAXED);
+    }
+
+    const int64_t live = __atomic_add_fetch(&g_alloc_stats_live[kind],
+                                            pending, __ATOMIC_RELAXED);
+    if (live <= 0) { return; }
+    uint64_t peak =
+        __atomic_load_n(&g_alloc_stats_peak[kind], __ATOMIC_RELAXED);
+    while ((uint64_t)live > peak &&
+           !__atomic_compare_exchange_n(&g_alloc_stats_peak[kind], &peak, live,
+                                        true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {}
+}
+
+static uint64_t prv_alloc_stats_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    // No cheap tick counter, so the latency histograms stay empty.
+    return 0;
+#endif
+}
+
+#ifdef YTALLOC_HAVE_PTHREAD
+static void prv_alloc_stats_make_key(void) {
+    pthread_key_create(&g_alloc_stats_key, prv_alloc_stats_release);
+}
+
+/**
+ * Gives the slot of an exiting thread to the next new thread. The counters stay
+ * in the slot. Whatever the thread frees later on, e.g. in other destructors,
+ * is recorded in the shared slot.
+ */
+static void prv_alloc_stats_release(void *v_slot) {
+    prv_slot_t *const slot = v_slot;
+    g_alloc_stats_slot = &g_alloc_stats_slots[YTALLOC_STATS_MAX_THREADS];
+    __atomic_store_n(&slot->claimed, false, __ATOMIC_RELEASE);
+}
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ytalloc/ytalloc.h>
+
+#include "config.h"
+
+/*
+ * Hooks for the heap engines into the statistics of #alloc_stats_get(). They
+ * compile to nothing, arguments included, unless ytalloc is built with
+ * YTALLOC_STATS.
+ *
+ * ALLOC_STATS_START() declares the start time of an operation. It is 0 for the
+ * operations that are not sampled for the latency histograms. The byte counts
+ * passed to the others are per item.
+ */
+
+#ifdef YTALLOC_STATS
+#define ALLOC_STATS_START(T0) const uint64_t T0 = alloc_stats_start()
+#define ALLOC_STATS_ALLOC(KIND, T0, PTR, REQUESTED, GRANTED)                   \
+    alloc_stats_note(KIND, ALLOC_STATS_OP_ALLOC, T0, (PTR) != NULL,            \
+                     (PTR) == NULL, REQUESTED, GRANTED)
+#define ALLOC_STATS_BULK(KIND, T0, NUM_WANTED, NUM, REQUESTED, GRANTED)        \
+    alloc_stats_note(KIND, ALLOC_STATS_OP_ALLOC, T0, NUM,                      \
+                     (NUM_WANTED) - (NUM), REQUESTED, GRANTED)
+#define ALLOC_STATS_FREE(KIND, T0, NUM, SIZE)                                  \
+    alloc_stats_note(KIND, ALLOC_STATS_OP_FREE, T0, NUM, 0, 0, SIZE)
+
+extern _Thread_local uint32_t g_alloc_stats_countdown
+    __attribute__((tls_model("initial-exec"), visibility("hidden")));
+
+uint64_t alloc_stats_sample(void);
+void alloc_stats_note(alloc_kind_t kind, alloc_stats_op_t op, uint64_t t0,
+                      size_t num, size_t num_failed, size_t requested,
+                      size_t granted);
+
+// Counts down in place, so that only the sampled operations make a call.
+static inline uint64_t alloc_stats_start(void) {
+    if (g_alloc_stats_countdown > 0) {
+        g_alloc_stats_countdown--;
+        return 0;
+    }
+    return alloc_stats_sample();
+}
+#else
+#define ALLOC_STATS_START(T0)
+#define ALLOC_STATS_ALLOC(KIND, T0, PTR, REQUESTED, GRANTED)
+#define ALLOC_STATS_BULK(KIND, T0, NUM_WANTED, NUM, REQUESTED, GRANTED)
+#define ALLOC_STATS_FREE(KIND, T0, NUM, SIZE)
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file bitmap.c
+ * Word-wide scans over bitmaps made of 64-bit words.
+ */
+
+#include "aux/bitmap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+size_t bitmap_find_zero(const uint64_t *words, size_t from_word,
+                        size_t to_word) {
+    size_t idx = from_word;
+
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi32(-1);
+    for (; idx + 4 <= to_word; idx += 4) {
+        const __m256i quad = _mm256_loadu_si256((const __m256i *)&words[idx]);
+        const __m256i full = _mm256_cmpeq_epi64(quad, ones);
+        if ((uint32_t)_mm256_movemask_epi8(full) != UINT32_MAX) { break; }
+    }
+#elif defined(__SSE2__)
+    const __m128i ones = _mm_set1_epi32(-1);
+    for (; idx + 2 <= to_word; idx += 2) {
+        const __m128i pair = _mm_loadu_si128((const __m128i *)&words[idx]);
+        const __m128i full = _mm_cmpeq_epi32(pair, ones);
+        if (_mm_movemask_epi8(full) != 0xFFFF) { break; }
+    }
+#endif
+
+    for (; idx < to_word; idx++) {
+        const uint64_t inverted = ~words[idx];
+        if (inverted != 0) {
+            return idx * 64 + (size_t)__builtin_ctzll(inverted);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+size_t bitmap_find_one(const uint64_t *words, size_t from_word,
+                       size_t to_word) {
+    size_t idx = from_word;
+
+#if defined(__AVX2__)
+    for (; idx + 4 <= to_word; idx += 4) {
+        const __m256i quad = _mm256_loadu_si256((const __m256i *)&words[idx]);
+        if (!_mm256_testz_si256(quad, quad)) { break; }
+    }
+#elif defined(__SSE2__)
+    const __m128i zeros = _mm_setzero_si128();
+    for (; idx + 2 <= to_word; idx += 2) {
+        const __m128i pair = _mm_loadu_si128((const __m128i *)&words[idx]);
+        const __m128i empty = _mm_cmpeq_epi32(pair, zeros);
+        if (_mm_movemask_epi8(empty) != 0xFFFF) { break; }
+    }
+#endif
+
+    for (; idx < to_word; idx++) {
+        if (words[idx] != 0) {
+            return idx * 64 + (size_t)__builtin_ctzll(words[idx]);
+        }
+    }
+
+    return SIZE_MAX;
+}
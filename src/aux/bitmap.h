@@ -0,0 +1,38 @@
+/**
+ * @file bitmap.h
+ * Word-wide scans over bitmaps made of 64-bit words.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Returns the index of the first zero bit in the words
+ * `[from_word, to_word)` of @a words, or `SIZE_MAX` if all of them are ones.
+ *
+ * The index is counted from the start of @a words, not from @a from_word. Runs
+ * of all-ones words are skipped several words at a time when SIMD is
+ * available.
+ *
+ * @param words     Bitmap words.
+ * @param from_word Index of the first word to scan.
+ * @param to_word   Index of the word after the last one to scan.
+ */
+size_t bitmap_find_zero(const uint64_t *words, size_t from_word,
+                        size_t to_word);
+
+/**
+ * Returns the index of the first one bit in the words `[from_word, to_word)`
+ * of @a words, or `SIZE_MAX` if all of them are zeros.
+ *
+ * This is the counterpart of #bitmap_find_zero(): runs of all-zeros words are
+ * skipped several words at a time when SIMD is available.
+ *
+ * @param words     Bitmap words.
+ * @param from_word Index of the first word to scan.
+ * @param to_word   Index of the word after the last one to scan.
+ */
+size_t bitmap_find_one(const uint64_t *words, size_t from_word,
+                       size_t to_word);
@@ -0,0 +1,26 @@
+/**
+ * @file remote.c
+ * Lock-free multiple-producer, single-consumer stacks of freed items.
+ */
+
+#include "aux/remote.h"
+
+static _Thread_local char g_remote_thread_marker;
+
+const void *remote_thread_id(void) {
+    return &g_remote_thread_marker;
+}
+
+void remote_push(uintptr_t *head, void *item, uintptr_t *link) {
+    uintptr_t old_head = __atomic_load_n(head, __ATOMIC_RELAXED);
+    do {
+        *link = old_head;
+    } while (!__atomic_compare_exchange_n(head, &old_head, (uintptr_t)item,
+                                          true, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+uintptr_t remote_take(uintptr_t *head) {
+    if (__atomic_load_n(head, __ATOMIC_RELAXED) == 0) { return 0; }
+    return __atomic_exchange_n(head, 0, __ATOMIC_ACQUIRE);
+}
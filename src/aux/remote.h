@@ -0,0 +1,33 @@
+/**
+ * @file remote.h
+ * Lock-free multiple-producer, single-consumer stacks of freed items.
+ *
+ * Any thread may push an item, only the owner of the stack takes them, and it
+ * always takes all of them at once. Taking everything with one exchange is what
+ * keeps the stack free of the ABA problem.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Returns a value that identifies the calling thread while it is alive.
+ */
+const void *remote_thread_id(void);
+
+/**
+ * Pushes @a item onto the stack at @a head.
+ *
+ * @param head Stack head, `0` if the stack is empty.
+ * @param item Item to push.
+ * @param link Word of @a item that receives the link to the next item.
+ */
+void remote_push(uintptr_t *head, void *item, uintptr_t *link);
+
+/**
+ * Takes all items off the stack at @a head.
+ *
+ * @returns The last pushed item, linked to the ones pushed before it, or `0`.
+ */
+uintptr_t remote_take(uintptr_t *head);
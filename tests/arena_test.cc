@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <ytalloc/ytalloc.h>
+
+#include "tests_common/DuplicatedWrite.h"
+
+namespace {
+
+/**
+ * Page source that allocates chunks on the C++ heap and tracks them.
+ */
+struct TrackingSource {
+    static void *get(void *ctx, size_t size) {
+        TrackingSource *const self = static_cast<TrackingSource *>(ctx);
+        if (self->fail) { return nullptr; }
+        void *const ptr = operator new[](size, std::align_val_t(4096));
+        self->chunks[ptr] = size;
+        return ptr;
+    }
+
+    static void put(void *ctx, void *ptr, size_t size) {
+        TrackingSource *const self = static_cast<TrackingSource *>(ctx);
+        auto it = self->chunks.find(ptr);
+        ASSERT_NE(it, self->chunks.end());
+        ASSERT_EQ(it->second, size);
+        self->chunks.erase(it);
+        operator delete[](ptr, std::align_val_t(4096));
+    }
+
+    alloc_page_source_t source() {
+        return alloc_page_source_t{.get = get, .put = put, .ctx = this};
+    }
+
+    std::map<void *, size_t> chunks;
+    bool fail = false;
+};
+
+} // namespace
+
+class ArenaTest : public testing::Test {
+  protected:
+    void TearDown() override {
+        alloc_arena_destroy(&arena);
+        EXPECT_TRUE(tracker.chunks.empty());
+        for (DuplicatedWrite &write : writes) {
+            write.delete_copy();
+        }
+    }
+
+    void init_with_chunk_size(size_t chunk_size) {
+        const alloc_page_source_t src = tracker.source();
+        alloc_arena_init(&arena, &src, chunk_size);
+    }
+
+    void random_write(void *ptr, size_t num_bytes) {
+        auto write = DuplicatedWrite::random_write(rng, ptr, num_bytes);
+        writes.push_back(write);
+    }
+
+    void check_writes() {
+        size_t idx = 0;
+        for (const DuplicatedWrite &write : writes) {
+            EXPECT_TRUE(write.check_integrity())
+                << "write #" << idx << " (" << write.num_bytes
+                << " bytes) has been overwritten";
+        }
+    }
+
+    TrackingSource tracker;
+    alloc_arena_t arena = {};
+
+    std::minstd_rand rng;
+    std::vector<DuplicatedWrite> writes;
+};
+
+TEST_F(ArenaTest, InitWithTinyChunkAborts) {
+    const alloc_page_source_t src = tracker.source();
+    ASSERT_DEATH(alloc_arena_init(&arena, &src, 8), "");
+}
+
+TEST_F(ArenaTest, NoChunkBeforeFirstAlloc) {
+    init_with_chunk_size(4096);
+    EXPECT_EQ(alloc_arena_num_chunks(&arena), 0);
+    EXPECT_TRUE(tracker.chunks.empty());
+}
+
+TEST_F(ArenaTest, GrowsWhenExhausted) {
+    init_with_chunk_size(4096);
+
+    for (size_t idx = 0; idx < 64; idx++) {
+        void *const ptr = alloc_arena(&arena, 256);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % YTALLOC_STATIC_ALIGN, 0);
+        random_write(ptr, 256);
+    }
+    EXPECT_GT(alloc_arena_num_chunks(&arena), 4);
+    EXPECT_EQ(alloc_arena_num_chunks(&arena), tracker.chunks.size());
+    check_writes();
+}
+
+TEST_F(ArenaTest, OutlierGetsItsOwnChunk) {
+    init_with_chunk_size(4096);
+
+    ASSERT_NE(alloc_arena(&arena, 16), nullptr);
+    void *const big = alloc_arena_aligned(&arena, 100000, 4096);
+    ASSERT_NE(big, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(big) % 4096, 0);
+    random_write(big, 100000);
+    EXPECT_EQ(alloc_arena_num_chunks(&arena), 2);
+    check_writes();
+}
+
+TEST_F(ArenaTest, ResetKeepsOneWarmChunk) {
+    init_with_chunk_size(4096);
+
+    void *const first = alloc_arena(&arena, 1024);
+    for (size_t idx = 0; idx < 16; idx++) {
+        ASSERT_NE(alloc_arena(&arena, 1024), nullptr);
+    }
+    ASSERT_NE(alloc_arena(&arena, 1 << 20), nullptr);
+    ASSERT_GT(tracker.chunks.size(), 1);
+
+    alloc_arena_reset(&arena);
+    EXPECT_EQ(alloc_arena_num_chunks(&arena), 1);
+    EXPECT_EQ(tracker.chunks.size(), 1);
+
+    EXPECT_EQ(alloc_arena(&arena, 1024), first);
+    EXPECT_EQ(tracker.chunks.size(), 1);
+}
+
+TEST_F(ArenaTest, RewindReleasesNewerChunks) {
+    init_with_chunk_size(4096);
+
+    ASSERT_NE(alloc_arena(&arena, 1024), nullptr);
+    const alloc_arena_mark_t mark = alloc_arena_mark(&arena);
+    void *const after_mark = alloc_arena(&arena, 1024);
+
+    for (size_t idx = 0; idx < 16; idx++) {
+        ASSERT_NE(alloc_arena(&arena, 1024), nullptr);
+    }
+    ASSERT_GT(tracker.chunks.size(), 1);
+
+    alloc_arena_rewind(&arena, mark);
+    EXPECT_EQ(tracker.chunks.size(), 1);
+    EXPECT_EQ(alloc_arena(&arena, 1024), after_mark);
+}
+
+TEST_F(ArenaTest, RewindToEmptyMark) {
+    init_with_chunk_size(4096);
+
+    const alloc_arena_mark_t mark = alloc_arena_mark(&arena);
+    for (size_t idx = 0; idx < 16; idx++) {
+        ASSERT_NE(alloc_arena(&arena, 1024), nullptr);
+    }
+    alloc_arena_rewind(&arena, mark);
+    EXPECT_EQ(tracker.chunks.size(), 1);
+}
+
+TEST_F(ArenaTest, SourceFailure) {
+    init_with_chunk_size(4096);
+    tracker.fail = true;
+    EXPECT_EQ(alloc_arena(&arena, 16), nullptr);
+    EXPECT_EQ(alloc_arena(&arena, SIZE_MAX), nullptr);
+}
+
+TEST_F(ArenaTest, BuddySource) {
+    constexpr size_t heap_size = 16 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    uint8_t *const storage =
+        new (std::align_val_t(heap_size)) uint8_t[heap_size];
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[16 / 8];
+
+    alloc_buddy_t buddy;
+    alloc_buddy_init(&buddy, storage, heap_size, free_heads,
+                     sizeof(free_heads), bitmap, sizeof(bitmap));
+
+    alloc_page_source_t src;
+    alloc_page_source_buddy(&src, &buddy);
+    alloc_arena_t buddy_arena;
+    alloc_arena_init(&buddy_arena, &src, YTALLOC_BUDDY_MIN_BLOCK_SIZE);
+
+    for (size_t idx = 0; idx < 8; idx++) {
+        ASSERT_NE(alloc_arena(&buddy_arena, 2048), nullptr);
+    }
+    EXPECT_EQ(alloc_buddy_count_free(&buddy, 4), 0);
+
+    alloc_arena_destroy(&buddy_arena);
+    EXPECT_EQ(alloc_buddy_count_free(&buddy, 4), 1);
+
+    operator delete[](storage, std::align_val_t(heap_size));
+}
+
+TEST_F(ArenaTest, MmapSource) {
+    alloc_page_source_t src;
+    alloc_page_source_mmap(&src);
+    alloc_arena_t mmap_arena;
+    alloc_arena_init(&mmap_arena, &src, 1 << 16);
+
+    void *const ptr = alloc_arena(&mmap_arena, 1 << 20);
+    ASSERT_NE(ptr, nullptr);
+    random_write(ptr, 1 << 20);
+    check_writes();
+
+    alloc_arena_destroy(&mmap_arena);
+    EXPECT_EQ(alloc_arena_num_chunks(&mmap_arena), 0);
+}
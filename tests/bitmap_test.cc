@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <ytalloc/ytalloc.h>
+
+#include "tests_common/DuplicatedWrite.h"
+
+class BitmapTest : public testing::Test {
+  protected:
+    void SetUp() {
+        storage = nullptr;
+    }
+
+    void TearDown() {
+        if (storage) {
+            operator delete[](storage, std::align_val_t(unit_size));
+        }
+        for (DuplicatedWrite &write : writes) {
+            write.delete_copy();
+        }
+    }
+
+    void set_underlying_storage(size_t num_units) {
+        size = num_units * unit_size;
+        storage = new (std::align_val_t(unit_size)) uint8_t[size];
+        meta.resize(alloc_bitmap_meta_size(num_units) / sizeof(uint64_t));
+    }
+
+    void init_with_units(size_t num_units) {
+        set_underlying_storage(num_units);
+        alloc_bitmap_init(&heap, storage, size, unit_size, meta.data(),
+                          meta.size() * sizeof(uint64_t));
+    }
+
+    void random_write(void *ptr, size_t num_bytes) {
+        auto write = DuplicatedWrite::random_write(rng, ptr, num_bytes);
+        writes.push_back(write);
+    }
+
+    void check_writes() {
+        size_t idx = 0;
+        for (const DuplicatedWrite &write : writes) {
+            EXPECT_TRUE(write.check_integrity())
+                << "write #" << idx << " (" << write.num_bytes
+                << " bytes) has been overwritten";
+            idx++;
+        }
+    }
+
+    size_t unit_index(const void *ptr) const {
+        return ((const uint8_t *)ptr - storage) / unit_size;
+    }
+
+    static constexpr size_t unit_size = 64;
+
+    std::minstd_rand rng;
+
+    alloc_bitmap_t heap;
+    uint8_t *storage;
+    size_t size;
+    std::vector<uint64_t> meta;
+
+    std::vector<DuplicatedWrite> writes;
+};
+
+TEST_F(BitmapTest, InitNullHeapAborts) {
+    set_underlying_storage(64);
+    ASSERT_DEATH(alloc_bitmap_init(NULL, storage, size, unit_size,
+                                   meta.data(), meta.size() * 8),
+                 "");
+}
+
+TEST_F(BitmapTest, InitNonPowerOfTwoUnitAborts) {
+    set_underlying_storage(64);
+    ASSERT_DEATH(alloc_bitmap_init(&heap, storage, size, 48, meta.data(),
+                                   meta.size() * 8),
+                 "");
+}
+
+TEST_F(BitmapTest, InitSmallMetaAborts) {
+    set_underlying_storage(128);
+    ASSERT_DEATH(alloc_bitmap_init(&heap, storage, size, unit_size,
+                                   meta.data(), 8),
+                 "");
+}
+
+TEST_F(BitmapTest, AllocZeroSize) {
+    init_with_units(64);
+    EXPECT_EQ(alloc_bitmap(&heap, 0), nullptr);
+}
+
+TEST_F(BitmapTest, AllocRoundsUpToUnits) {
+    init_with_units(64);
+
+    void *const ptr1 = alloc_bitmap(&heap, 1);
+    void *const ptr2 = alloc_bitmap(&heap, 5 * unit_size + 1);
+    void *const ptr3 = alloc_bitmap(&heap, unit_size);
+    ASSERT_EQ(ptr1, storage);
+    ASSERT_EQ(ptr2, storage + unit_size);
+    ASSERT_EQ(ptr3, storage + 7 * unit_size);
+    EXPECT_EQ(alloc_bitmap_num_used(&heap), 8);
+    EXPECT_TRUE(alloc_bitmap_is_used(&heap, storage + 6 * unit_size));
+    EXPECT_FALSE(alloc_bitmap_is_used(&heap, storage + 8 * unit_size));
+}
+
+TEST_F(BitmapTest, AllocWholeHeapNotMultipleOf64) {
+    constexpr size_t num_units = 200;
+    init_with_units(num_units);
+
+    void *const ptr = alloc_bitmap(&heap, num_units * unit_size);
+    ASSERT_EQ(ptr, storage);
+    random_write(ptr, num_units * unit_size);
+    EXPECT_EQ(alloc_bitmap(&heap, 1), nullptr);
+    EXPECT_EQ(alloc_bitmap_num_free(&heap), 0);
+
+    alloc_bitmap_free(&heap, ptr, num_units * unit_size);
+    EXPECT_EQ(alloc_bitmap_num_free(&heap), num_units);
+    EXPECT_EQ(alloc_bitmap(&heap, (num_units + 1) * unit_size), nullptr);
+    check_writes();
+}
+
+TEST_F(BitmapTest, RunSpansWords) {
+    init_with_units(256);
+
+    void *const head = alloc_bitmap(&heap, 60 * unit_size);
+    void *const span = alloc_bitmap(&heap, 130 * unit_size);
+    ASSERT_EQ(span, storage + 60 * unit_size);
+    random_write(head, 60 * unit_size);
+    random_write(span, 130 * unit_size);
+    check_writes();
+}
+
+TEST_F(BitmapTest, FindsRunInsideWord) {
+    init_with_units(64);
+
+    void *ptrs[8];
+    for (void *&ptr : ptrs) {
+        ptr = alloc_bitmap(&heap, 8 * unit_size);
+        ASSERT_NE(ptr, nullptr);
+    }
+    alloc_bitmap_free(&heap, ptrs[2], 8 * unit_size);
+    alloc_bitmap_free(&heap, ptrs[5], 8 * unit_size);
+
+    EXPECT_EQ(alloc_bitmap(&heap, 9 * unit_size), nullptr);
+    void *const ptr = alloc_bitmap(&heap, 5 * unit_size);
+    EXPECT_EQ(ptr, ptrs[2]);
+}
+
+TEST_F(BitmapTest, NextFit) {
+    init_with_units(256);
+
+    void *const ptr1 = alloc_bitmap(&heap, unit_size);
+    void *const ptr2 = alloc_bitmap(&heap, unit_size);
+    alloc_bitmap_free(&heap, ptr1, unit_size);
+
+    // The freed unit is behind the hint, so it is not reused right away.
+    void *const ptr3 = alloc_bitmap(&heap, unit_size);
+    EXPECT_EQ(unit_index(ptr3), unit_index(ptr2) + 1);
+
+    // Once the end is reached the search wraps around.
+    void *const rest = alloc_bitmap(&heap, 253 * unit_size);
+    ASSERT_NE(rest, nullptr);
+    EXPECT_EQ(alloc_bitmap(&heap, unit_size), ptr1);
+}
+
+TEST_F(BitmapTest, DoubleFreeAborts) {
+    init_with_units(128);
+
+    void *const ptr = alloc_bitmap(&heap, 3 * unit_size);
+    alloc_bitmap_free(&heap, ptr, 3 * unit_size);
+    ASSERT_DEATH(alloc_bitmap_free(&heap, ptr, 3 * unit_size), "");
+}
+
+TEST_F(BitmapTest, FreeOutsideAborts) {
+    init_with_units(128);
+    void *const ptr = alloc_bitmap(&heap, unit_size);
+    ASSERT_DEATH(alloc_bitmap_free(&heap, ptr, 129 * unit_size), "");
+    ASSERT_DEATH(alloc_bitmap_free(&heap, storage + size, unit_size), "");
+}
+
+TEST_F(BitmapTest, Fragmentation) {
+    init_with_units(256);
+
+    alloc_bitmap_frag_t frag;
+    alloc_bitmap_frag(&heap, &frag);
+    EXPECT_EQ(frag.num_free, 256);
+    EXPECT_EQ(frag.num_free_runs, 1);
+    EXPECT_EQ(frag.largest_free_run, 256);
+
+    void *ptrs[4];
+    for (void *&ptr : ptrs) {
+        ptr = alloc_bitmap(&heap, 40 * unit_size);
+    }
+    alloc_bitmap_free(&heap, ptrs[1], 40 * unit_size);
+    alloc_bitmap_free(&heap, ptrs[2], 40 * unit_size);
+    alloc_bitmap_free(&heap, ptrs[0], 40 * unit_size);
+    void *const hole = alloc_bitmap(&heap, 3 * unit_size);
+    ASSERT_EQ(unit_index(hole), 160);
+
+    // Free: [0, 120) and [163, 256).
+    alloc_bitmap_frag(&heap, &frag);
+    EXPECT_EQ(frag.num_free, 120 + 93);
+    EXPECT_EQ(frag.num_free_runs, 2);
+    EXPECT_EQ(frag.largest_free_run, 120);
+    EXPECT_NE(alloc_bitmap(&heap, 120 * unit_size), nullptr);
+}
+
+TEST_F(BitmapTest, RandomAgainstModel) {
+    constexpr size_t num_units = 1000;
+    constexpr size_t num_rounds = 20000;
+    init_with_units(num_units);
+
+    std::vector<bool> model(num_units, false);
+    std::vector<std::pair<size_t, size_t>> live;
+    std::uniform_int_distribution<size_t> len_dist(1, 150);
+    std::uniform_int_distribution<int> op_dist(0, 2);
+
+    auto model_has_run = [&](size_t n) {
+        size_t run = 0;
+        for (size_t idx = 0; idx < num_units; idx++) {
+            run = model[idx] ? 0 : run + 1;
+            if (run >= n) { return true; }
+        }
+        return false;
+    };
+
+    for (size_t round = 0; round < num_rounds; round++) {
+        if (op_dist(rng) != 0 || live.empty()) {
+            const size_t n = len_dist(rng);
+            void *const ptr = alloc_bitmap(&heap, n * unit_size);
+            if (!ptr) {
+                ASSERT_FALSE(model_has_run(n)) << "round " << round;
+                continue;
+            }
+            const size_t first = unit_index(ptr);
+            ASSERT_LE(first + n, num_units);
+            for (size_t idx = first; idx < first + n; idx++) {
+                ASSERT_FALSE(model[idx]) << "unit " << idx << " is taken";
+                model[idx] = true;
+            }
+            live.emplace_back(first, n);
+        } else {
+            std::uniform_int_distribution<size_t> pick(0, live.size() - 1);
+            const size_t pos = pick(rng);
+            auto [first, n] = live[pos];
+            live[pos] = live.back();
+            live.pop_back();
+            alloc_bitmap_free(&heap, storage + first * unit_size,
+                              n * unit_size);
+            for (size_t idx = first; idx < first + n; idx++) {
+                model[idx] = false;
+            }
+        }
+    }
+
+    size_t num_free = 0;
+    for (bool used : model) {
+        num_free += !used;
+    }
+    EXPECT_EQ(alloc_bitmap_num_free(&heap), num_free);
+}
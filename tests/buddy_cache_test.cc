@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class BuddyCacheTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        storage = new (std::align_val_t(heap_size)) uint8_t[heap_size];
+        alloc_buddy_init(&heap, storage, heap_size, free_heads,
+                         sizeof(free_heads), bitmap, sizeof(bitmap));
+        alloc_lock_spin(&lock, &spin);
+        alloc_buddy_set_lock(&heap, &lock);
+        page = alloc_buddy_order0_size(&heap);
+    }
+
+    void TearDown() override {
+        operator delete[](storage, std::align_val_t(heap_size));
+    }
+
+    size_t count_free_pages() const {
+        size_t num_pages = 0;
+        for (uint8_t order = 0; order < YTALLOC_BUDDY_MAX_ORDERS; order++) {
+            num_pages += alloc_buddy_count_free(&heap, order) << order;
+        }
+        return num_pages;
+    }
+
+    static constexpr size_t heap_size = 1024 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+
+    uint8_t *storage;
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[heap_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+    alloc_buddy_t heap;
+    alloc_spinlock_t spin;
+    alloc_lock_t lock;
+    size_t page;
+
+    alloc_buddy_cache_t cache;
+};
+
+TEST_F(BuddyCacheTest, InitBadWatermarksAborts) {
+    ASSERT_DEATH(alloc_buddy_cache_init(&cache, &heap, 0, 8), "");
+    ASSERT_DEATH(alloc_buddy_cache_init(&cache, &heap, 8, 8), "");
+    ASSERT_DEATH(alloc_buddy_cache_init(&cache, &heap, 8,
+                                        YTALLOC_BUDDY_CACHE_MAX + 1),
+                 "");
+}
+
+TEST_F(BuddyCacheTest, AllocRefillsToLow) {
+    alloc_buddy_cache_init(&cache, &heap, 8, 32);
+    const size_t num_free = count_free_pages();
+
+    void *const ptr = alloc_buddy_cache(&cache, 1);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 7);
+    EXPECT_EQ(count_free_pages(), num_free - 8);
+
+    for (size_t idx = 0; idx < 7; idx++) {
+        EXPECT_NE(alloc_buddy_cache(&cache, page), nullptr);
+    }
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 0);
+    EXPECT_EQ(count_free_pages(), num_free - 8);
+}
+
+TEST_F(BuddyCacheTest, FreeDrainsToLow) {
+    alloc_buddy_cache_init(&cache, &heap, 4, 16);
+
+    void *ptrs[17];
+    ASSERT_EQ(alloc_buddy_bulk(&heap, page, ptrs, 17), 17);
+    for (size_t idx = 0; idx < 16; idx++) {
+        alloc_buddy_cache_free(&cache, ptrs[idx], page);
+    }
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 16);
+
+    alloc_buddy_cache_free(&cache, ptrs[16], page);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 5);
+
+    // The most recently freed blocks are handed out first.
+    EXPECT_EQ(alloc_buddy_cache(&cache, page), ptrs[16]);
+    EXPECT_EQ(alloc_buddy_cache(&cache, page), ptrs[15]);
+}
+
+TEST_F(BuddyCacheTest, OrdersAreCachedSeparately) {
+    alloc_buddy_cache_init(&cache, &heap, 2, 4);
+
+    void *const small = alloc_buddy_cache(&cache, page);
+    void *const big = alloc_buddy_cache(&cache, page + 1);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(big, nullptr);
+    EXPECT_EQ((uintptr_t)big % (2 * page), 0);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 1);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 1), 1);
+
+    alloc_buddy_cache_free(&cache, big, 2 * page);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 1), 2);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 1);
+}
+
+TEST_F(BuddyCacheTest, LargeSizesBypassCache) {
+    alloc_buddy_cache_init(&cache, &heap, 2, 4);
+    const size_t size = page << YTALLOC_BUDDY_CACHE_ORDERS;
+
+    void *const ptr = alloc_buddy_cache(&cache, size);
+    ASSERT_NE(ptr, nullptr);
+    for (size_t order = 0; order <= YTALLOC_BUDDY_CACHE_ORDERS; order++) {
+        EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, order), 0);
+    }
+    alloc_buddy_cache_free(&cache, ptr, size);
+    EXPECT_EQ(count_free_pages(), heap_size / page);
+}
+
+TEST_F(BuddyCacheTest, FlushGivesBlocksBack) {
+    alloc_buddy_cache_init(&cache, &heap, 8, 16);
+
+    void *const ptr1 = alloc_buddy_cache(&cache, page);
+    void *const ptr2 = alloc_buddy_cache(&cache, 2 * page);
+    alloc_buddy_cache_free(&cache, ptr1, page);
+    alloc_buddy_cache_free(&cache, ptr2, 2 * page);
+    EXPECT_LT(count_free_pages(), heap_size / page);
+
+    alloc_buddy_cache_flush(&cache);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 0), 0);
+    EXPECT_EQ(alloc_buddy_cache_num_cached(&cache, 1), 0);
+    EXPECT_NE(alloc_buddy(&heap, heap_size), nullptr);
+}
+
+TEST_F(BuddyCacheTest, EmptyHeap) {
+    alloc_buddy_cache_init(&cache, &heap, 8, 16);
+    void *const all = alloc_buddy(&heap, heap_size);
+    ASSERT_NE(all, nullptr);
+
+    EXPECT_EQ(alloc_buddy_cache(&cache, page), nullptr);
+    alloc_buddy_free(&heap, all, heap_size);
+    EXPECT_NE(alloc_buddy_cache(&cache, page), nullptr);
+}
+
+TEST_F(BuddyCacheTest, ThreadsShareHeap) {
+    constexpr size_t num_threads = 4;
+    constexpr size_t num_rounds = 20000;
+
+    std::vector<std::thread> threads;
+    std::vector<alloc_buddy_cache_t> caches(num_threads);
+    std::atomic<size_t> num_corrupt = 0;
+    for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+        threads.emplace_back([&, thread_idx] {
+            alloc_buddy_cache_t *const cache = &caches[thread_idx];
+            alloc_buddy_cache_init(cache, &heap, 8, 32);
+
+            std::minstd_rand rng(thread_idx);
+            std::vector<std::pair<size_t *, size_t>> live;
+            for (size_t round = 0; round < num_rounds; round++) {
+                if (live.size() < 48 && rng() % 2 == 0) {
+                    const size_t size = page << (rng() % 3);
+                    size_t *const ptr =
+                        (size_t *)alloc_buddy_cache(cache, size);
+                    if (!ptr) { continue; }
+                    ptr[0] = thread_idx;
+                    ptr[size / sizeof(size_t) - 1] = round;
+                    live.emplace_back(ptr, size);
+                } else if (!live.empty()) {
+                    auto [ptr, size] = live.back();
+                    live.pop_back();
+                    if (ptr[0] != thread_idx) { num_corrupt++; }
+                    alloc_buddy_cache_free(cache, ptr, size);
+                }
+            }
+            for (auto [ptr, size] : live) {
+                alloc_buddy_cache_free(cache, ptr, size);
+            }
+            alloc_buddy_cache_flush(cache);
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(num_corrupt, 0);
+    EXPECT_EQ(count_free_pages(), heap_size / page);
+    EXPECT_NE(alloc_buddy(&heap, heap_size), nullptr);
+}
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <gtest/gtest.h>
 #include <random>
 #include <ytalloc/ytalloc.h>
@@ -465,3 +466,180 @@ TEST_F(BuddyTest, CountFree_ThreeOrders) {
     ASSERT_EQ(order1_cnt, 0);
     ASSERT_EQ(order2_cnt, 0);
 }
+
+TEST_F(BuddyTest, FreeDoesNotMergeWithSplitBuddy) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(4 * page, 4 * page);
+
+    // [0, 1) and [1, 2) are order 0, [2, 4) is order 1.
+    void *const ptr0 = alloc_buddy(&alloc, page);
+    void *const ptr1 = alloc_buddy(&alloc, page);
+    void *const ptr2 = alloc_buddy(&alloc, 2 * page);
+    ASSERT_EQ(ptr1, storage + page);
+    ASSERT_EQ(ptr2, storage + 2 * page);
+
+    // The start of the order 1 buddy of [2, 4) is free, but its second half
+    // is not, so the two must not merge.
+    alloc_buddy_free(&alloc, ptr0, page);
+    alloc_buddy_free(&alloc, ptr2, 2 * page);
+    EXPECT_EQ(alloc_buddy_count_free(&alloc, 0), 1);
+    EXPECT_EQ(alloc_buddy_count_free(&alloc, 1), 1);
+    EXPECT_EQ(alloc_buddy_count_free(&alloc, 2), 0);
+
+    alloc_buddy_free(&alloc, ptr1, page);
+    EXPECT_EQ(alloc_buddy_count_free(&alloc, 2), 1);
+}
+
+TEST_F(BuddyTest, RandomMixedOrders) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    constexpr size_t num_pages = 256;
+    init_with_size(num_pages * page, num_pages * page);
+
+    std::vector<std::pair<void *, size_t>> live;
+    for (size_t round = 0; round < 20000; round++) {
+        if (live.size() < 64 && rng() % 2 == 0) {
+            const size_t size = page << (rng() % 3);
+            void *const ptr = alloc_buddy(&alloc, size);
+            if (!ptr) { continue; }
+            *(size_t *)ptr = round;
+            live.emplace_back(ptr, size);
+        } else if (!live.empty()) {
+            const size_t pos = rng() % live.size();
+            auto [ptr, size] = live[pos];
+            live[pos] = live.back();
+            live.pop_back();
+            alloc_buddy_free(&alloc, ptr, size);
+        }
+    }
+    for (auto [ptr, size] : live) {
+        alloc_buddy_free(&alloc, ptr, size);
+    }
+
+    EXPECT_NE(alloc_buddy(&alloc, num_pages * page), nullptr);
+}
+
+TEST_F(BuddyTest, AtLeastReturnsBlockSize) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(8 * page, 8 * page);
+
+    size_t usable = 0;
+    void *const ptr = alloc_buddy_at_least(&alloc, page + 1, &usable);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(usable, 2 * page);
+    random_write(ptr, usable);
+    check_writes();
+
+    alloc_buddy_free(&alloc, ptr, usable);
+    EXPECT_EQ(alloc_buddy_count_free(&alloc, 3), 1);
+}
+
+TEST_F(BuddyTest, UsableSizeFromOrderMap) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(8 * page, 8 * page);
+    uint8_t map[8];
+    alloc_buddy_set_order_map(&alloc, map, sizeof(map));
+
+    void *const a = alloc_buddy(&alloc, 1);
+    void *const b = alloc_buddy(&alloc, 3 * page);
+    void *const c = alloc_buddy_aligned(&alloc, page, 2 * page);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(alloc_buddy_usable_size(&alloc, a), page);
+    EXPECT_EQ(alloc_buddy_usable_size(&alloc, b), 4 * page);
+    EXPECT_EQ(alloc_buddy_usable_size(&alloc, c), page);
+
+    alloc_buddy_free(&alloc, a, alloc_buddy_usable_size(&alloc, a));
+    alloc_buddy_free(&alloc, b, alloc_buddy_usable_size(&alloc, b));
+    alloc_buddy_free(&alloc, c, alloc_buddy_usable_size(&alloc, c));
+    EXPECT_EQ(alloc_buddy_count_free(&alloc, 3), 1);
+}
+
+TEST_F(BuddyTest, UsableSizeWithoutOrderMapAborts) {
+    init_with_size(YTALLOC_BUDDY_MIN_BLOCK_SIZE, YTALLOC_BUDDY_MIN_BLOCK_SIZE);
+    void *const ptr = alloc_buddy(&alloc, 1);
+    ASSERT_DEATH(alloc_buddy_usable_size(&alloc, ptr), "");
+}
+
+TEST_F(BuddyTest, CallocClearsReusedBlocks) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(4 * page, 4 * page);
+
+    uint8_t *const ptr1 = static_cast<uint8_t *>(alloc_buddy(&alloc, page));
+    std::memset(ptr1, 0xaa, page);
+    alloc_buddy_free(&alloc, ptr1, page);
+
+    uint8_t *const ptr2 =
+        static_cast<uint8_t *>(alloc_buddy_calloc(&alloc, 2, page));
+    ASSERT_EQ(ptr2, ptr1);
+    for (size_t idx = 0; idx < 2 * page; idx++) {
+        ASSERT_EQ(ptr2[idx], 0) << idx;
+    }
+    EXPECT_EQ(alloc_buddy_calloc(&alloc, SIZE_MAX / 2, 3), nullptr);
+}
+
+TEST_F(BuddyTest, CallocSkipsKnownZeroBlocks) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(8 * page, 8 * page);
+    std::memset(storage, 0, size);
+    alloc_buddy_init(&alloc, storage, size, free_heads, free_heads_size,
+                     bitmap, bitmap_size);
+    uint8_t map[1];
+    alloc_buddy_set_zeroed(&alloc, map, sizeof(map));
+
+    uint8_t *const a = static_cast<uint8_t *>(alloc_buddy(&alloc, page));
+    std::memset(a, 0xaa, page);
+    alloc_buddy_free(&alloc, a, page);
+
+    // Break the promise in every page but the one holding the free list tag
+    // to see which ones get cleared. Only the freed page and the pages that
+    // held a tag are.
+    std::memset(storage + page, 0xcc, size - page);
+    uint8_t *const b =
+        static_cast<uint8_t *>(alloc_buddy_calloc(&alloc, 8, page));
+    ASSERT_EQ(b, storage);
+    for (size_t idx = 0; idx < 8; idx++) {
+        const bool had_tag = idx == 0 || idx == 1 || idx == 2 || idx == 4;
+        EXPECT_EQ(b[idx * page + page - 1], had_tag ? 0 : 0xcc) << idx;
+    }
+}
+
+TEST_F(BuddyTest, CallocAfterOpsResetClearsWrittenBlocks) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(8 * page, 8 * page);
+    uint8_t zero_map[1];
+    uint8_t order_map[8];
+
+    // Without an order map the sizes of the allocated blocks are unknown.
+    for (bool with_order_map : {false, true}) {
+        SCOPED_TRACE(with_order_map);
+        std::memset(storage, 0, size);
+        alloc_buddy_init(&alloc, storage, size, free_heads, free_heads_size,
+                         bitmap, bitmap_size);
+        alloc_buddy_set_zeroed(&alloc, zero_map, sizeof(zero_map));
+        if (with_order_map) {
+            alloc_buddy_set_order_map(&alloc, order_map, sizeof(order_map));
+        }
+
+        uint8_t *const a =
+            static_cast<uint8_t *>(alloc_buddy_calloc(&alloc, 4, page));
+        ASSERT_NE(a, nullptr);
+        std::memset(a, 0xab, 4 * page);
+        alloc_buddy_ops.reset(&alloc);
+
+        uint8_t *const b =
+            static_cast<uint8_t *>(alloc_buddy_calloc(&alloc, 4, page));
+        ASSERT_EQ(b, a);
+        for (size_t idx = 0; idx < 4 * page; idx++) {
+            ASSERT_EQ(b[idx], 0) << idx;
+        }
+    }
+}
+
+TEST_F(BuddyTest, SetZeroedAfterAllocAborts) {
+    constexpr size_t page = YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    init_with_size(2 * page, 2 * page);
+    uint8_t map[1];
+    ASSERT_NE(alloc_buddy(&alloc, page), nullptr);
+    ASSERT_DEATH(alloc_buddy_set_zeroed(&alloc, map, sizeof(map)), "");
+}
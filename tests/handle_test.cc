@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <set>
+#include <ytalloc/ytalloc.h>
+
+#include "tests_common/DuplicatedWrite.h"
+
+class HandlePoolTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        storage = nullptr;
+        meta = nullptr;
+    }
+
+    void TearDown() override {
+        if (storage) {
+            operator delete[](storage, std::align_val_t(alignment));
+        }
+        if (meta) { delete[] meta; }
+        for (DuplicatedWrite &write : writes) {
+            write.delete_copy();
+        }
+    }
+
+    void set_underlying_storage(size_t num_items, size_t alloc_size) {
+        size = num_items * alloc_size;
+        alignment = alloc_size;
+        storage = new (std::align_val_t(alignment)) uint8_t[size];
+
+        meta_size = alloc_handle_pool_meta_size(num_items);
+        meta = new uint32_t[meta_size / sizeof(uint32_t)];
+    }
+
+    void init_with_items(size_t num_items, size_t alloc_size) {
+        set_underlying_storage(num_items, alloc_size);
+        alloc_handle_pool_init(&pool, storage, size, alloc_size, meta,
+                               meta_size);
+    }
+
+    void random_write(void *ptr, size_t num_bytes) {
+        auto write = DuplicatedWrite::random_write(rng, ptr, num_bytes);
+        writes.push_back(write);
+    }
+
+    void check_writes() {
+        size_t idx = 0;
+        for (const DuplicatedWrite &write : writes) {
+            EXPECT_TRUE(write.check_integrity())
+                << "write #" << idx << " (" << write.num_bytes
+                << " bytes) has been overwritten";
+        }
+    }
+
+    alloc_handle_pool_t pool;
+    uint8_t *storage;
+    size_t size;
+    size_t alignment;
+
+    uint32_t *meta;
+    size_t meta_size;
+
+    std::minstd_rand rng;
+    std::vector<DuplicatedWrite> writes;
+};
+
+TEST_F(HandlePoolTest, InitWithSmallMetaAborts) {
+    set_underlying_storage(8, 16);
+    ASSERT_DEATH(alloc_handle_pool_init(&pool, storage, size, 16, meta,
+                                        meta_size - 1),
+                 "");
+}
+
+TEST_F(HandlePoolTest, InitWithNullMetaAborts) {
+    set_underlying_storage(8, 16);
+    ASSERT_DEATH(
+        alloc_handle_pool_init(&pool, storage, size, 16, NULL, meta_size), "");
+}
+
+TEST_F(HandlePoolTest, AllocResolves) {
+    init_with_items(8, 16);
+
+    void *ptr = nullptr;
+    const alloc_handle_t handle = alloc_handle(&pool, &ptr);
+    ASSERT_NE(handle, ALLOC_HANDLE_NULL);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(alloc_handle_get(&pool, handle), ptr);
+    EXPECT_EQ(alloc_handle_num_live(&pool), 1);
+
+    random_write(ptr, 16);
+    check_writes();
+}
+
+TEST_F(HandlePoolTest, AllocUntilFull) {
+    constexpr size_t num_items = 8;
+    init_with_items(num_items, 16);
+
+    std::set<alloc_handle_t> handles;
+    for (size_t idx = 0; idx < num_items; idx++) {
+        const alloc_handle_t handle = alloc_handle(&pool, nullptr);
+        ASSERT_NE(handle, ALLOC_HANDLE_NULL);
+        ASSERT_TRUE(handles.insert(handle).second);
+    }
+
+    void *ptr = storage;
+    EXPECT_EQ(alloc_handle(&pool, &ptr), ALLOC_HANDLE_NULL);
+    EXPECT_EQ(ptr, nullptr);
+    EXPECT_EQ(alloc_handle_num_live(&pool), num_items);
+}
+
+TEST_F(HandlePoolTest, StaleHandleIsDetected) {
+    init_with_items(4, 16);
+
+    void *ptr1 = nullptr;
+    const alloc_handle_t handle1 = alloc_handle(&pool, &ptr1);
+    alloc_handle_free(&pool, handle1);
+    EXPECT_EQ(alloc_handle_get(&pool, handle1), nullptr);
+
+    // The slot is reused, but the old handle stays stale.
+    void *ptr2 = nullptr;
+    const alloc_handle_t handle2 = alloc_handle(&pool, &ptr2);
+    EXPECT_EQ(ptr2, ptr1);
+    EXPECT_NE(handle2, handle1);
+    EXPECT_EQ(alloc_handle_get(&pool, handle1), nullptr);
+    EXPECT_EQ(alloc_handle_get(&pool, handle2), ptr2);
+
+    ASSERT_DEATH(alloc_handle_free(&pool, handle1), "");
+}
+
+TEST_F(HandlePoolTest, InvalidHandles) {
+    init_with_items(4, 16);
+    alloc_handle(&pool, nullptr);
+
+    EXPECT_EQ(alloc_handle_get(&pool, ALLOC_HANDLE_NULL), nullptr);
+    EXPECT_EQ(alloc_handle_get(&pool, 100), nullptr);
+    EXPECT_EQ(alloc_handle_get(&pool, UINT32_MAX), nullptr);
+    ASSERT_DEATH(alloc_handle_free(&pool, ALLOC_HANDLE_NULL), "");
+}
+
+TEST_F(HandlePoolTest, GenerationWrapsAround) {
+    init_with_items(1, 16);
+
+    const alloc_handle_t first = alloc_handle(&pool, nullptr);
+    alloc_handle_free(&pool, first);
+
+    const size_t num_gens = (size_t)1 << (32 - YTALLOC_HANDLE_INDEX_BITS);
+    for (size_t round = 0; round < num_gens; round++) {
+        const alloc_handle_t handle = alloc_handle(&pool, nullptr);
+        ASSERT_NE(handle, ALLOC_HANDLE_NULL);
+        ASSERT_NE(alloc_handle_get(&pool, handle), nullptr);
+        alloc_handle_free(&pool, handle);
+    }
+}
+
+TEST_F(HandlePoolTest, DenseIteration) {
+    constexpr size_t num_items = 64;
+    init_with_items(num_items, 16);
+
+    std::map<alloc_handle_t, void *> live;
+    for (size_t round = 0; round < 2000; round++) {
+        if (rng() % 3 != 0 || live.empty()) {
+            void *ptr = nullptr;
+            const alloc_handle_t handle = alloc_handle(&pool, &ptr);
+            if (handle != ALLOC_HANDLE_NULL) { live[handle] = ptr; }
+        } else {
+            auto it = live.begin();
+            std::advance(it, rng() % live.size());
+            alloc_handle_free(&pool, it->first);
+            live.erase(it);
+        }
+
+        ASSERT_EQ(alloc_handle_num_live(&pool), live.size());
+        std::map<alloc_handle_t, void *> iterated;
+        for (size_t pos = 0; pos < alloc_handle_num_live(&pool); pos++) {
+            alloc_handle_t handle = ALLOC_HANDLE_NULL;
+            void *const ptr = alloc_handle_live_at(&pool, pos, &handle);
+            iterated[handle] = ptr;
+        }
+        ASSERT_EQ(iterated, live);
+    }
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class HeapTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        slab_storage = new (std::align_val_t(16)) uint8_t[slab_size];
+        list_storage = new (std::align_val_t(16)) uint8_t[list_size];
+        buddy_storage =
+            new (std::align_val_t(buddy_size)) uint8_t[buddy_size];
+
+        alloc_list_init(&list, list_storage, list_size);
+        alloc_buddy_init(&buddy, buddy_storage, buddy_size, free_heads,
+                         sizeof(free_heads), bitmap, sizeof(bitmap));
+        ASSERT_EQ(alloc_heap_meta_size(&buddy), sizeof(meta));
+        alloc_heap_init(&heap, slab_storage, slab_size, &list, &buddy, meta,
+                        sizeof(meta));
+    }
+
+    void TearDown() override {
+        operator delete[](slab_storage, std::align_val_t(16));
+        operator delete[](list_storage, std::align_val_t(16));
+        operator delete[](buddy_storage, std::align_val_t(buddy_size));
+    }
+
+    static bool in(const void *ptr, const void *start, size_t size) {
+        const uint8_t *const p = static_cast<const uint8_t *>(ptr);
+        const uint8_t *const s = static_cast<const uint8_t *>(start);
+        return p >= s && p < s + size;
+    }
+
+    size_t count_free_pages() const {
+        size_t num_pages = 0;
+        for (uint8_t order = 0; order < YTALLOC_BUDDY_MAX_ORDERS; order++) {
+            num_pages += alloc_buddy_count_free(&buddy, order) << order;
+        }
+        return num_pages;
+    }
+
+    static constexpr size_t slab_size = YTALLOC_HEAP_NUM_CLASSES * 16 * 1024;
+    static constexpr size_t list_size = 256 * 1024;
+    static constexpr size_t buddy_size = 256 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+
+    uint8_t *slab_storage;
+    uint8_t *list_storage;
+    uint8_t *buddy_storage;
+
+    alloc_list_t list;
+    alloc_buddy_t buddy;
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[buddy_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+    uint8_t meta[buddy_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE];
+
+    alloc_heap_t heap;
+    std::mt19937 rng;
+};
+
+TEST_F(HeapTest, InitTooSmallAborts) {
+    ASSERT_DEATH(alloc_heap_init(&heap, slab_storage, 1024, NULL, NULL, NULL,
+                                 0),
+                 "");
+}
+
+TEST_F(HeapTest, InitWithoutMetaForBuddyAborts) {
+    ASSERT_DEATH(alloc_heap_init(&heap, slab_storage, slab_size, NULL, &buddy,
+                                 meta, 1),
+                 "");
+}
+
+TEST_F(HeapTest, ClassSizesAreSorted) {
+    EXPECT_EQ(alloc_heap_class_size(0), 16);
+    for (size_t idx = 1; idx < YTALLOC_HEAP_NUM_CLASSES; idx++) {
+        EXPECT_GT(alloc_heap_class_size(idx), alloc_heap_class_size(idx - 1));
+    }
+    EXPECT_EQ(alloc_heap_class_size(YTALLOC_HEAP_NUM_CLASSES - 1),
+              YTALLOC_HEAP_SMALL_MAX);
+}
+
+TEST_F(HeapTest, SmallSizesUseTheSmallestFittingClass) {
+    for (size_t size = 1; size <= YTALLOC_HEAP_SMALL_MAX; size++) {
+        void *a = alloc_heap(&heap, size);
+        void *b = alloc_heap(&heap, size);
+        ASSERT_NE(a, nullptr);
+        ASSERT_NE(b, nullptr);
+        ASSERT_TRUE(in(a, slab_storage, slab_size));
+
+        // Two consecutive items of a fresh class are one item size apart.
+        const size_t dist =
+            static_cast<uint8_t *>(b) - static_cast<uint8_t *>(a);
+        EXPECT_GE(dist, size);
+        EXPECT_EQ(dist % 16, 0);
+        if (dist > 16) {
+            size_t class_idx = 0;
+            while (alloc_heap_class_size(class_idx) != dist) {
+                class_idx++;
+            }
+            EXPECT_LT(alloc_heap_class_size(class_idx - 1), size)
+                << "size " << size << " got a class of " << dist;
+        }
+
+        alloc_heap_free(&heap, b);
+        alloc_heap_free(&heap, a);
+    }
+}
+
+TEST_F(HeapTest, RoutesBySize) {
+    void *small = alloc_heap(&heap, 100);
+    void *medium = alloc_heap(&heap, 5000);
+    void *large = alloc_heap(&heap, 3 * YTALLOC_HEAP_LIST_MAX);
+
+    EXPECT_TRUE(in(small, slab_storage, slab_size));
+    EXPECT_TRUE(in(medium, list_storage, list_size));
+    EXPECT_TRUE(in(large, buddy_storage, buddy_size));
+
+    alloc_heap_free(&heap, small);
+    alloc_heap_free(&heap, medium);
+    alloc_heap_free(&heap, large);
+}
+
+TEST_F(HeapTest, BuddyBlocksAreFreedWithTheirSize) {
+    const size_t num_free = count_free_pages();
+    const size_t page = alloc_buddy_order0_size(&buddy);
+
+    std::vector<void *> ptrs;
+    for (size_t size : {page * 5, page * 16 + 1,
+                        size_t{YTALLOC_HEAP_LIST_MAX + 1}}) {
+        ptrs.push_back(alloc_heap(&heap, size));
+        ASSERT_TRUE(in(ptrs.back(), buddy_storage, buddy_size));
+    }
+    EXPECT_LT(count_free_pages(), num_free);
+
+    for (void *ptr : ptrs) {
+        alloc_heap_free(&heap, ptr);
+    }
+    EXPECT_EQ(count_free_pages(), num_free);
+}
+
+TEST_F(HeapTest, FullClassSpillsOver) {
+    std::vector<void *> ptrs;
+    void *ptr;
+    while ((ptr = alloc_heap(&heap, 1000)) &&
+           in(ptr, slab_storage, slab_size)) {
+        ptrs.push_back(ptr);
+    }
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_TRUE(in(ptr, list_storage, list_size));
+    ptrs.push_back(ptr);
+
+    for (void *ptr : ptrs) {
+        alloc_heap_free(&heap, ptr);
+    }
+    EXPECT_TRUE(in(alloc_heap(&heap, 1000), slab_storage, slab_size));
+}
+
+TEST_F(HeapTest, ForeignPointerAborts) {
+    uint8_t local;
+    ASSERT_DEATH(alloc_heap_free(&heap, &local), "");
+}
+
+TEST_F(HeapTest, RandomAllocAndFree) {
+    std::vector<std::pair<uint8_t *, size_t>> live;
+    std::uniform_int_distribution<size_t> size_dist(1, 40000);
+    std::bernoulli_distribution free_dist(0.45);
+
+    for (size_t iter = 0; iter < 5000; iter++) {
+        if (!live.empty() && free_dist(rng)) {
+            const size_t pos = rng() % live.size();
+            auto [ptr, size] = live[pos];
+            for (size_t idx = 0; idx < size; idx += 97) {
+                ASSERT_EQ(ptr[idx], static_cast<uint8_t>(size));
+            }
+            alloc_heap_free(&heap, ptr);
+            live[pos] = live.back();
+            live.pop_back();
+        } else {
+            const size_t size = size_dist(rng) >> (rng() % 8);
+            uint8_t *ptr = static_cast<uint8_t *>(alloc_heap(&heap, size));
+            if (!ptr) { continue; }
+            memset(ptr, static_cast<int>(size), size);
+            live.emplace_back(ptr, size);
+        }
+    }
+
+    for (auto [ptr, size] : live) {
+        alloc_heap_free(&heap, ptr);
+    }
+}
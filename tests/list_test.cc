@@ -1,3 +1,4 @@
+#include <cstring>
 #include <gtest/gtest.h>
 #include <random>
 #include <ytalloc/ytalloc.h>
@@ -123,3 +124,49 @@ TEST_F(ListHeapTest, Free) {
         alloc_list_free(&heap, ptr);
     }
 }
+
+TEST_F(ListHeapTest, UsableSizeIncludesRounding) {
+    init_with_size(1024);
+
+    size_t usable = 0;
+    void *const small = alloc_list_at_least(&heap, 1, &usable);
+    ASSERT_NE(small, nullptr);
+    EXPECT_EQ(usable, 64);
+    EXPECT_EQ(alloc_list_usable_size(&heap, small), 64);
+    random_write(small, usable);
+
+    // Odd sizes are rounded up, so that the next chunk stays aligned.
+    void *const odd = alloc_list_at_least(&heap, 101, &usable);
+    ASSERT_NE(odd, nullptr);
+    EXPECT_EQ(usable % alignof(void *), 0);
+    EXPECT_GE(usable, 101);
+    random_write(odd, usable);
+
+    void *const next = alloc_list(&heap, 16);
+    ASSERT_NE(next, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(next) % alignof(void *), 0);
+    random_write(next, 16);
+
+    check_writes();
+}
+
+TEST_F(ListHeapTest, UsableSizeOfUnsplitChunk) {
+    init_with_size(256);
+
+    // The rest of the heap is too small for another chunk, so it is all given.
+    size_t usable = 0;
+    void *const ptr = alloc_list_at_least(&heap, 128, &usable);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_GT(usable, 128);
+    EXPECT_EQ(static_cast<uint8_t *>(ptr) + usable, storage + size);
+}
+
+TEST_F(ListHeapTest, UsableSizeOfInnerPointerAborts) {
+    init_with_size(1024);
+
+    uint8_t *const ptr = static_cast<uint8_t *>(alloc_list(&heap, 128));
+    ASSERT_NE(ptr, nullptr);
+    std::memset(ptr, 0, 128);
+    ASSERT_DEATH(alloc_list_usable_size(&heap, ptr + 64), "");
+    ASSERT_DEATH(alloc_list_usable_size(&heap, ptr + 1), "");
+}
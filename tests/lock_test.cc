@@ -0,0 +1,208 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <set>
+#include <thread>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class LockTest : public testing::Test {
+  protected:
+    void SetUp() {
+        alloc_lock_spin(&spin_lock, &spin);
+        pthread_mutex_init(&mutex, NULL);
+        alloc_lock_pthread(&mutex_lock, &mutex);
+    }
+
+    void TearDown() {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // Runs `fn(thread_idx)` on `num_threads` threads at once.
+    template <typename Fn> void run_threads(size_t num_threads, Fn fn) {
+        std::vector<std::thread> threads;
+        for (size_t idx = 0; idx < num_threads; idx++) {
+            threads.emplace_back(fn, idx);
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    static constexpr size_t num_threads = 4;
+
+    alloc_spinlock_t spin;
+    alloc_lock_t spin_lock;
+    pthread_mutex_t mutex;
+    alloc_lock_t mutex_lock;
+};
+
+TEST_F(LockTest, SpinTryLock) {
+    EXPECT_TRUE(spin_lock.trylock(spin_lock.obj));
+    EXPECT_FALSE(spin_lock.trylock(spin_lock.obj));
+    spin_lock.unlock(spin_lock.obj);
+    EXPECT_TRUE(spin_lock.trylock(spin_lock.obj));
+    spin_lock.unlock(spin_lock.obj);
+}
+
+TEST_F(LockTest, PthreadTryLock) {
+    EXPECT_TRUE(mutex_lock.trylock(mutex_lock.obj));
+    std::thread([&] {
+        EXPECT_FALSE(mutex_lock.trylock(mutex_lock.obj));
+    }).join();
+    mutex_lock.unlock(mutex_lock.obj);
+}
+
+TEST_F(LockTest, NullLockIsUnlocked) {
+    alignas(64) uint8_t storage[64 * 4];
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, storage, sizeof(storage), 64);
+
+    void *const ptr = alloc_slab_locked(&heap);
+    ASSERT_NE(ptr, nullptr);
+    alloc_slab_free_locked(&heap, ptr);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+}
+
+TEST_F(LockTest, SlabSharedBetweenThreads) {
+    constexpr size_t alloc_size = 64;
+    constexpr size_t num_items = 256;
+    constexpr size_t num_rounds = 20000;
+
+    std::vector<uint8_t> storage(alloc_size * (num_items + 1));
+    uint8_t *const start = (uint8_t *)(((uintptr_t)storage.data() +
+                                        alloc_size - 1) &
+                                       ~(uintptr_t)(alloc_size - 1));
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, start, alloc_size * num_items, alloc_size);
+    alloc_slab_set_lock(&heap, &spin_lock);
+
+    std::atomic<size_t> num_corrupt = 0;
+    run_threads(num_threads, [&](size_t thread_idx) {
+        void *ptrs[8];
+        for (size_t round = 0; round < num_rounds; round++) {
+            const size_t num_got = alloc_slab_bulk_locked(&heap, ptrs, 4);
+            for (size_t idx = 0; idx < num_got; idx++) {
+                *(size_t *)ptrs[idx] = thread_idx;
+            }
+            void *const single = alloc_slab_locked(&heap);
+            if (single) { *(size_t *)single = thread_idx; }
+
+            for (size_t idx = 0; idx < num_got; idx++) {
+                if (*(size_t *)ptrs[idx] != thread_idx) { num_corrupt++; }
+            }
+            if (single && *(size_t *)single != thread_idx) { num_corrupt++; }
+
+            alloc_slab_free_bulk_locked(&heap, ptrs, num_got);
+            alloc_slab_free_locked(&heap, single);
+        }
+    });
+
+    EXPECT_EQ(num_corrupt, 0);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+}
+
+TEST_F(LockTest, SlabCtorRunsOnceOutsideLock) {
+    constexpr size_t alloc_size = 64;
+    constexpr size_t num_items = 64;
+
+    struct Ctx {
+        alloc_lock_t *lock;
+        std::atomic<size_t> num_calls;
+        std::atomic<size_t> num_locked;
+    } ctx = {&spin_lock, 0, 0};
+
+    alignas(alloc_size) static uint8_t storage[alloc_size * num_items];
+    alloc_slab_opts_t opts = {};
+    opts.link_offset = 0;
+    opts.ctor = [](void *obj, void *arg) {
+        Ctx *const ctx = (Ctx *)arg;
+        ctx->num_calls++;
+        if (!ctx->lock->trylock(ctx->lock->obj)) {
+            ctx->num_locked++;
+        } else {
+            ctx->lock->unlock(ctx->lock->obj);
+        }
+        memset((uint8_t *)obj + sizeof(uintptr_t), 0xAB,
+               alloc_size - sizeof(uintptr_t));
+    };
+    opts.ctor_arg = &ctx;
+
+    alloc_slab_t heap;
+    alloc_slab_init_opts(&heap, storage, sizeof(storage), alloc_size, &opts);
+    alloc_slab_set_lock(&heap, &spin_lock);
+
+    void *ptrs[num_items];
+    EXPECT_EQ(alloc_slab_bulk_locked(&heap, ptrs, num_items / 2),
+              num_items / 2);
+    alloc_slab_free_bulk_locked(&heap, ptrs, num_items / 2);
+    for (size_t idx = 0; idx < num_items; idx++) {
+        ptrs[idx] = alloc_slab_locked(&heap);
+        ASSERT_NE(ptrs[idx], nullptr);
+    }
+
+    EXPECT_EQ(ctx.num_calls, num_items);
+    EXPECT_EQ(ctx.num_locked, 0);
+}
+
+TEST_F(LockTest, ListSharedBetweenThreads) {
+    constexpr size_t heap_size = 64 * 1024;
+    constexpr size_t num_rounds = 2000;
+
+    alignas(16) static uint8_t storage[heap_size];
+    alloc_list_t heap;
+    alloc_list_init(&heap, storage, heap_size);
+    alloc_list_set_lock(&heap, &mutex_lock);
+
+    std::atomic<size_t> num_corrupt = 0;
+    run_threads(num_threads, [&](size_t thread_idx) {
+        for (size_t round = 0; round < num_rounds; round++) {
+            const size_t size = 16 + (round % 7) * 24;
+            uint8_t *const ptr = (uint8_t *)alloc_list_locked(&heap, size);
+            if (!ptr) { continue; }
+            memset(ptr, (int)thread_idx, size);
+            for (size_t idx = 0; idx < size; idx++) {
+                if (ptr[idx] != thread_idx) {
+                    num_corrupt++;
+                    break;
+                }
+            }
+            alloc_list_free_locked(&heap, ptr);
+        }
+    });
+
+    EXPECT_EQ(num_corrupt, 0);
+    EXPECT_NE(alloc_list_locked(&heap, heap_size / 2), nullptr);
+}
+
+TEST_F(LockTest, BuddySharedBetweenThreads) {
+    constexpr size_t heap_size = 64 * 4096;
+    constexpr size_t num_rounds = 5000;
+
+    uint8_t *const storage =
+        new (std::align_val_t(heap_size)) uint8_t[heap_size];
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[256];
+    alloc_buddy_t heap;
+    alloc_buddy_init(&heap, storage, heap_size, free_heads,
+                     sizeof(free_heads), bitmap, sizeof(bitmap));
+    alloc_buddy_set_lock(&heap, &spin_lock);
+
+    std::atomic<size_t> num_failed = 0;
+    run_threads(num_threads, [&](size_t thread_idx) {
+        for (size_t round = 0; round < num_rounds; round++) {
+            const size_t size = 4096 << (round % 3);
+            void *const ptr = alloc_buddy_locked(&heap, size);
+            if (!ptr) {
+                num_failed++;
+                continue;
+            }
+            *(size_t *)ptr = thread_idx;
+            alloc_buddy_free_locked(&heap, ptr, size);
+        }
+    });
+
+    EXPECT_EQ(num_failed, 0);
+    EXPECT_NE(alloc_buddy(&heap, heap_size), nullptr);
+    operator delete[](storage, std::align_val_t(heap_size));
+}
@@ -0,0 +1,237 @@
+#include <cstdlib>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <malloc.h>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// This test is linked with libytalloc_malloc.so, so every allocation in the
+// process, including the ones made by gtest, goes through the shim.
+
+class MallocTest : public testing::Test {
+  protected:
+    static bool is_aligned(const void *ptr, size_t align) {
+        return reinterpret_cast<uintptr_t>(ptr) % align == 0;
+    }
+
+    std::mt19937 rng;
+};
+
+TEST_F(MallocTest, ShimIsInterposed) {
+    // glibc would give 104 usable bytes, the shim rounds up to a size class.
+    void *ptr = malloc(100);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(malloc_usable_size(ptr), 112);
+    free(ptr);
+}
+
+TEST_F(MallocTest, AllSizesAreUsableAndAligned) {
+    std::vector<std::pair<uint8_t *, size_t>> blocks;
+    for (size_t size = 0; size <= 3000; size += 7) {
+        blocks.emplace_back(static_cast<uint8_t *>(malloc(size)), size);
+    }
+    for (size_t size = 4096; size <= 4 * 1024 * 1024; size *= 2) {
+        blocks.emplace_back(static_cast<uint8_t *>(malloc(size - 1)), size - 1);
+        blocks.emplace_back(static_cast<uint8_t *>(malloc(size + 1)), size + 1);
+    }
+
+    for (auto [ptr, size] : blocks) {
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_TRUE(is_aligned(ptr, 16)) << "size " << size;
+        EXPECT_GE(malloc_usable_size(ptr), size);
+        memset(ptr, static_cast<int>(size), size);
+    }
+    for (auto [ptr, size] : blocks) {
+        for (size_t idx = 0; idx < size; idx++) {
+            ASSERT_EQ(ptr[idx], static_cast<uint8_t>(size))
+                << "block of size " << size << " has been overwritten";
+        }
+        free(ptr);
+    }
+}
+
+TEST_F(MallocTest, ZeroSizeGivesUniquePointers) {
+    void *a = malloc(0);
+    void *b = malloc(0);
+    EXPECT_NE(a, nullptr);
+    EXPECT_NE(b, nullptr);
+    EXPECT_NE(a, b);
+    free(a);
+    free(b);
+    free(nullptr);
+}
+
+TEST_F(MallocTest, Calloc) {
+    for (size_t size : {8, 100, 5000, 200000}) {
+        // Dirty the memory first, so that calloc has to clear reused blocks.
+        void *dirty = malloc(size);
+        memset(dirty, 0xAB, size);
+        free(dirty);
+
+        uint8_t *ptr = static_cast<uint8_t *>(calloc(1, size));
+        ASSERT_NE(ptr, nullptr);
+        for (size_t idx = 0; idx < size; idx++) {
+            ASSERT_EQ(ptr[idx], 0);
+        }
+        free(ptr);
+    }
+
+    volatile size_t huge = SIZE_MAX / 2;
+    errno = 0;
+    EXPECT_EQ(calloc(huge, 3), nullptr);
+    EXPECT_EQ(errno, ENOMEM);
+}
+
+TEST_F(MallocTest, ReallocKeepsContents) {
+    uint8_t *ptr = nullptr;
+    size_t old_size = 0;
+    for (size_t size : {1, 20, 200, 1000, 3000, 70000, 300000, 1000, 10}) {
+        ptr = static_cast<uint8_t *>(realloc(ptr, size));
+        ASSERT_NE(ptr, nullptr);
+        const size_t kept = old_size < size ? old_size : size;
+        for (size_t idx = 0; idx < kept; idx++) {
+            ASSERT_EQ(ptr[idx], static_cast<uint8_t>(idx * 7))
+                << "realloc from " << old_size << " to " << size;
+        }
+        for (size_t idx = 0; idx < size; idx++) {
+            ptr[idx] = static_cast<uint8_t>(idx * 7);
+        }
+        old_size = size;
+    }
+    EXPECT_EQ(realloc(ptr, 0), nullptr);
+}
+
+TEST_F(MallocTest, AlignedAllocations) {
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    std::vector<void *> ptrs;
+    for (size_t align = 8; align <= 4 * 1024 * 1024; align *= 2) {
+        for (size_t size : {1, 24, 100, 1000, 5000, 100000, 3000000}) {
+            void *ptr = nullptr;
+            ASSERT_EQ(posix_memalign(&ptr, align, size), 0);
+            EXPECT_TRUE(is_aligned(ptr, align))
+                << "align " << align << ", size " << size;
+            EXPECT_GE(malloc_usable_size(ptr), size);
+            memset(ptr, 0xCD, size);
+            ptrs.push_back(ptr);
+
+            ptr = aligned_alloc(align, size);
+            ASSERT_NE(ptr, nullptr);
+            EXPECT_TRUE(is_aligned(ptr, align));
+            ptrs.push_back(ptr);
+        }
+    }
+
+    void *ptr = valloc(10);
+    EXPECT_TRUE(is_aligned(ptr, page_size));
+    ptrs.push_back(ptr);
+    ptr = pvalloc(10);
+    EXPECT_TRUE(is_aligned(ptr, page_size));
+    EXPECT_GE(malloc_usable_size(ptr), page_size);
+    ptrs.push_back(ptr);
+
+    for (void *ptr : ptrs) {
+        free(ptr);
+    }
+
+    void *unused = nullptr;
+    EXPECT_EQ(posix_memalign(&unused, 24, 10), EINVAL);
+    EXPECT_EQ(posix_memalign(&unused, 4, 10), EINVAL);
+    EXPECT_EQ(memalign(3, 10), nullptr);
+}
+
+TEST_F(MallocTest, RandomChurn) {
+    constexpr size_t num_slots = 2000;
+    std::vector<std::pair<uint8_t *, size_t>> slots(num_slots);
+    std::uniform_int_distribution<size_t> slot_dist(0, num_slots - 1);
+    std::geometric_distribution<size_t> size_dist(1.0 / 300);
+
+    for (size_t iter = 0; iter < 200000; iter++) {
+        auto &[ptr, size] = slots[slot_dist(rng)];
+        if (ptr) {
+            ASSERT_EQ(ptr[0], static_cast<uint8_t>(size));
+            ASSERT_EQ(ptr[size - 1], static_cast<uint8_t>(size));
+            free(ptr);
+        }
+        size = size_dist(rng) + 1;
+        ptr = static_cast<uint8_t *>(malloc(size));
+        ASSERT_NE(ptr, nullptr);
+        ptr[0] = ptr[size - 1] = static_cast<uint8_t>(size);
+    }
+    for (auto &[ptr, size] : slots) {
+        free(ptr);
+    }
+}
+
+TEST_F(MallocTest, ThreadsFreeEachOthersBlocks) {
+    constexpr size_t num_threads = 4;
+    constexpr size_t num_blocks = 20000;
+    std::vector<std::vector<void *>> blocks(num_threads);
+
+    std::vector<std::thread> threads;
+    for (size_t tidx = 0; tidx < num_threads; tidx++) {
+        threads.emplace_back([&, tidx] {
+            std::mt19937 rng(tidx);
+            std::uniform_int_distribution<size_t> size_dist(1, 4000);
+            for (size_t idx = 0; idx < num_blocks; idx++) {
+                const size_t size = size_dist(rng);
+                void *ptr = malloc(size);
+                memset(ptr, 0, size);
+                blocks[tidx].push_back(ptr);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    threads.clear();
+    for (size_t tidx = 0; tidx < num_threads; tidx++) {
+        threads.emplace_back([&, tidx] {
+            for (void *ptr : blocks[(tidx + 1) % num_threads]) {
+                free(ptr);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+TEST_F(MallocTest, StandardContainers) {
+    std::map<std::string, std::vector<int>> map;
+    for (int idx = 0; idx < 10000; idx++) {
+        map[std::to_string(idx * 7919)].assign(idx % 50, idx);
+    }
+    for (int idx = 0; idx < 10000; idx += 2) {
+        map.erase(std::to_string(idx * 7919));
+    }
+    EXPECT_EQ(map.size(), 5000);
+    EXPECT_EQ(map[std::to_string(7919)].size(), 1);
+}
+
+TEST_F(MallocTest, ForkedChildCanAllocate) {
+    std::thread busy([] {
+        for (size_t idx = 0; idx < 100000; idx++) {
+            free(malloc(64));
+        }
+    });
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        void *ptr = malloc(64);
+        free(ptr);
+        _exit(ptr ? 0 : 1);
+    }
+    busy.join();
+
+    ASSERT_GT(pid, 0);
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
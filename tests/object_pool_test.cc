@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <ytalloc/object_pool.h>
+
+namespace {
+
+struct Tracked {
+    static inline int num_live = 0;
+
+    explicit Tracked(int value) : value(value) {
+        if (value < 0) { throw std::invalid_argument("negative"); }
+        num_live++;
+    }
+
+    ~Tracked() {
+        num_live--;
+    }
+
+    int value;
+    std::string name = "tracked";
+};
+
+struct alignas(64) Wide {
+    char bytes[72];
+};
+
+} // namespace
+
+class ObjectPoolTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        Tracked::num_live = 0;
+    }
+
+    static constexpr size_t storage_size = 64 * 1024;
+
+    alignas(64) uint8_t storage[storage_size];
+};
+
+TEST_F(ObjectPoolTest, ItemsFitTheType) {
+    using TrackedPool = ytalloc::ObjectPool<Tracked>;
+    using WidePool = ytalloc::ObjectPool<Wide>;
+    using CharPool = ytalloc::ObjectPool<char>;
+
+    static_assert(TrackedPool::item_size >= sizeof(Tracked));
+    static_assert(TrackedPool::item_size % alignof(Tracked) == 0);
+    static_assert(WidePool::item_size == 128);
+    static_assert(CharPool::item_size == sizeof(uintptr_t));
+
+    WidePool pool(storage + 8, storage_size - 8);
+    EXPECT_EQ(pool.capacity(), (storage_size - 8) / 128);
+    for (size_t idx = 0; idx < pool.capacity(); idx++) {
+        Wide *const obj = pool.create();
+        ASSERT_NE(obj, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(obj) % alignof(Wide), 0);
+    }
+    EXPECT_EQ(pool.create(), nullptr);
+}
+
+TEST_F(ObjectPoolTest, RegionSmallerThanTheSkipAborts) {
+    using WidePool = ytalloc::ObjectPool<Wide>;
+    // At least 56 bytes are skipped to align the start at 128.
+    ASSERT_DEATH(WidePool(storage + 8, 32), "");
+    ASSERT_DEATH(WidePool(storage + 8, 56 + 64), "");
+}
+
+TEST_F(ObjectPoolTest, HandlesDestroyAndFree) {
+    ytalloc::ObjectPool<Tracked> pool(storage, storage_size);
+    {
+        auto a = pool.make(1);
+        auto b = pool.make(2);
+        EXPECT_EQ(a->value, 1);
+        EXPECT_EQ(b->name, "tracked");
+        EXPECT_EQ(Tracked::num_live, 2);
+        EXPECT_EQ(pool.size(), 2);
+    }
+    EXPECT_EQ(Tracked::num_live, 0);
+    EXPECT_EQ(pool.size(), 0);
+}
+
+TEST_F(ObjectPoolTest, FreedItemIsReusedFirst) {
+    ytalloc::ObjectPool<Tracked> pool(storage, storage_size);
+    Tracked *const a = pool.create(1);
+    Tracked *const b = pool.create(2);
+    pool.destroy(a);
+    EXPECT_EQ(pool.create(3), a);
+    pool.destroy(b);
+}
+
+TEST_F(ObjectPoolTest, ThrowingConstructorReturnsTheItem) {
+    ytalloc::ObjectPool<Tracked> pool(storage, storage_size);
+    EXPECT_THROW(pool.create(-1), std::invalid_argument);
+    EXPECT_EQ(pool.size(), 0);
+    EXPECT_EQ(Tracked::num_live, 0);
+}
+
+TEST_F(ObjectPoolTest, FullPoolGivesEmptyHandle) {
+    ytalloc::ObjectPool<Tracked> pool(storage, 4 * sizeof(Tracked));
+    std::vector<ytalloc::ObjectPool<Tracked>::Handle> handles;
+    for (size_t idx = 0; idx < pool.capacity(); idx++) {
+        handles.push_back(pool.make(static_cast<int>(idx)));
+        ASSERT_TRUE(handles.back());
+    }
+    EXPECT_FALSE(pool.make(0));
+}
+
+TEST_F(ObjectPoolTest, ClearDestroysOnlyLiveObjects) {
+    ytalloc::ObjectPool<Tracked> pool(storage, storage_size);
+    std::vector<Tracked *> objs;
+    for (int idx = 0; idx < 100; idx++) {
+        objs.push_back(pool.create(idx));
+    }
+    for (int idx = 0; idx < 100; idx += 3) {
+        pool.destroy(objs[idx]);
+    }
+    EXPECT_EQ(Tracked::num_live, 66);
+
+    pool.clear();
+    EXPECT_EQ(Tracked::num_live, 0);
+    EXPECT_EQ(pool.size(), 0);
+
+    // The pool is usable again and is refilled from the start.
+    EXPECT_EQ(pool.create(7), objs[0]);
+}
+
+TEST_F(ObjectPoolTest, DestructorClears) {
+    {
+        ytalloc::ObjectPool<Tracked> pool(storage, storage_size);
+        pool.make(1).release();
+        pool.create(2);
+    }
+    EXPECT_EQ(Tracked::num_live, 0);
+}
@@ -0,0 +1,156 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class OpsTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        storage = new (std::align_val_t(storage_size)) uint8_t[storage_size];
+    }
+
+    void TearDown() override {
+        operator delete[](storage, std::align_val_t(storage_size));
+    }
+
+    // Initializes the engine called @a name over the whole storage.
+    void *init(const std::string &name) {
+        if (name == "list") {
+            alloc_list_init(&list, storage, storage_size);
+            return &list;
+        } else if (name == "static") {
+            alloc_static_init(&bump, storage, storage_size);
+            return &bump;
+        } else if (name == "buddy") {
+            alloc_buddy_init(&buddy, storage, storage_size, free_heads,
+                             sizeof(free_heads), bitmap, sizeof(bitmap));
+            return &buddy;
+        } else {
+            alloc_slab_init(&slab, storage, storage_size, item_size);
+            return &slab;
+        }
+    }
+
+    bool in_storage(const void *ptr) const {
+        const uint8_t *const p = static_cast<const uint8_t *>(ptr);
+        return p >= storage && p < storage + storage_size;
+    }
+
+    static constexpr size_t storage_size = 16 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    static constexpr size_t item_size = 64;
+    static inline const std::vector<std::string> names = {"list", "static",
+                                                          "buddy", "slab"};
+
+    uint8_t *storage;
+    alloc_list_t list;
+    alloc_static_t bump;
+    alloc_buddy_t buddy;
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[storage_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+    alloc_slab_t slab;
+};
+
+TEST_F(OpsTest, FindByName) {
+    for (const std::string &name : names) {
+        const alloc_ops_t *const ops = alloc_ops_find(name.c_str());
+        ASSERT_NE(ops, nullptr) << name;
+        EXPECT_EQ(ops->name, name);
+    }
+    EXPECT_EQ(alloc_ops_find("slab"), &alloc_slab_ops);
+    EXPECT_EQ(alloc_ops_find("malloc"), nullptr);
+}
+
+TEST_F(OpsTest, AllocWriteFree) {
+    for (const std::string &name : names) {
+        SCOPED_TRACE(name);
+        const alloc_ops_t *const ops = alloc_ops_find(name.c_str());
+        void *const heap = init(name);
+
+        std::vector<void *> ptrs;
+        for (int idx = 0; idx < 12; idx++) {
+            void *const ptr = ops->alloc(heap, 48);
+            ASSERT_NE(ptr, nullptr);
+            ASSERT_TRUE(in_storage(ptr));
+            ASSERT_GE(ops->usable_size(heap, ptr, 48), 48);
+            std::memset(ptr, idx, ops->usable_size(heap, ptr, 48));
+            ptrs.push_back(ptr);
+        }
+        for (int idx = 0; idx < 12; idx++) {
+            EXPECT_EQ(static_cast<uint8_t *>(ptrs[idx])[47], idx);
+            ops->free(heap, ptrs[idx], 48);
+        }
+    }
+}
+
+TEST_F(OpsTest, AlignedAlloc) {
+    for (const std::string &name : names) {
+        SCOPED_TRACE(name);
+        const alloc_ops_t *const ops = alloc_ops_find(name.c_str());
+        void *const heap = init(name);
+
+        void *const ptr = ops->aligned_alloc(heap, 40, 32);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 32, 0);
+        ops->free(heap, ptr, 40);
+    }
+}
+
+TEST_F(OpsTest, ListAlignedAllocKeepsTheHeadFree) {
+    void *const heap = init("list");
+
+    void *const ptr = alloc_list_ops.aligned_alloc(heap, 100, 1024);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 1024, 0);
+
+    // The chunk split off before the aligned one is still there to use.
+    void *const head = alloc_list(&list, 64);
+    ASSERT_NE(head, nullptr);
+    EXPECT_LT(head, ptr);
+
+    alloc_list_free(&list, head);
+    alloc_list_free(&list, ptr);
+}
+
+TEST_F(OpsTest, StatsAndReset) {
+    for (const std::string &name : names) {
+        SCOPED_TRACE(name);
+        const alloc_ops_t *const ops = alloc_ops_find(name.c_str());
+        void *const heap = init(name);
+
+        alloc_ops_stats_t before;
+        ops->stats(heap, &before);
+        EXPECT_GT(before.heap_size, 0);
+        EXPECT_LE(before.heap_size, storage_size);
+        EXPECT_EQ(before.used_size, 0);
+
+        // Allocate until the heap is full.
+        size_t num_allocs = 0;
+        while (ops->alloc(heap, item_size)) {
+            num_allocs++;
+        }
+        alloc_ops_stats_t full;
+        ops->stats(heap, &full);
+        EXPECT_GE(full.used_size, num_allocs * item_size);
+        EXPECT_LT(full.free_size, before.free_size);
+
+        ops->reset(heap);
+        alloc_ops_stats_t after;
+        ops->stats(heap, &after);
+        EXPECT_EQ(after.used_size, 0);
+        EXPECT_EQ(after.free_size, before.free_size);
+        EXPECT_NE(ops->alloc(heap, item_size), nullptr);
+    }
+}
+
+TEST_F(OpsTest, UsableSizeShowsRounding) {
+    void *heap = init("buddy");
+    void *ptr = alloc_buddy_ops.alloc(heap, 5000);
+    EXPECT_EQ(alloc_buddy_ops.usable_size(heap, ptr, 5000), 8192);
+    alloc_buddy_ops.free(heap, ptr, 5000);
+
+    heap = init("slab");
+    ptr = alloc_slab_ops.alloc(heap, 1);
+    EXPECT_EQ(alloc_slab_ops.usable_size(heap, ptr, 1), item_size);
+    EXPECT_EQ(alloc_slab_ops.alloc(heap, item_size + 1), nullptr);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+#include <ytalloc/pmr.h>
+
+namespace {
+
+// Forwards to the new/delete resource and counts live blocks.
+class CountingResource : public std::pmr::memory_resource {
+  public:
+    size_t num_live = 0;
+
+  protected:
+    void *do_allocate(size_t bytes, size_t align) override {
+        num_live++;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void *ptr, size_t bytes, size_t align) override {
+        num_live--;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, align);
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace
+
+class PmrTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        storage = new (std::align_val_t(storage_size)) uint8_t[storage_size];
+    }
+
+    void TearDown() override {
+        operator delete[](storage, std::align_val_t(storage_size));
+    }
+
+    static bool in(const void *ptr, const void *start, size_t size) {
+        const uint8_t *const p = static_cast<const uint8_t *>(ptr);
+        const uint8_t *const s = static_cast<const uint8_t *>(start);
+        return p >= s && p < s + size;
+    }
+
+    static constexpr size_t storage_size = 64 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+
+    uint8_t *storage;
+};
+
+TEST_F(PmrTest, ListVectorGrows) {
+    alloc_list_t heap;
+    alloc_list_init(&heap, storage, storage_size);
+    ytalloc::list_resource res(&heap);
+
+    std::pmr::vector<int> vec(&res);
+    for (int idx = 0; idx < 10000; idx++) {
+        vec.push_back(idx);
+    }
+    ASSERT_TRUE(in(vec.data(), storage, storage_size));
+    for (int idx = 0; idx < 10000; idx++) {
+        ASSERT_EQ(vec[idx], idx);
+    }
+}
+
+TEST_F(PmrTest, ListOverAlignedBlocksAreFreed) {
+    alloc_list_t heap;
+    alloc_list_init(&heap, storage, storage_size);
+    ytalloc::list_resource res(&heap);
+
+    // Each round would run out of space if the chunks were not freed.
+    for (int round = 0; round < 64; round++) {
+        void *const ptr = res.allocate(storage_size / 2, 256);
+        ASSERT_TRUE(in(ptr, storage, storage_size));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % 256, 0);
+        res.deallocate(ptr, storage_size / 2, 256);
+    }
+}
+
+TEST_F(PmrTest, ListExhaustionThrows) {
+    alloc_list_t heap;
+    alloc_list_init(&heap, storage, storage_size);
+    ytalloc::list_resource res(&heap);
+
+    ASSERT_THROW((void)res.allocate(2 * storage_size), std::bad_alloc);
+}
+
+TEST_F(PmrTest, BuddyPassesSizeToFree) {
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[storage_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+    alloc_buddy_t heap;
+    alloc_buddy_init(&heap, storage, storage_size, free_heads,
+                     sizeof(free_heads), bitmap, sizeof(bitmap));
+    ytalloc::buddy_resource res(&heap);
+
+    const size_t sizes[] = {1, 4096, 5000, storage_size / 4, storage_size};
+    for (size_t size : sizes) {
+        void *const ptr = res.allocate(size);
+        ASSERT_TRUE(in(ptr, storage, storage_size));
+        res.deallocate(ptr, size);
+    }
+
+    size_t num_free_pages = 0;
+    for (uint8_t order = 0; order < YTALLOC_BUDDY_MAX_ORDERS; order++) {
+        num_free_pages += alloc_buddy_count_free(&heap, order) << order;
+    }
+    EXPECT_EQ(num_free_pages, storage_size / alloc_buddy_order0_size(&heap));
+    ASSERT_THROW((void)res.allocate(2 * storage_size), std::bad_alloc);
+}
+
+TEST_F(PmrTest, SlabTakesNodesAndForwardsTheRest) {
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, storage, storage_size, 32);
+    CountingResource upstream;
+    ytalloc::slab_resource res(&heap, &upstream);
+
+    {
+        std::pmr::unordered_map<int, int> map(&res);
+        for (int idx = 0; idx < 1000; idx++) {
+            map.emplace(idx, -idx);
+        }
+        for (const auto &[key, value] : map) {
+            ASSERT_EQ(value, -key);
+        }
+
+        // Only the bucket array is upstream.
+        EXPECT_EQ(upstream.num_live, 1);
+        EXPECT_TRUE(in(&*map.begin(), storage, storage_size));
+    }
+    EXPECT_EQ(upstream.num_live, 0);
+
+    void *const over_aligned = res.allocate(16, 64);
+    EXPECT_FALSE(in(over_aligned, storage, storage_size));
+    res.deallocate(over_aligned, 16, 64);
+    EXPECT_EQ(upstream.num_live, 0);
+}
+
+TEST_F(PmrTest, StaticIsMonotonic) {
+    alloc_static_t heap;
+    alloc_static_init(&heap, storage, storage_size);
+    ytalloc::static_resource res(&heap);
+
+    void *const a = res.allocate(100, 64);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 64, 0);
+    res.deallocate(a, 100, 64);
+    void *const b = res.allocate(100, 64);
+    EXPECT_NE(a, b);
+
+    res.release();
+    EXPECT_EQ(res.allocate(100, 64), a);
+    ASSERT_THROW((void)res.allocate(storage_size), std::bad_alloc);
+}
+
+TEST_F(PmrTest, ResourcesAreEqualOnlyToThemselves) {
+    alloc_static_t heap;
+    alloc_static_init(&heap, storage, storage_size);
+    ytalloc::static_resource a(&heap);
+    ytalloc::static_resource b(&heap);
+
+    EXPECT_TRUE(a.is_equal(a));
+    EXPECT_FALSE(a.is_equal(b));
+    EXPECT_FALSE(a.is_equal(*std::pmr::new_delete_resource()));
+}
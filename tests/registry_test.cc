@@ -0,0 +1,280 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class RegistryTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        pool.resize(pool_size / sizeof(uintptr_t));
+        alloc_registry_init(&reg, pool.data(), pool_size);
+        storage = new (std::align_val_t(page)) uint8_t[storage_size];
+    }
+
+    void TearDown() override {
+        alloc_set_registry(NULL);
+        operator delete[](storage, std::align_val_t(page));
+    }
+
+    static constexpr size_t page = size_t{1} << YTALLOC_REGISTRY_PAGE_SHIFT;
+    static constexpr size_t storage_size = 64 * page;
+    const size_t pool_size = alloc_registry_min_pool_size() + 64 * 1024;
+
+    std::vector<uintptr_t> pool;
+    alloc_registry_t reg;
+    uint8_t *storage;
+};
+
+TEST_F(RegistryTest, InitTooSmallPoolAborts) {
+    ASSERT_DEATH(alloc_registry_init(&reg, pool.data(),
+                                     alloc_registry_min_pool_size() - 8),
+                 "");
+}
+
+TEST_F(RegistryTest, FindInsideAndOutside) {
+    int heap;
+    ASSERT_TRUE(alloc_registry_add(&reg, ALLOC_KIND_SLAB, &heap, storage + 100,
+                                   3 * page));
+
+    const alloc_region_t *region = alloc_registry_find(&reg, storage + 100);
+    ASSERT_NE(region, nullptr);
+    EXPECT_EQ(region->heap, &heap);
+    EXPECT_EQ(region->kind, ALLOC_KIND_SLAB);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 100 + 3 * page - 1), region);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 2 * page), region);
+
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 99), nullptr);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 100 + 3 * page), nullptr);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 10 * page), nullptr);
+    EXPECT_EQ(alloc_registry_find(&reg, nullptr), nullptr);
+}
+
+TEST_F(RegistryTest, RegionsSharingAPage) {
+    int heaps[4];
+    for (size_t idx = 0; idx < 4; idx++) {
+        ASSERT_TRUE(alloc_registry_add(&reg, ALLOC_KIND_LIST, &heaps[idx],
+                                       storage + idx * 256, 256));
+    }
+    for (size_t idx = 0; idx < 4; idx++) {
+        for (size_t off : {0, 17, 255}) {
+            const alloc_region_t *region =
+                alloc_registry_find(&reg, storage + idx * 256 + off);
+            ASSERT_NE(region, nullptr);
+            EXPECT_EQ(region->heap, &heaps[idx]);
+        }
+    }
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 1024), nullptr);
+
+    alloc_registry_remove(&reg, &heaps[0]);
+    alloc_registry_remove(&reg, &heaps[2]);
+    EXPECT_EQ(alloc_registry_find(&reg, storage), nullptr);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 512), nullptr);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 256)->heap, &heaps[1]);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 768)->heap, &heaps[3]);
+}
+
+TEST_F(RegistryTest, NestedRegionFoundFirst) {
+    int outer;
+    int inner;
+    ASSERT_TRUE(alloc_registry_add(&reg, ALLOC_KIND_BUDDY, &outer, storage,
+                                   storage_size));
+    ASSERT_TRUE(alloc_registry_add(&reg, ALLOC_KIND_SLAB, &inner,
+                                   storage + 4 * page, 2 * page));
+
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 5 * page)->heap, &inner);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 7 * page)->heap, &outer);
+
+    alloc_registry_remove(&reg, &inner);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 5 * page)->heap, &outer);
+}
+
+TEST_F(RegistryTest, OutOfPoolRegistersNothing) {
+    alloc_registry_t small;
+    alloc_registry_init(&small, pool.data(), alloc_registry_min_pool_size());
+
+    // The pool has room for the nodes on one path, but not for them and the
+    // region descriptor.
+    int heap;
+    EXPECT_FALSE(alloc_registry_add(&small, ALLOC_KIND_SLAB, &heap, storage,
+                                    page));
+    EXPECT_EQ(alloc_registry_find(&small, storage), nullptr);
+}
+
+TEST_F(RegistryTest, InitRegistersAndGenericFree) {
+    alloc_set_registry(&reg);
+
+    alloc_slab_t slab;
+    alloc_list_t list;
+    alloc_ring_t ring;
+    alloc_slab_init(&slab, storage, 4 * page, 64);
+    alloc_list_init(&list, storage + 4 * page, 4 * page);
+    alloc_ring_init(&ring, storage + 8 * page, 4 * page);
+
+    void *from_slab = alloc_slab(&slab);
+    void *from_list = alloc_list(&list, 100);
+    void *from_ring = alloc_ring(&ring, 100);
+
+    EXPECT_EQ(alloc_registry_find(&reg, from_slab)->heap, &slab);
+    EXPECT_EQ(alloc_registry_find(&reg, from_list)->heap, &list);
+    EXPECT_EQ(alloc_registry_find(&reg, from_ring)->heap, &ring);
+
+    alloc_registry_free(&reg, from_slab);
+    alloc_registry_free(&reg, from_list);
+    alloc_registry_free(&reg, from_ring);
+    EXPECT_EQ(alloc_slab_num_used(&slab), 0);
+    EXPECT_EQ(alloc_ring_num_live(&ring), 0);
+    EXPECT_EQ(alloc_list(&list, 100), from_list);
+}
+
+TEST_F(RegistryTest, ReinitMovesTheRegion) {
+    alloc_set_registry(&reg);
+
+    alloc_slab_t slab;
+    alloc_slab_init(&slab, storage, 2 * page, 64);
+    alloc_slab_init(&slab, storage + 8 * page, 2 * page, 64);
+
+    EXPECT_EQ(alloc_registry_find(&reg, storage), nullptr);
+    EXPECT_EQ(alloc_registry_find(&reg, storage + 8 * page)->heap, &slab);
+}
+
+TEST_F(RegistryTest, ResetKeepsTheRegistration) {
+    alloc_registry_t small;
+    alloc_registry_init(&small, pool.data(),
+                        alloc_registry_min_pool_size() + 4 * 1024);
+    alloc_set_registry(&small);
+
+    alloc_list_t list;
+    alloc_list_init(&list, storage, 4 * page);
+    for (int idx = 0; idx < 1000; idx++) {
+        alloc_list_ops.reset(&list);
+    }
+    const alloc_region_t *const region = alloc_registry_find(&small, storage);
+    ASSERT_NE(region, nullptr);
+    EXPECT_EQ(region->heap, &list);
+}
+
+TEST_F(RegistryTest, InitOutOfPoolAborts) {
+    alloc_registry_t small;
+    alloc_registry_init(&small, pool.data(), alloc_registry_min_pool_size());
+    alloc_set_registry(&small);
+
+    alloc_list_t list;
+    ASSERT_DEATH(alloc_list_init(&list, storage, 4 * page), "");
+}
+
+TEST_F(RegistryTest, FreeWithoutSizeAborts) {
+    alloc_set_registry(&reg);
+
+    alloc_static_t heap;
+    alloc_static_init(&heap, storage, page);
+    void *ptr = alloc_static(&heap, 16);
+    ASSERT_DEATH(alloc_registry_free(&reg, ptr), "");
+    ASSERT_DEATH(alloc_registry_free(&reg, storage + 2 * page), "");
+}
+
+#ifndef NDEBUG
+TEST_F(RegistryTest, FreeIntoAnotherHeapAbortsInDebug) {
+    alloc_set_registry(&reg);
+
+    alloc_slab_t a;
+    alloc_slab_t b;
+    alloc_slab_init(&a, storage, 2 * page, 64);
+    alloc_slab_init(&b, storage + 2 * page, 2 * page, 64);
+
+    void *ptr = alloc_slab(&a);
+    ASSERT_DEATH(alloc_slab_free(&b, ptr), "");
+    alloc_slab_free(&a, ptr);
+}
+#endif
+
+TEST_F(RegistryTest, LookupsDuringChanges) {
+    constexpr size_t num_rounds = 200;
+    constexpr size_t num_heaps = 16;
+
+    // Removed regions are not given back to the pool. Each addition takes a
+    // descriptor and at most two cells, and the second page may need nodes.
+    const size_t big_pool_size =
+        alloc_registry_min_pool_size() +
+        2 * (size_t{1} << YTALLOC_REGISTRY_LEVEL_BITS) * sizeof(uintptr_t) +
+        (num_rounds * num_heaps + 1) *
+            (sizeof(alloc_region_t) + 4 * sizeof(void *));
+    pool.resize(big_pool_size / sizeof(uintptr_t) + 1);
+    alloc_registry_init(&reg, pool.data(), big_pool_size);
+
+    int stable;
+    ASSERT_TRUE(alloc_registry_add(&reg, ALLOC_KIND_SLAB, &stable, storage,
+                                   page));
+
+    std::atomic<bool> started = false;
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        // Wait for the reader, so that the changes do not all happen before
+        // its first lookup.
+        while (!started) {}
+        int heaps[num_heaps];
+        for (size_t round = 0; round < num_rounds; round++) {
+            for (size_t idx = 0; idx < num_heaps; idx++) {
+                ASSERT_TRUE(alloc_registry_add(&reg, ALLOC_KIND_LIST,
+                                               &heaps[idx],
+                                               storage + page + idx * 100,
+                                               100));
+            }
+            for (size_t idx = 0; idx < num_heaps; idx++) {
+                alloc_registry_remove(&reg, &heaps[idx]);
+            }
+        }
+        done = true;
+    });
+
+    size_t num_lookups = 0;
+    while (!done) {
+        const alloc_region_t *region =
+            alloc_registry_find(&reg, storage + page / 2);
+        ASSERT_NE(region, nullptr);
+        ASSERT_EQ(region->heap, &stable);
+
+        region = alloc_registry_find(&reg, storage + page + 50);
+        if (region) { ASSERT_EQ(region->kind, ALLOC_KIND_LIST); }
+        num_lookups++;
+        started = true;
+    }
+    writer.join();
+    EXPECT_GT(num_lookups, 0);
+}
+
+TEST_F(RegistryTest, ArenaDestroyForgetsItsChunks) {
+    alloc_set_registry(&reg);
+
+    alloc_page_source_t src;
+    alloc_page_source_mmap(&src);
+    alloc_arena_t arena;
+    alloc_arena_init(&arena, &src, 64 * 1024);
+    void *ptr = alloc_arena(&arena, 100);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_NE(alloc_registry_find(&reg, ptr), nullptr);
+
+    alloc_arena_destroy(&arena);
+    EXPECT_EQ(alloc_registry_find(&reg, ptr), nullptr);
+}
+
+#ifndef NDEBUG
+TEST_F(RegistryTest, FreeIntoNestedRegionInDebug) {
+    alloc_set_registry(&reg);
+
+    alloc_list_t outer;
+    alloc_slab_t inner;
+    alloc_list_init(&outer, storage, 8 * page);
+    void *const mem = alloc_list(&outer, 4 * page);
+    ASSERT_NE(mem, nullptr);
+    alloc_slab_init(&inner, mem, 2 * page, sizeof(uintptr_t));
+
+    void *const other = alloc_list(&outer, 100);
+    ASSERT_NE(other, nullptr);
+    ASSERT_DEATH(alloc_slab_free(&inner, other), "");
+
+    alloc_slab_free(&inner, alloc_slab(&inner));
+    alloc_list_free(&outer, other);
+    alloc_list_free(&outer, mem);
+}
+#endif
@@ -0,0 +1,230 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class RemoteTest : public testing::Test {
+  protected:
+    void TearDown() override {
+        if (storage) { ::operator delete[](storage, std::align_val_t(64)); }
+    }
+
+    void *make_storage(size_t size) {
+        storage = static_cast<uint8_t *>(
+            ::operator new[](size, std::align_val_t(64)));
+        return storage;
+    }
+
+    static constexpr size_t num_threads = 4;
+
+    uint8_t *storage = nullptr;
+};
+
+TEST_F(RemoteTest, SlabOwnerFreesLocally) {
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, make_storage(4096), 4096, 64);
+    alloc_slab_set_owner(&heap);
+
+    void *ptr = alloc_slab(&heap);
+    ASSERT_NE(ptr, nullptr);
+    alloc_slab_free_remote(&heap, ptr);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+    EXPECT_EQ(alloc_slab_drain_remote(&heap), 0);
+}
+
+TEST_F(RemoteTest, SlabRemoteFreeIsDrainedOnAlloc) {
+    constexpr size_t num_items = 32;
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, make_storage(num_items * 64), num_items * 64, 64);
+    alloc_slab_set_owner(&heap);
+
+    std::vector<void *> ptrs;
+    for (size_t idx = 0; idx < num_items; idx++) {
+        ptrs.push_back(alloc_slab(&heap));
+        ASSERT_NE(ptrs.back(), nullptr);
+    }
+    EXPECT_EQ(alloc_slab(&heap), nullptr);
+
+    std::thread([&] {
+        for (void *ptr : ptrs) {
+            alloc_slab_free_remote(&heap, ptr);
+        }
+    }).join();
+    EXPECT_EQ(alloc_slab_num_used(&heap), num_items);
+
+    std::set<void *> again;
+    for (size_t idx = 0; idx < num_items; idx++) {
+        void *ptr = alloc_slab(&heap);
+        ASSERT_NE(ptr, nullptr);
+        again.insert(ptr);
+    }
+    EXPECT_EQ(again, std::set<void *>(ptrs.begin(), ptrs.end()));
+    EXPECT_EQ(alloc_slab_num_used(&heap), num_items);
+}
+
+TEST_F(RemoteTest, SlabManyProducers) {
+    constexpr size_t num_items = 256;
+    constexpr size_t num_rounds = 50;
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, make_storage(num_items * 64), num_items * 64, 64);
+    alloc_slab_set_owner(&heap);
+
+    for (size_t round = 0; round < num_rounds; round++) {
+        std::vector<void *> ptrs(num_items);
+        ASSERT_EQ(alloc_slab_bulk(&heap, ptrs.data(), num_items), num_items);
+
+        std::vector<std::thread> threads;
+        for (size_t tidx = 0; tidx < num_threads; tidx++) {
+            threads.emplace_back([&, tidx] {
+                for (size_t idx = tidx; idx < num_items; idx += num_threads) {
+                    alloc_slab_free_remote(&heap, ptrs[idx]);
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(alloc_slab_drain_remote(&heap), num_items);
+        EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+    }
+}
+
+TEST_F(RemoteTest, SlabConcurrentAllocAndRemoteFree) {
+    constexpr size_t num_items = 128;
+    constexpr size_t num_allocs = 100000;
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, make_storage(num_items * 64), num_items * 64, 64);
+    alloc_slab_set_owner(&heap);
+
+    // The owner hands items to a consumer thread which frees them remotely.
+    std::vector<std::atomic<void *>> mailbox(num_items);
+    for (auto &slot : mailbox) {
+        slot.store(nullptr);
+    }
+    std::atomic<bool> done = false;
+
+    std::thread consumer([&] {
+        while (!done.load()) {
+            for (auto &slot : mailbox) {
+                void *ptr = slot.exchange(nullptr);
+                if (ptr) { alloc_slab_free_remote(&heap, ptr); }
+            }
+        }
+    });
+
+    size_t num_done = 0;
+    size_t slot_idx = 0;
+    while (num_done < num_allocs) {
+        void *ptr = alloc_slab(&heap);
+        if (!ptr) { continue; }
+        *static_cast<size_t *>(ptr) = num_done;
+        while (mailbox[slot_idx].load() != nullptr) {}
+        mailbox[slot_idx].store(ptr);
+        slot_idx = (slot_idx + 1) % num_items;
+        num_done++;
+    }
+
+    for (auto &slot : mailbox) {
+        while (slot.load() != nullptr) {}
+    }
+    done.store(true);
+    consumer.join();
+
+    alloc_slab_drain_remote(&heap);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+}
+
+TEST_F(RemoteTest, SlabLockedAllocDrainsRemoteFrees) {
+    constexpr size_t num_items = 32;
+    alloc_slab_t heap;
+    alloc_slab_init(&heap, make_storage(num_items * 64), num_items * 64, 64);
+    alloc_spinlock_t spin;
+    alloc_lock_t lock;
+    alloc_lock_spin(&lock, &spin);
+    alloc_slab_set_lock(&heap, &lock);
+    alloc_slab_set_owner(&heap);
+
+    std::vector<void *> ptrs(num_items);
+    ASSERT_EQ(alloc_slab_bulk_locked(&heap, ptrs.data(), num_items),
+              num_items);
+    EXPECT_EQ(alloc_slab_locked(&heap), nullptr);
+
+    std::thread([&] {
+        for (void *ptr : ptrs) {
+            alloc_slab_free_remote(&heap, ptr);
+        }
+    }).join();
+
+    std::set<void *> again;
+    void *const ptr = alloc_slab_locked(&heap);
+    ASSERT_NE(ptr, nullptr);
+    again.insert(ptr);
+
+    // Free half of the rest remotely again, so that the bulk allocation has to
+    // drain once more to get all of them.
+    std::vector<void *> rest(num_items - 1);
+    ASSERT_EQ(alloc_slab_bulk_locked(&heap, rest.data(), rest.size()),
+              rest.size());
+    std::thread([&] {
+        for (size_t idx = 0; idx < rest.size(); idx += 2) {
+            alloc_slab_free_remote(&heap, rest[idx]);
+        }
+    }).join();
+    std::vector<void *> last(num_items);
+    EXPECT_EQ(alloc_slab_bulk_locked(&heap, last.data(), num_items),
+              (rest.size() + 1) / 2);
+    again.insert(rest.begin(), rest.end());
+
+    EXPECT_EQ(again, std::set<void *>(ptrs.begin(), ptrs.end()));
+    EXPECT_EQ(alloc_slab_num_used(&heap), num_items);
+}
+
+TEST_F(RemoteTest, ListRemoteFreeIsDrainedOnAlloc) {
+    constexpr size_t heap_size = 64 * 1024;
+    alloc_list_t heap;
+    alloc_list_init(&heap, make_storage(heap_size), heap_size);
+    alloc_list_set_owner(&heap);
+
+    std::vector<void *> ptrs;
+    for (void *ptr; (ptr = alloc_list(&heap, 1000)) != nullptr;) {
+        ptrs.push_back(ptr);
+    }
+    ASSERT_FALSE(ptrs.empty());
+
+    std::vector<std::thread> threads;
+    for (size_t tidx = 0; tidx < num_threads; tidx++) {
+        threads.emplace_back([&, tidx] {
+            for (size_t idx = tidx; idx < ptrs.size(); idx += num_threads) {
+                alloc_list_free_remote(&heap, ptrs[idx]);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::set<void *> again;
+    for (size_t idx = 0; idx < ptrs.size(); idx++) {
+        void *ptr = alloc_list(&heap, 1000);
+        ASSERT_NE(ptr, nullptr);
+        again.insert(ptr);
+    }
+    EXPECT_EQ(again, std::set<void *>(ptrs.begin(), ptrs.end()));
+    EXPECT_EQ(alloc_list_drain_remote(&heap), 0);
+}
+
+TEST_F(RemoteTest, ListOwnerFreesLocally) {
+    constexpr size_t heap_size = 4096;
+    alloc_list_t heap;
+    alloc_list_init(&heap, make_storage(heap_size), heap_size);
+    alloc_list_set_owner(&heap);
+
+    void *ptr = alloc_list(&heap, 100);
+    ASSERT_NE(ptr, nullptr);
+    alloc_list_free_remote(&heap, ptr);
+    EXPECT_EQ(alloc_list_drain_remote(&heap), 0);
+    EXPECT_EQ(alloc_list(&heap, 100), ptr);
+}
@@ -0,0 +1,267 @@
+#include <deque>
+#include <gtest/gtest.h>
+#include <random>
+#include <ytalloc/ytalloc.h>
+
+#include "tests_common/DuplicatedWrite.h"
+
+class RingTest : public testing::Test {
+  protected:
+    void SetUp() {
+        storage = nullptr;
+    }
+
+    void TearDown() {
+        if (storage) {
+            operator delete[](storage, std::align_val_t(YTALLOC_RING_ALIGN));
+        }
+        for (DuplicatedWrite &write : writes) {
+            write.delete_copy();
+        }
+    }
+
+    void set_underlying_storage(size_t size) {
+        storage = new (std::align_val_t(YTALLOC_RING_ALIGN)) uint8_t[size];
+        this->size = size;
+    }
+
+    void init_with_size(size_t size) {
+        set_underlying_storage(size);
+        alloc_ring_init(&ring, storage, size);
+    }
+
+    void random_write(void *ptr, size_t num_bytes) {
+        auto write = DuplicatedWrite::random_write(rng, ptr, num_bytes);
+        writes.push_back(write);
+    }
+
+    void check_writes() {
+        size_t idx = 0;
+        for (const DuplicatedWrite &write : writes) {
+            EXPECT_TRUE(write.check_integrity())
+                << "write #" << idx << " (" << write.num_bytes
+                << " bytes) has been overwritten";
+            idx++;
+        }
+    }
+
+    std::minstd_rand rng;
+
+    alloc_ring_t ring;
+    uint8_t *storage;
+    size_t size;
+
+    std::vector<DuplicatedWrite> writes;
+};
+
+TEST_F(RingTest, InitNullRingAborts) {
+    set_underlying_storage(64);
+    ASSERT_DEATH(alloc_ring_init(NULL, storage, size), "");
+}
+
+TEST_F(RingTest, InitNullStartAborts) {
+    set_underlying_storage(64);
+    ASSERT_DEATH(alloc_ring_init(&ring, NULL, size), "");
+}
+
+TEST_F(RingTest, InitMisalignedStartAborts) {
+    set_underlying_storage(64);
+    ASSERT_DEATH(alloc_ring_init(&ring, storage + 1, size - 1), "");
+}
+
+TEST_F(RingTest, InitTooSmallAborts) {
+    set_underlying_storage(64);
+    ASSERT_DEATH(alloc_ring_init(&ring, storage, YTALLOC_RING_ALIGN), "");
+}
+
+TEST_F(RingTest, AllocZeroSize) {
+    init_with_size(64);
+    EXPECT_EQ(alloc_ring(&ring, 0), nullptr);
+}
+
+TEST_F(RingTest, AllocTooLarge) {
+    init_with_size(4 * YTALLOC_RING_ALIGN);
+    EXPECT_EQ(alloc_ring(&ring, 3 * YTALLOC_RING_ALIGN + 1), nullptr);
+    EXPECT_NE(alloc_ring(&ring, 3 * YTALLOC_RING_ALIGN), nullptr);
+}
+
+TEST_F(RingTest, AllocIsAlignedAndAccounted) {
+    init_with_size(1024);
+
+    void *const ptr1 = alloc_ring(&ring, 1);
+    void *const ptr2 = alloc_ring(&ring, YTALLOC_RING_ALIGN + 1);
+    ASSERT_NE(ptr1, nullptr);
+    ASSERT_NE(ptr2, nullptr);
+    EXPECT_EQ((uintptr_t)ptr1 % YTALLOC_RING_ALIGN, 0);
+    EXPECT_EQ((uintptr_t)ptr2 % YTALLOC_RING_ALIGN, 0);
+    EXPECT_EQ((uint8_t *)ptr2 - (uint8_t *)ptr1, 2 * YTALLOC_RING_ALIGN);
+
+    EXPECT_EQ(alloc_ring_num_live(&ring), 2);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 5 * YTALLOC_RING_ALIGN);
+}
+
+TEST_F(RingTest, AllocUntilFull) {
+    constexpr size_t num_items = 8;
+    init_with_size(num_items * 2 * YTALLOC_RING_ALIGN);
+
+    for (size_t idx = 0; idx < num_items; idx++) {
+        void *const ptr = alloc_ring(&ring, YTALLOC_RING_ALIGN);
+        ASSERT_NE(ptr, nullptr);
+        random_write(ptr, YTALLOC_RING_ALIGN);
+    }
+    EXPECT_EQ(alloc_ring(&ring, 1), nullptr);
+    EXPECT_EQ(alloc_ring_num_used(&ring), size);
+    check_writes();
+}
+
+TEST_F(RingTest, FreeNullIsNoop) {
+    init_with_size(64);
+    alloc_ring_free(&ring, NULL);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 0);
+}
+
+TEST_F(RingTest, FreeOutsideAborts) {
+    init_with_size(64);
+    ASSERT_DEATH(alloc_ring_free(&ring, storage + size + 16), "");
+}
+
+TEST_F(RingTest, DoubleFreeAborts) {
+    init_with_size(256);
+    void *const ptr1 = alloc_ring(&ring, 16);
+    void *const ptr2 = alloc_ring(&ring, 16);
+    ASSERT_NE(ptr2, nullptr);
+    alloc_ring_free(&ring, ptr2);
+    ASSERT_DEATH(alloc_ring_free(&ring, ptr2), "");
+    alloc_ring_free(&ring, ptr1);
+}
+
+TEST_F(RingTest, InOrderFreeAdvancesTail) {
+    init_with_size(1024);
+
+    void *const ptr1 = alloc_ring(&ring, 32);
+    void *const ptr2 = alloc_ring(&ring, 32);
+    const size_t used = alloc_ring_num_used(&ring);
+
+    alloc_ring_free(&ring, ptr1);
+    EXPECT_EQ(alloc_ring_num_used(&ring), used / 2);
+    alloc_ring_free(&ring, ptr2);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 0);
+    EXPECT_EQ(alloc_ring_num_live(&ring), 0);
+}
+
+TEST_F(RingTest, EmptyRingRestartsAtStart) {
+    init_with_size(1024);
+
+    void *const ptr1 = alloc_ring(&ring, 32);
+    alloc_ring_free(&ring, alloc_ring(&ring, 32));
+    alloc_ring_free(&ring, ptr1);
+
+    EXPECT_EQ(alloc_ring(&ring, 32), ptr1);
+}
+
+TEST_F(RingTest, OutOfOrderFreeIsReclaimedAtTail) {
+    init_with_size(1024);
+
+    void *const ptr1 = alloc_ring(&ring, 32);
+    void *const ptr2 = alloc_ring(&ring, 32);
+    void *const ptr3 = alloc_ring(&ring, 32);
+    const size_t chunk = alloc_ring_num_used(&ring) / 3;
+
+    alloc_ring_free(&ring, ptr2);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 3 * chunk);
+    EXPECT_EQ(alloc_ring_num_live(&ring), 2);
+
+    alloc_ring_free(&ring, ptr1);
+    EXPECT_EQ(alloc_ring_num_used(&ring), chunk);
+
+    alloc_ring_free(&ring, ptr3);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 0);
+}
+
+TEST_F(RingTest, WrapsAroundWithPadding) {
+    constexpr size_t chunk = 4 * YTALLOC_RING_ALIGN;
+    init_with_size(5 * chunk);
+
+    void *ptrs[4];
+    for (void *&ptr : ptrs) {
+        ptr = alloc_ring(&ring, chunk - YTALLOC_RING_ALIGN);
+        ASSERT_NE(ptr, nullptr);
+    }
+    alloc_ring_free(&ring, ptrs[0]);
+    alloc_ring_free(&ring, ptrs[1]);
+
+    // Two chunks do not fit before the end, so the allocation wraps to the
+    // start and the tail of the buffer becomes padding.
+    void *const wrapped = alloc_ring(&ring, 2 * chunk - YTALLOC_RING_ALIGN);
+    ASSERT_EQ(wrapped, (uint8_t *)storage + YTALLOC_RING_ALIGN);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 5 * chunk);
+    EXPECT_EQ(alloc_ring(&ring, 1), nullptr);
+
+    // Reclaiming the last chunk also reclaims the padding after it.
+    alloc_ring_free(&ring, ptrs[2]);
+    alloc_ring_free(&ring, ptrs[3]);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 2 * chunk);
+
+    alloc_ring_free(&ring, wrapped);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 0);
+}
+
+TEST_F(RingTest, StreamingWithRandomLateFrees) {
+    struct Item {
+        uint8_t *ptr;
+        size_t num_bytes;
+        uint8_t tag;
+    };
+
+    constexpr size_t num_rounds = 20000;
+    init_with_size(16384);
+
+    std::deque<Item> queue;
+    std::vector<Item> late;
+    std::uniform_int_distribution<size_t> size_dist(1, 300);
+    std::uniform_int_distribution<int> late_dist(0, 15);
+
+    auto free_item = [&](const Item &item) {
+        for (size_t idx = 0; idx < item.num_bytes; idx++) {
+            ASSERT_EQ(item.ptr[idx], item.tag) << "item has been overwritten";
+        }
+        alloc_ring_free(&ring, item.ptr);
+    };
+
+    for (size_t round = 0; round < num_rounds; round++) {
+        const size_t num_bytes = size_dist(rng);
+        void *ptr = alloc_ring(&ring, num_bytes);
+        while (!ptr) {
+            ASSERT_FALSE(queue.empty() && late.empty());
+            if (!queue.empty()) {
+                const Item item = queue.front();
+                queue.pop_front();
+                if (late_dist(rng) == 0) {
+                    late.push_back(item);
+                } else {
+                    free_item(item);
+                }
+            } else {
+                free_item(late.back());
+                late.pop_back();
+            }
+            ptr = alloc_ring(&ring, num_bytes);
+        }
+        ASSERT_EQ((uintptr_t)ptr % YTALLOC_RING_ALIGN, 0);
+        ASSERT_GE((uint8_t *)ptr, storage);
+        ASSERT_LE((uint8_t *)ptr + num_bytes, storage + size);
+
+        const Item item = {(uint8_t *)ptr, num_bytes, (uint8_t)round};
+        memset(item.ptr, item.tag, num_bytes);
+        queue.push_back(item);
+    }
+
+    for (const Item &item : late) {
+        free_item(item);
+    }
+    for (const Item &item : queue) {
+        free_item(item);
+    }
+    EXPECT_EQ(alloc_ring_num_live(&ring), 0);
+    EXPECT_EQ(alloc_ring_num_used(&ring), 0);
+}
@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <ytalloc/ytalloc.h>
+
+#include "tests_common/DuplicatedWrite.h"
+
+class SlabBitmapTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        storage = nullptr;
+        bitmap = nullptr;
+    }
+
+    void TearDown() override {
+        if (storage) { delete[] storage; }
+        if (bitmap) { delete[] bitmap; }
+        for (DuplicatedWrite &write : writes) {
+            write.delete_copy();
+        }
+    }
+
+    void set_underlying_storage(size_t size, size_t alloc_size) {
+        storage = new uint8_t[size];
+        this->size = size;
+
+        const size_t num_words = (size / alloc_size + 63) / 64;
+        bitmap = new uint64_t[num_words];
+        bitmap_size = num_words * sizeof(uint64_t);
+    }
+
+    void init_with_size(size_t size, size_t alloc_size) {
+        set_underlying_storage(size, alloc_size);
+        alloc_slab_bitmap_init(&heap, storage, size, alloc_size, bitmap,
+                               bitmap_size);
+    }
+
+    void random_write(void *ptr, size_t num_bytes) {
+        auto write = DuplicatedWrite::random_write(rng, ptr, num_bytes);
+        writes.push_back(write);
+    }
+
+    void check_writes() {
+        size_t idx = 0;
+        for (const DuplicatedWrite &write : writes) {
+            EXPECT_TRUE(write.check_integrity())
+                << "write #" << idx << " (" << write.num_bytes
+                << " bytes) has been overwritten";
+        }
+    }
+
+    alloc_slab_bitmap_t heap;
+    uint8_t *storage;
+    size_t size;
+
+    uint64_t *bitmap;
+    size_t bitmap_size;
+
+    std::minstd_rand rng;
+    std::vector<DuplicatedWrite> writes;
+};
+
+TEST_F(SlabBitmapTest, InitWithNullHeapAborts) {
+    set_underlying_storage(64, 1);
+    ASSERT_DEATH(
+        alloc_slab_bitmap_init(NULL, storage, size, 1, bitmap, bitmap_size),
+        "");
+}
+
+TEST_F(SlabBitmapTest, InitWithNullBitmapAborts) {
+    set_underlying_storage(64, 1);
+    ASSERT_DEATH(
+        alloc_slab_bitmap_init(&heap, storage, size, 1, NULL, bitmap_size),
+        "");
+}
+
+TEST_F(SlabBitmapTest, InitWithSmallBitmapAborts) {
+    set_underlying_storage(65, 1);
+    ASSERT_DEATH(alloc_slab_bitmap_init(&heap, storage, size, 1, bitmap,
+                                        sizeof(uint64_t)),
+                 "");
+}
+
+TEST_F(SlabBitmapTest, InitWithZeroAllocSizeAborts) {
+    set_underlying_storage(64, 1);
+    ASSERT_DEATH(
+        alloc_slab_bitmap_init(&heap, storage, size, 0, bitmap, bitmap_size),
+        "");
+}
+
+TEST_F(SlabBitmapTest, OneByteItemsUntilFull) {
+    constexpr size_t num_items = 200;
+    init_with_size(num_items, 1);
+    EXPECT_EQ(alloc_slab_bitmap_num_items(&heap), num_items);
+
+    for (size_t idx = 0; idx < num_items; idx++) {
+        void *const ptr = alloc_slab_bitmap(&heap);
+        ASSERT_EQ(ptr, storage + idx);
+        random_write(ptr, 1);
+    }
+    EXPECT_EQ(alloc_slab_bitmap(&heap), nullptr);
+    EXPECT_EQ(alloc_slab_bitmap_num_used(&heap), num_items);
+    EXPECT_EQ(alloc_slab_bitmap_num_free(&heap), 0);
+    check_writes();
+}
+
+TEST_F(SlabBitmapTest, UnalignedSize) {
+    constexpr size_t alloc_size = 4;
+    constexpr size_t num_items = 70;
+    init_with_size(num_items * alloc_size + 3, alloc_size);
+    EXPECT_EQ(alloc_slab_bitmap_num_items(&heap), num_items);
+
+    for (size_t idx = 0; idx < num_items; idx++) {
+        ASSERT_NE(alloc_slab_bitmap(&heap), nullptr);
+    }
+    EXPECT_EQ(alloc_slab_bitmap(&heap), nullptr);
+}
+
+TEST_F(SlabBitmapTest, FreeReusesLowestItem) {
+    constexpr size_t alloc_size = 2;
+    constexpr size_t num_items = 300;
+    init_with_size(num_items * alloc_size, alloc_size);
+
+    std::vector<void *> ptrs;
+    for (size_t idx = 0; idx < num_items; idx++) {
+        ptrs.push_back(alloc_slab_bitmap(&heap));
+    }
+
+    alloc_slab_bitmap_free(&heap, ptrs[250]);
+    alloc_slab_bitmap_free(&heap, ptrs[7]);
+    alloc_slab_bitmap_free(&heap, ptrs[130]);
+    EXPECT_EQ(alloc_slab_bitmap_num_free(&heap), 3);
+    EXPECT_FALSE(alloc_slab_bitmap_is_used(&heap, ptrs[130]));
+    EXPECT_TRUE(alloc_slab_bitmap_is_used(&heap, ptrs[131]));
+
+    EXPECT_EQ(alloc_slab_bitmap(&heap), ptrs[7]);
+    EXPECT_EQ(alloc_slab_bitmap(&heap), ptrs[130]);
+    EXPECT_EQ(alloc_slab_bitmap(&heap), ptrs[250]);
+    EXPECT_EQ(alloc_slab_bitmap(&heap), nullptr);
+}
+
+TEST_F(SlabBitmapTest, NonPowerOfTwoItems) {
+    constexpr size_t alloc_size = 3;
+    constexpr size_t num_items = 100;
+    init_with_size(num_items * alloc_size, alloc_size);
+
+    void *const ptr1 = alloc_slab_bitmap(&heap);
+    void *const ptr2 = alloc_slab_bitmap(&heap);
+    EXPECT_EQ(ptr2, storage + alloc_size);
+    random_write(ptr1, alloc_size);
+    random_write(ptr2, alloc_size);
+
+    alloc_slab_bitmap_free(&heap, ptr2);
+    EXPECT_EQ(alloc_slab_bitmap(&heap), ptr2);
+    check_writes();
+}
+
+TEST_F(SlabBitmapTest, RandomAllocFree) {
+    constexpr size_t alloc_size = 1;
+    constexpr size_t num_items = 1000;
+    init_with_size(num_items * alloc_size, alloc_size);
+
+    std::set<void *> used;
+    for (size_t round = 0; round < 10000; round++) {
+        if (rng() % 2 == 0 || used.empty()) {
+            void *const ptr = alloc_slab_bitmap(&heap);
+            if (used.size() == num_items) {
+                ASSERT_EQ(ptr, nullptr);
+            } else {
+                ASSERT_NE(ptr, nullptr);
+                ASSERT_TRUE(used.insert(ptr).second);
+            }
+        } else {
+            auto it = used.begin();
+            std::advance(it, rng() % used.size());
+            alloc_slab_bitmap_free(&heap, *it);
+            used.erase(it);
+        }
+        ASSERT_EQ(alloc_slab_bitmap_num_used(&heap), used.size());
+    }
+}
+
+TEST_F(SlabBitmapTest, FreeNull) {
+    init_with_size(64, 1);
+    alloc_slab_bitmap_free(&heap, NULL);
+    EXPECT_EQ(alloc_slab_bitmap_num_used(&heap), 0);
+}
+
+TEST_F(SlabBitmapTest, DoubleFreeAborts) {
+    init_with_size(64, 1);
+    void *const ptr = alloc_slab_bitmap(&heap);
+    alloc_slab_bitmap_free(&heap, ptr);
+    ASSERT_DEATH(alloc_slab_bitmap_free(&heap, ptr), "");
+}
+
+TEST_F(SlabBitmapTest, FreeOutsideHeapAborts) {
+    init_with_size(64, 1);
+    ASSERT_DEATH(alloc_slab_bitmap_free(&heap, storage + 64), "");
+}
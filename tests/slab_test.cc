@@ -1,3 +1,4 @@
+#include <cstring>
 #include <gtest/gtest.h>
 #include <random>
 #include <ytalloc/ytalloc.h>
@@ -208,6 +209,13 @@ TEST_F(SlabHeapTest, FreeItemsArePointers) {
     // There was a bug where alloc_size was replaced with sizeof(uintptr_t).
     static_assert(alloc_size != sizeof(uintptr_t));
 
+    // Freeing in reverse leaves the free list in address order.
+    void *ptrs[num_items];
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, num_items), num_items);
+    for (size_t idx = num_items; idx-- > 0;) {
+        alloc_slab_free(&heap, ptrs[idx]);
+    }
+
     for (size_t idx = 0; idx < num_items; idx++) {
         const uintptr_t item_addr = heap.start + alloc_size * idx;
         const uintptr_t next_item_addr = heap.start + alloc_size * (idx + 1);
@@ -232,14 +240,359 @@ TEST_F(SlabHeapTest, UnalignedSize) {
 
     // Also check the items, just in case.
     for (size_t idx = 0; idx < heap.num_items; idx++) {
+        ASSERT_EQ(alloc_slab(&heap), storage + alloc_size * idx);
+    }
+    ASSERT_EQ(alloc_slab(&heap), nullptr);
+}
+
+TEST_F(SlabHeapTest, BulkAllocPartial) {
+    constexpr size_t num_items = 8;
+    constexpr size_t alloc_size = 16;
+    init_with_size(num_items * alloc_size, alloc_size);
+
+    void *ptrs[num_items + 4] = {};
+    const size_t num_got = alloc_slab_bulk(&heap, ptrs, num_items + 4);
+    ASSERT_EQ(num_got, num_items);
+    EXPECT_EQ(alloc_slab_num_used(&heap), num_items);
+    EXPECT_EQ(alloc_slab_num_free(&heap), 0);
+    EXPECT_EQ(alloc_slab(&heap), nullptr);
+
+    for (size_t idx = 0; idx < num_got; idx++) {
+        ASSERT_NE(ptrs[idx], nullptr);
+        random_write(ptrs[idx], alloc_size);
+    }
+    check_writes();
+}
+
+TEST_F(SlabHeapTest, BulkAllocMatchesSingleAlloc) {
+    constexpr size_t num_items = 16;
+    constexpr size_t alloc_size = 32;
+    init_with_size(num_items * alloc_size, alloc_size);
+
+    void *first = alloc_slab(&heap);
+    void *ptrs[4] = {};
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, 4), 4);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 5);
+
+    for (size_t idx = 0; idx < 4; idx++) {
+        const uintptr_t expected =
+            reinterpret_cast<uintptr_t>(first) + alloc_size * (idx + 1);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptrs[idx]), expected);
+    }
+}
+
+TEST_F(SlabHeapTest, BulkFreeThenAlloc) {
+    constexpr size_t num_items = 8;
+    constexpr size_t alloc_size = 16;
+    init_with_size(num_items * alloc_size, alloc_size);
+
+    void *ptrs[num_items] = {};
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, num_items), num_items);
+
+    alloc_slab_free_bulk(&heap, ptrs, 5);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 3);
+    EXPECT_EQ(alloc_slab_num_free(&heap), 5);
+
+    // The freed chain is reused in the same order.
+    for (size_t idx = 0; idx < 5; idx++) {
+        EXPECT_EQ(alloc_slab(&heap), ptrs[idx]);
+    }
+    EXPECT_EQ(alloc_slab(&heap), nullptr);
+
+    alloc_slab_free_bulk(&heap, ptrs, num_items);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+    EXPECT_EQ(alloc_slab_bulk(&heap, ptrs, num_items), num_items);
+}
+
+TEST_F(SlabHeapTest, BulkFreeZeroItems) {
+    init_with_size(32, 8);
+    alloc_slab_free_bulk(&heap, nullptr, 0);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 0);
+}
+
+TEST_F(SlabHeapTest, BulkFreeTooManyAborts) {
+    init_with_size(32, 8);
+    void *ptrs[2] = {};
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, 1), 1);
+    ptrs[1] = ptrs[0];
+    ASSERT_DEATH(alloc_slab_free_bulk(&heap, ptrs, 2), "");
+}
+
+namespace {
+
+struct CachedObject {
+    uintptr_t link;
+    uint32_t state;
+    uint32_t ctor_cnt;
+};
+
+struct CtorCounts {
+    size_t num_ctors = 0;
+    size_t num_dtors = 0;
+};
+
+void cached_object_ctor(void *obj, void *arg) {
+    CachedObject *const cached = static_cast<CachedObject *>(obj);
+    cached->state = 0xC0FFEE;
+    cached->ctor_cnt++;
+    static_cast<CtorCounts *>(arg)->num_ctors++;
+}
+
+void cached_object_dtor(void *obj, void *arg) {
+    CachedObject *const cached = static_cast<CachedObject *>(obj);
+    EXPECT_EQ(cached->state, 0xC0FFEE);
+    cached->state = 0;
+    static_cast<CtorCounts *>(arg)->num_dtors++;
+}
+
+} // namespace
+
+TEST_F(SlabHeapTest, InitWithBadLinkOffsetAborts) {
+    set_underlying_storage(64, 16);
+    alloc_slab_opts_t opts = {};
+    opts.link_offset = 12;
+    ASSERT_DEATH(alloc_slab_init_opts(&heap, storage, size, 16, &opts), "");
+    opts.link_offset = 16;
+    ASSERT_DEATH(alloc_slab_init_opts(&heap, storage, size, 16, &opts), "");
+}
+
+TEST_F(SlabHeapTest, LinkOffset) {
+    constexpr size_t num_items = 4;
+    constexpr size_t alloc_size = 32;
+    set_underlying_storage(num_items * alloc_size, alloc_size);
+
+    alloc_slab_opts_t opts = {};
+    opts.link_offset = 24;
+    alloc_slab_init_opts(&heap, storage, size, alloc_size, &opts);
+
+    void *ptrs[num_items];
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, num_items), num_items);
+    for (size_t idx = num_items; idx-- > 0;) {
+        alloc_slab_free(&heap, ptrs[idx]);
+    }
+
+    for (size_t idx = 0; idx + 1 < num_items; idx++) {
         const uintptr_t item_addr = heap.start + alloc_size * idx;
-        const uintptr_t next_item_addr = heap.start + alloc_size * (idx + 1);
-        const uintptr_t item_val = *(uintptr_t *)item_addr;
+        const uintptr_t link = *(uintptr_t *)(item_addr + opts.link_offset);
+        EXPECT_EQ(link, item_addr + alloc_size);
+    }
 
-        if (idx == heap.num_items - 1) {
-            ASSERT_EQ(item_val, 0);
-        } else {
-            ASSERT_EQ(item_val, next_item_addr);
+    void *const ptr1 = alloc_slab(&heap);
+    void *const ptr2 = alloc_slab(&heap);
+    EXPECT_EQ(ptr1, storage);
+    EXPECT_EQ(ptr2, storage + alloc_size);
+
+    // The first 24 bytes of a free item are not touched by the heap.
+    random_write(ptr1, opts.link_offset);
+    alloc_slab_free(&heap, ptr1);
+    check_writes();
+    EXPECT_EQ(alloc_slab(&heap), ptr1);
+}
+
+TEST_F(SlabHeapTest, CtorCalledOncePerItem) {
+    constexpr size_t num_items = 8;
+    constexpr size_t alloc_size = sizeof(CachedObject);
+    set_underlying_storage(num_items * alloc_size, alloc_size);
+
+    CtorCounts counts;
+    alloc_slab_opts_t opts = {};
+    opts.link_offset = offsetof(CachedObject, link);
+    opts.ctor = cached_object_ctor;
+    opts.dtor = cached_object_dtor;
+    opts.ctor_arg = &counts;
+    memset(storage, 0, size);
+    alloc_slab_init_opts(&heap, storage, size, alloc_size, &opts);
+    EXPECT_EQ(counts.num_ctors, 0);
+
+    CachedObject *const obj1 = static_cast<CachedObject *>(alloc_slab(&heap));
+    CachedObject *const obj2 = static_cast<CachedObject *>(alloc_slab(&heap));
+    EXPECT_EQ(counts.num_ctors, 2);
+    EXPECT_EQ(obj1->state, 0xC0FFEE);
+    EXPECT_EQ(obj2->state, 0xC0FFEE);
+
+    // Freed objects stay constructed and are not constructed again.
+    alloc_slab_free(&heap, obj1);
+    alloc_slab_free(&heap, obj2);
+    for (size_t round = 0; round < 3; round++) {
+        void *ptrs[2] = {};
+        ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, 2), 2);
+        for (void *ptr : ptrs) {
+            CachedObject *const obj = static_cast<CachedObject *>(ptr);
+            EXPECT_EQ(obj->state, 0xC0FFEE);
+            EXPECT_EQ(obj->ctor_cnt, 1);
+        }
+        alloc_slab_free_bulk(&heap, ptrs, 2);
+    }
+    EXPECT_EQ(counts.num_ctors, 2);
+
+    // Brand-new items are constructed on their first allocation.
+    void *ptrs[num_items] = {};
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, num_items), num_items);
+    EXPECT_EQ(counts.num_ctors, num_items);
+    for (void *ptr : ptrs) {
+        EXPECT_EQ(static_cast<CachedObject *>(ptr)->ctor_cnt, 1);
+    }
+    alloc_slab_free_bulk(&heap, ptrs, num_items);
+
+    EXPECT_EQ(counts.num_dtors, 0);
+    alloc_slab_reclaim(&heap);
+    EXPECT_EQ(counts.num_dtors, num_items);
+
+    // After reclaiming, items are constructed again.
+    ASSERT_NE(alloc_slab(&heap), nullptr);
+    EXPECT_EQ(counts.num_ctors, num_items + 1);
+}
+
+TEST_F(SlabHeapTest, ReclaimDestroysOnlyConstructedItems) {
+    constexpr size_t num_items = 8;
+    constexpr size_t alloc_size = sizeof(CachedObject);
+    set_underlying_storage(num_items * alloc_size, alloc_size);
+
+    CtorCounts counts;
+    alloc_slab_opts_t opts = {};
+    opts.ctor = cached_object_ctor;
+    opts.dtor = cached_object_dtor;
+    opts.ctor_arg = &counts;
+    alloc_slab_init_opts(&heap, storage, size, alloc_size, &opts);
+
+    void *const ptr1 = alloc_slab(&heap);
+    void *const ptr2 = alloc_slab(&heap);
+    alloc_slab_free(&heap, ptr1);
+    alloc_slab_free(&heap, ptr2);
+
+    alloc_slab_reclaim(&heap);
+    EXPECT_EQ(counts.num_ctors, 2);
+    EXPECT_EQ(counts.num_dtors, 2);
+    EXPECT_EQ(alloc_slab_num_free(&heap), num_items);
+}
+
+TEST_F(SlabHeapTest, ReclaimWithUsedItemsAborts) {
+    init_with_size(32, 8);
+    ASSERT_NE(alloc_slab(&heap), nullptr);
+    ASSERT_DEATH(alloc_slab_reclaim(&heap), "");
+}
+
+TEST_F(SlabHeapTest, ColouringRotatesFirstItemOffset) {
+    constexpr size_t alloc_size = 256;
+    constexpr size_t num_items = 6;
+    constexpr size_t slack = 2 * YTALLOC_SLAB_COLOUR_ALIGN;
+    constexpr size_t heap_size = num_items * alloc_size + slack;
+    set_underlying_storage(heap_size, alloc_size);
+
+    size_t cursor = 0;
+    alloc_slab_opts_t opts = {};
+    opts.colour_cursor = &cursor;
+
+    for (size_t round = 0; round < 6; round++) {
+        alloc_slab_init_opts(&heap, storage, size, alloc_size, &opts);
+        const size_t expected_off = (round % 3) * YTALLOC_SLAB_COLOUR_ALIGN;
+
+        EXPECT_EQ(alloc_slab_num_items(&heap), num_items);
+        void *ptrs[num_items] = {};
+        ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, num_items), num_items);
+        for (size_t idx = 0; idx < num_items; idx++) {
+            const uintptr_t expected =
+                heap.start + expected_off + alloc_size * idx;
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(ptrs[idx]), expected);
+            EXPECT_LE(expected + alloc_size, heap.end);
         }
+        EXPECT_EQ(alloc_slab(&heap), nullptr);
+    }
+}
+
+TEST_F(SlabHeapTest, ColouringWithoutSlack) {
+    constexpr size_t alloc_size = 64;
+    init_with_size(8 * alloc_size, alloc_size);
+
+    size_t cursor = 5;
+    alloc_slab_opts_t opts = {};
+    opts.colour_cursor = &cursor;
+    alloc_slab_init_opts(&heap, storage, size, alloc_size, &opts);
+
+    EXPECT_EQ(alloc_slab(&heap), storage);
+    EXPECT_EQ(alloc_slab_num_items(&heap), 8);
+}
+
+TEST_F(SlabHeapTest, AtLeastReturnsItemSize) {
+    init_with_size(16 * 64, 64);
+
+    size_t usable = 0;
+    void *const ptr = alloc_slab_at_least(&heap, 20, &usable);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(usable, 64);
+    EXPECT_EQ(alloc_slab_usable_size(&heap, ptr), 64);
+
+    usable = 0;
+    EXPECT_EQ(alloc_slab_at_least(&heap, 65, &usable), nullptr);
+    EXPECT_EQ(usable, 0);
+    EXPECT_EQ(alloc_slab_num_used(&heap), 1);
+}
+
+TEST_F(SlabHeapTest, InitAndAllocLeaveLaterItemsUntouched) {
+    set_underlying_storage(8 * 64, 64);
+    std::memset(storage, 0xaa, size);
+    alloc_slab_init(&heap, storage, size, 64);
+
+    void *ptrs[2];
+    ASSERT_NE(alloc_slab(&heap), nullptr);
+    ASSERT_EQ(alloc_slab_bulk(&heap, ptrs, 2), 2);
+    for (size_t idx = 0; idx < size; idx++) {
+        ASSERT_EQ(storage[idx], 0xaa) << idx;
+    }
+
+    // Freed items go before the never allocated ones.
+    alloc_slab_free(&heap, ptrs[0]);
+    EXPECT_EQ(alloc_slab(&heap), ptrs[0]);
+    EXPECT_EQ(alloc_slab(&heap), storage + 3 * 64);
+}
+
+TEST_F(SlabHeapTest, CallocClearsReusedItems) {
+    set_underlying_storage(4 * 64, 64);
+    std::memset(storage, 0xaa, size);
+    alloc_slab_init(&heap, storage, size, 64);
+
+    uint8_t *const ptr = static_cast<uint8_t *>(alloc_slab_calloc(&heap));
+    ASSERT_NE(ptr, nullptr);
+    for (size_t idx = 0; idx < 64; idx++) {
+        ASSERT_EQ(ptr[idx], 0) << idx;
+    }
+
+    std::memset(ptr, 0xbb, 64);
+    alloc_slab_free(&heap, ptr);
+    ASSERT_EQ(alloc_slab_calloc(&heap), ptr);
+    for (size_t idx = 0; idx < 64; idx++) {
+        ASSERT_EQ(ptr[idx], 0) << idx;
+    }
+}
+
+TEST_F(SlabHeapTest, CallocSkipsNeverAllocatedItems) {
+    set_underlying_storage(4 * 64, 64);
+    std::memset(storage, 0, size);
+    alloc_slab_init(&heap, storage, size, 64);
+    alloc_slab_set_zeroed(&heap);
+
+    uint8_t *const first = static_cast<uint8_t *>(alloc_slab(&heap));
+    std::memset(first, 0xaa, 64);
+    alloc_slab_free(&heap, first);
+
+    // Break the promise in the untouched items to see what gets cleared.
+    std::memset(storage + 64, 0xcc, size - 64);
+    uint8_t *ptrs[4];
+    for (uint8_t *&ptr : ptrs) {
+        ptr = static_cast<uint8_t *>(alloc_slab_calloc(&heap));
+        ASSERT_NE(ptr, nullptr);
+    }
+    for (uint8_t *ptr : ptrs) {
+        const uint8_t expected = ptr == first ? 0 : 0xcc;
+        EXPECT_EQ(ptr[0], expected);
+        EXPECT_EQ(ptr[63], expected);
+    }
+
+    // Reclaiming makes every handed out item dirty again.
+    alloc_slab_free_bulk(&heap, reinterpret_cast<void **>(ptrs), 4);
+    alloc_slab_reclaim(&heap);
+    for (size_t idx = 0; idx < 4; idx++) {
+        uint8_t *const ptr = static_cast<uint8_t *>(alloc_slab_calloc(&heap));
+        EXPECT_EQ(ptr[63], 0);
     }
 }
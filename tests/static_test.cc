@@ -1,5 +1,7 @@
+#include <cstring>
 #include <gtest/gtest.h>
 #include <random>
+#include <thread>
 #include <ytalloc/ytalloc.h>
 
 #include "tests_common/DuplicatedWrite.h"
@@ -143,3 +145,411 @@ TEST_F(StaticTest, AllocReturnsAlignedPointers) {
     EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr1) % expected_alignment, 0);
     EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr2) % expected_alignment, 0);
 }
+
+TEST_F(StaticTest, AllocDoesNotPadTheEnd) {
+    init_with_size(2 * YTALLOC_STATIC_ALIGN);
+
+    void *const ptr1 = alloc_static(&alloc, 1);
+    ASSERT_EQ(ptr1, storage);
+    EXPECT_EQ(alloc.next, alloc.start + 1);
+
+    void *const ptr2 = alloc_static(&alloc, YTALLOC_STATIC_ALIGN);
+    EXPECT_EQ(ptr2, storage + YTALLOC_STATIC_ALIGN);
+}
+
+TEST_F(StaticTest, AllocAlignedMixed) {
+    set_underlying_storage(4096);
+    alloc_static_init(&alloc, storage, size);
+
+    // The storage is only guaranteed to be aligned at YTALLOC_STATIC_ALIGN.
+    const uintptr_t start = reinterpret_cast<uintptr_t>(storage);
+    const size_t expected_waste = (64 - start % 64) % 64;
+
+    void *const ptr1 = alloc_static_aligned(&alloc, 1, 1);
+    ASSERT_EQ(ptr1, storage);
+    void *const ptr2 = alloc_static_aligned(&alloc, 8, 64);
+    ASSERT_NE(ptr2, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr2) % 64, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr2) - start,
+              expected_waste != 0 ? expected_waste : 64);
+    void *const ptr3 = alloc_static_aligned(&alloc, 2, 2);
+    EXPECT_EQ(ptr3, static_cast<uint8_t *>(ptr2) + 8);
+
+    random_write(ptr1, 1);
+    random_write(ptr2, 8);
+    random_write(ptr3, 2);
+    check_writes();
+}
+
+TEST_F(StaticTest, AllocPageAligned) {
+    constexpr size_t page_size = 4096;
+    storage = new (std::align_val_t(YTALLOC_STATIC_ALIGN))
+        uint8_t[3 * page_size];
+    alloc_static_init(&alloc, storage, 3 * page_size);
+
+    ASSERT_NE(alloc_static(&alloc, 1), nullptr);
+    void *const page = alloc_static_aligned(&alloc, page_size, page_size);
+    ASSERT_NE(page, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(page) % page_size, 0);
+    random_write(page, page_size);
+    check_writes();
+
+    EXPECT_EQ(alloc_static_aligned(&alloc, 2 * page_size, page_size), nullptr);
+}
+
+TEST_F(StaticTest, AllocAlignedDoesNotOverflow) {
+    init_with_size(YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(alloc_static(&alloc, 1), nullptr);
+    EXPECT_EQ(alloc_static_aligned(&alloc, 1, (size_t)1 << 63), nullptr);
+    EXPECT_EQ(alloc_static_aligned(&alloc, SIZE_MAX, 1), nullptr);
+}
+
+TEST_F(StaticTest, ExtendLastAllocation) {
+    init_with_size(4 * YTALLOC_STATIC_ALIGN);
+
+    void *const ptr1 = alloc_static(&alloc, 8);
+    void *const ptr2 = alloc_static(&alloc, 8);
+    ASSERT_NE(ptr2, nullptr);
+
+    EXPECT_FALSE(alloc_static_extend(&alloc, ptr1, 16));
+    EXPECT_FALSE(alloc_static_extend(&alloc, nullptr, 16));
+
+    const uintptr_t ptr2_off =
+        reinterpret_cast<uintptr_t>(ptr2) - alloc.start;
+    const size_t max_size = 4 * YTALLOC_STATIC_ALIGN - ptr2_off;
+    ASSERT_TRUE(alloc_static_extend(&alloc, ptr2, max_size));
+    EXPECT_FALSE(alloc_static_extend(&alloc, ptr2, max_size + 1));
+    EXPECT_EQ(alloc_static(&alloc, 1), nullptr);
+
+    random_write(ptr2, max_size);
+    check_writes();
+
+    // Shrinking gives the space back.
+    ASSERT_TRUE(alloc_static_extend(&alloc, ptr2, 8));
+    EXPECT_NE(alloc_static(&alloc, 1), nullptr);
+}
+
+TEST_F(StaticTest, RewindToMark) {
+    init_with_size(8 * YTALLOC_STATIC_ALIGN);
+
+    void *const ptr1 = alloc_static(&alloc, YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(ptr1, nullptr);
+    random_write(ptr1, YTALLOC_STATIC_ALIGN);
+
+    const alloc_static_mark_t mark = alloc_static_mark(&alloc);
+    void *const ptr2 = alloc_static(&alloc, 2 * YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(ptr2, nullptr);
+    alloc_static_rewind(&alloc, mark);
+
+    void *const ptr3 = alloc_static(&alloc, 2 * YTALLOC_STATIC_ALIGN);
+    EXPECT_EQ(ptr3, ptr2);
+    check_writes();
+}
+
+TEST_F(StaticTest, NestedMarks) {
+    init_with_size(8 * YTALLOC_STATIC_ALIGN);
+
+    const alloc_static_mark_t outer = alloc_static_mark(&alloc);
+    void *const ptr1 = alloc_static(&alloc, YTALLOC_STATIC_ALIGN);
+    const alloc_static_mark_t inner = alloc_static_mark(&alloc);
+    void *const ptr2 = alloc_static(&alloc, YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(ptr2, nullptr);
+
+    alloc_static_rewind(&alloc, inner);
+    EXPECT_EQ(alloc_static(&alloc, YTALLOC_STATIC_ALIGN), ptr2);
+
+    alloc_static_rewind(&alloc, outer);
+    EXPECT_EQ(alloc_static(&alloc, YTALLOC_STATIC_ALIGN), ptr1);
+}
+
+TEST_F(StaticTest, RewindRestoresExtendableAllocation) {
+    init_with_size(8 * YTALLOC_STATIC_ALIGN);
+
+    void *const ptr1 = alloc_static(&alloc, 8);
+    const alloc_static_mark_t mark = alloc_static_mark(&alloc);
+    ASSERT_NE(alloc_static(&alloc, 8), nullptr);
+    EXPECT_FALSE(alloc_static_extend(&alloc, ptr1, 16));
+
+    alloc_static_rewind(&alloc, mark);
+    EXPECT_TRUE(alloc_static_extend(&alloc, ptr1, 16));
+}
+
+TEST_F(StaticTest, RewindForwardAborts) {
+    init_with_size(8 * YTALLOC_STATIC_ALIGN);
+
+    ASSERT_NE(alloc_static(&alloc, YTALLOC_STATIC_ALIGN), nullptr);
+    const alloc_static_mark_t mark = alloc_static_mark(&alloc);
+    alloc_static_reset(&alloc);
+    ASSERT_DEATH(alloc_static_rewind(&alloc, mark), "");
+}
+
+TEST_F(StaticTest, Reset) {
+    init_with_size(2 * YTALLOC_STATIC_ALIGN);
+
+    void *const ptr1 = alloc_static(&alloc, 2 * YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(ptr1, nullptr);
+    EXPECT_EQ(alloc_static(&alloc, 1), nullptr);
+
+    alloc_static_reset(&alloc);
+    EXPECT_EQ(alloc_static(&alloc, 2 * YTALLOC_STATIC_ALIGN), ptr1);
+}
+
+TEST_F(StaticTest, CallocClearsReusedMemory) {
+    init_with_size(4 * YTALLOC_STATIC_ALIGN);
+    std::memset(storage, 0xaa, size);
+
+    uint8_t *const ptr1 =
+        static_cast<uint8_t *>(alloc_static_calloc(&alloc, 3, 8));
+    ASSERT_NE(ptr1, nullptr);
+    for (size_t idx = 0; idx < 24; idx++) {
+        ASSERT_EQ(ptr1[idx], 0) << idx;
+    }
+
+    std::memset(ptr1, 0xbb, 24);
+    alloc_static_reset(&alloc);
+    uint8_t *const ptr2 =
+        static_cast<uint8_t *>(alloc_static_calloc(&alloc, 1, size));
+    ASSERT_EQ(ptr2, ptr1);
+    for (size_t idx = 0; idx < size; idx++) {
+        ASSERT_EQ(ptr2[idx], 0) << idx;
+    }
+}
+
+TEST_F(StaticTest, CallocSkipsKnownZeroMemory) {
+    init_with_size(4 * YTALLOC_STATIC_ALIGN);
+    std::memset(storage, 0, size);
+    alloc_static_set_zeroed(&alloc);
+
+    uint8_t *const ptr1 = static_cast<uint8_t *>(alloc_static(&alloc, 8));
+    std::memset(ptr1, 0xaa, 8);
+    alloc_static_reset(&alloc);
+
+    // Break the promise above the high-water mark to see what gets cleared.
+    std::memset(storage + YTALLOC_STATIC_ALIGN, 0xcc,
+                size - YTALLOC_STATIC_ALIGN);
+    uint8_t *const ptr2 =
+        static_cast<uint8_t *>(alloc_static_calloc(&alloc, 1, size));
+    ASSERT_EQ(ptr2, storage);
+    for (size_t idx = 0; idx < 8; idx++) {
+        EXPECT_EQ(ptr2[idx], 0) << idx;
+    }
+    EXPECT_EQ(ptr2[size - 1], 0xcc);
+}
+
+TEST_F(StaticTest, CallocOverflowFails) {
+    init_with_size(YTALLOC_STATIC_ALIGN);
+    EXPECT_EQ(alloc_static_calloc(&alloc, SIZE_MAX / 2, 3), nullptr);
+    EXPECT_NE(alloc_static(&alloc, 1), nullptr);
+}
+
+class StaticDoubleEndedTest : public StaticTest {
+  protected:
+    void init_with_size(size_t size) {
+        set_underlying_storage(size);
+        alloc_static_de_init(&de, storage, size);
+    }
+
+    alloc_static_de_t de;
+};
+
+TEST_F(StaticDoubleEndedTest, InitNullStartAborts) {
+    set_underlying_storage(32);
+    ASSERT_DEATH(alloc_static_de_init(&de, NULL, size), "");
+}
+
+TEST_F(StaticDoubleEndedTest, BothEndsShareTheBuffer) {
+    constexpr size_t heap_size = 8 * YTALLOC_STATIC_ALIGN;
+    init_with_size(heap_size);
+
+    void *const low = alloc_static_de(&de, ALLOC_STATIC_LOW, 1);
+    void *const high = alloc_static_de(&de, ALLOC_STATIC_HIGH, 1);
+    EXPECT_EQ(low, storage);
+    EXPECT_EQ(high, storage + heap_size - YTALLOC_STATIC_ALIGN);
+    EXPECT_EQ(alloc_static_de_num_free(&de),
+              heap_size - YTALLOC_STATIC_ALIGN - 1);
+
+    random_write(low, 1);
+    random_write(high, 1);
+    check_writes();
+}
+
+TEST_F(StaticDoubleEndedTest, FailsWhenEndsMeet) {
+    constexpr size_t heap_size = 4 * YTALLOC_STATIC_ALIGN;
+    init_with_size(heap_size);
+
+    void *const low =
+        alloc_static_de(&de, ALLOC_STATIC_LOW, 3 * YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(low, nullptr);
+    EXPECT_EQ(alloc_static_de(&de, ALLOC_STATIC_HIGH,
+                              YTALLOC_STATIC_ALIGN + 1),
+              nullptr);
+    void *const high =
+        alloc_static_de(&de, ALLOC_STATIC_HIGH, YTALLOC_STATIC_ALIGN);
+    ASSERT_NE(high, nullptr);
+    EXPECT_EQ(alloc_static_de_num_free(&de), 0);
+    EXPECT_EQ(alloc_static_de(&de, ALLOC_STATIC_LOW, 1), nullptr);
+    EXPECT_EQ(alloc_static_de(&de, ALLOC_STATIC_HIGH, 1), nullptr);
+
+    random_write(low, 3 * YTALLOC_STATIC_ALIGN);
+    random_write(high, YTALLOC_STATIC_ALIGN);
+    check_writes();
+}
+
+TEST_F(StaticDoubleEndedTest, AlignedHighAllocation) {
+    set_underlying_storage(4096);
+    alloc_static_de_init(&de, storage, size);
+
+    void *const ptr = alloc_static_de_aligned(&de, ALLOC_STATIC_HIGH, 10, 256);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 256, 0);
+    EXPECT_LE(reinterpret_cast<uintptr_t>(ptr) + 10,
+              reinterpret_cast<uintptr_t>(storage) + size);
+}
+
+TEST_F(StaticDoubleEndedTest, IndependentMarks) {
+    init_with_size(16 * YTALLOC_STATIC_ALIGN);
+
+    const alloc_static_de_mark_t low_mark =
+        alloc_static_de_mark(&de, ALLOC_STATIC_LOW);
+    const alloc_static_de_mark_t high_mark =
+        alloc_static_de_mark(&de, ALLOC_STATIC_HIGH);
+
+    void *const low1 = alloc_static_de(&de, ALLOC_STATIC_LOW, 8);
+    void *const high1 = alloc_static_de(&de, ALLOC_STATIC_HIGH, 8);
+    random_write(high1, 8);
+
+    alloc_static_de_rewind(&de, low_mark);
+    EXPECT_EQ(alloc_static_de(&de, ALLOC_STATIC_LOW, 8), low1);
+    check_writes();
+
+    void *const high2 = alloc_static_de(&de, ALLOC_STATIC_HIGH, 8);
+    EXPECT_LT(high2, high1);
+    alloc_static_de_rewind(&de, high_mark);
+    EXPECT_EQ(alloc_static_de(&de, ALLOC_STATIC_HIGH, 8), high1);
+
+    alloc_static_de_reset(&de);
+    EXPECT_EQ(alloc_static_de_num_free(&de), 16 * YTALLOC_STATIC_ALIGN);
+}
+
+TEST_F(StaticDoubleEndedTest, RewindForwardAborts) {
+    init_with_size(16 * YTALLOC_STATIC_ALIGN);
+
+    ASSERT_NE(alloc_static_de(&de, ALLOC_STATIC_HIGH, 8), nullptr);
+    const alloc_static_de_mark_t mark =
+        alloc_static_de_mark(&de, ALLOC_STATIC_HIGH);
+    alloc_static_de_reset(&de);
+    ASSERT_DEATH(alloc_static_de_rewind(&de, mark), "");
+}
+
+class StaticAtomicTest : public StaticTest {
+  protected:
+    void init_with_size(size_t size) {
+        set_underlying_storage(size);
+        alloc_static_atomic_init(&shared, storage, size);
+    }
+
+    alloc_static_atomic_t shared;
+};
+
+TEST_F(StaticAtomicTest, InitNullStartAborts) {
+    set_underlying_storage(32);
+    ASSERT_DEATH(alloc_static_atomic_init(&shared, NULL, size), "");
+}
+
+TEST_F(StaticAtomicTest, AllocUntilFull) {
+    init_with_size(4 * YTALLOC_STATIC_ALIGN);
+
+    for (size_t idx = 0; idx < 4; idx++) {
+        void *const ptr = alloc_static_atomic(&shared, 1);
+        EXPECT_EQ(ptr, storage + idx * YTALLOC_STATIC_ALIGN);
+    }
+    EXPECT_EQ(alloc_static_atomic(&shared, 1), nullptr);
+    EXPECT_EQ(alloc_static_atomic(&shared, 1), nullptr);
+    EXPECT_EQ(alloc_static_atomic_num_used(&shared), 4 * YTALLOC_STATIC_ALIGN);
+
+    alloc_static_atomic_reset(&shared);
+    EXPECT_EQ(alloc_static_atomic(&shared, 1), storage);
+}
+
+TEST_F(StaticAtomicTest, OverflowingAllocFails) {
+    init_with_size(4 * YTALLOC_STATIC_ALIGN);
+
+    ASSERT_NE(alloc_static_atomic(&shared, YTALLOC_STATIC_ALIGN), nullptr);
+    EXPECT_EQ(alloc_static_atomic(&shared, 4 * YTALLOC_STATIC_ALIGN), nullptr);
+    EXPECT_EQ(alloc_static_atomic(&shared, SIZE_MAX), nullptr);
+    EXPECT_EQ(alloc_static_atomic(&shared, 0), nullptr);
+}
+
+TEST_F(StaticAtomicTest, AlignedAlloc) {
+    set_underlying_storage(4096);
+    alloc_static_atomic_init(&shared, storage, size);
+
+    ASSERT_NE(alloc_static_atomic(&shared, 1), nullptr);
+    void *const ptr = alloc_static_atomic_aligned(&shared, 100, 1024);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 1024, 0);
+    EXPECT_EQ(alloc_static_atomic_aligned(&shared, 4096, 1024), nullptr);
+}
+
+TEST_F(StaticAtomicTest, LocalLeases) {
+    constexpr size_t lease_size = 8 * YTALLOC_STATIC_ALIGN;
+    init_with_size(4 * lease_size);
+
+    alloc_static_t local = {};
+    void *const ptr1 =
+        alloc_static_atomic_local(&shared, &local, 1, lease_size);
+    ASSERT_EQ(ptr1, storage);
+    EXPECT_EQ(alloc_static_atomic_num_used(&shared), lease_size);
+
+    for (size_t idx = 1; idx < 8; idx++) {
+        ASSERT_NE(alloc_static_atomic_local(&shared, &local, 1, lease_size),
+                  nullptr);
+    }
+    EXPECT_EQ(alloc_static_atomic_num_used(&shared), lease_size);
+
+    // The next allocation takes a new lease.
+    void *const ptr2 =
+        alloc_static_atomic_local(&shared, &local, 1, lease_size);
+    EXPECT_EQ(ptr2, storage + lease_size);
+
+    // Big allocations bypass the lease.
+    void *const big =
+        alloc_static_atomic_local(&shared, &local, lease_size, lease_size);
+    EXPECT_EQ(big, storage + 2 * lease_size);
+    EXPECT_EQ(alloc_static_atomic_local(&shared, &local, 1, lease_size),
+              storage + lease_size + YTALLOC_STATIC_ALIGN);
+}
+
+TEST_F(StaticAtomicTest, ConcurrentAllocsDoNotOverlap) {
+    constexpr size_t num_threads = 4;
+    constexpr size_t num_allocs = 1000;
+    constexpr size_t alloc_size = 24;
+    init_with_size(num_threads * num_allocs * YTALLOC_STATIC_ALIGN / 2);
+
+    std::vector<std::vector<uint8_t *>> ptrs(num_threads);
+    std::vector<std::thread> threads;
+    for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+        threads.emplace_back([&, thread_idx] {
+            for (size_t idx = 0; idx < num_allocs; idx++) {
+                void *const ptr = alloc_static_atomic(&shared, alloc_size);
+                if (!ptr) { break; }
+                memset(ptr, (int)thread_idx, alloc_size);
+                ptrs[thread_idx].push_back(static_cast<uint8_t *>(ptr));
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    size_t num_ptrs = 0;
+    for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+        for (uint8_t *ptr : ptrs[thread_idx]) {
+            for (size_t byte = 0; byte < alloc_size; byte++) {
+                ASSERT_EQ(ptr[byte], thread_idx);
+            }
+            num_ptrs++;
+        }
+    }
+    EXPECT_EQ(num_ptrs, num_threads * num_allocs / 2);
+}
@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ytalloc/ytalloc.h>
+
+class StatsTest : public testing::Test {
+  protected:
+    void SetUp() override {
+        storage = new (std::align_val_t(storage_size)) uint8_t[storage_size];
+        alloc_stats_reset();
+    }
+
+    void TearDown() override {
+        operator delete[](storage, std::align_val_t(storage_size));
+    }
+
+    void init_buddy() {
+        alloc_buddy_init(&buddy, storage, storage_size, free_heads,
+                         sizeof(free_heads), bitmap, sizeof(bitmap));
+    }
+
+    std::string dump(alloc_stats_format_t format) {
+        const size_t len = alloc_stats_dump(format, nullptr, 0);
+        std::string str(len, '\0');
+        EXPECT_EQ(alloc_stats_dump(format, str.data(), len + 1), len);
+        return str;
+    }
+
+    static uint64_t num_samples(const alloc_stats_t &stats,
+                                alloc_stats_op_t op) {
+        uint64_t sum = 0;
+        for (uint64_t cnt : stats.latency[op]) {
+            sum += cnt;
+        }
+        return sum;
+    }
+
+    static constexpr size_t storage_size = 64 * YTALLOC_BUDDY_MIN_BLOCK_SIZE;
+    static constexpr size_t item_size = 64;
+
+    uint8_t *storage;
+    alloc_buddy_t buddy;
+    uintptr_t free_heads[YTALLOC_BUDDY_MAX_ORDERS];
+    uint8_t bitmap[storage_size / YTALLOC_BUDDY_MIN_BLOCK_SIZE / 8];
+    alloc_slab_t slab;
+};
+
+TEST_F(StatsTest, DisabledBuildHasNoStats) {
+    if (alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    alloc_slab_free(&slab, alloc_slab(&slab));
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_SLAB, &stats);
+    EXPECT_EQ(stats.num_allocs, 0);
+    EXPECT_EQ(dump(ALLOC_STATS_TEXT), "");
+    EXPECT_EQ(dump(ALLOC_STATS_JSON), "{}");
+}
+
+TEST_F(StatsTest, CountsSlabOperations) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, 16 * item_size, item_size);
+    std::vector<void *> ptrs(20);
+    EXPECT_EQ(alloc_slab_bulk(&slab, ptrs.data(), 10), 10);
+    for (size_t idx = 10; idx < ptrs.size(); idx++) {
+        ptrs[idx] = alloc_slab(&slab);
+    }
+    alloc_slab_free_bulk(&slab, ptrs.data(), 10);
+    alloc_slab_free(&slab, ptrs[10]);
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_SLAB, &stats);
+    EXPECT_EQ(stats.num_allocs, 16);
+    EXPECT_EQ(stats.num_failed, 4);
+    EXPECT_EQ(stats.num_frees, 11);
+    EXPECT_EQ(stats.bytes_requested, 16 * item_size);
+    EXPECT_EQ(stats.bytes_granted, 16 * item_size);
+    EXPECT_EQ(stats.bytes_freed, 11 * item_size);
+    EXPECT_EQ(stats.peak_bytes, 16 * item_size);
+
+    alloc_stats_get(ALLOC_KIND_BUDDY, &stats);
+    EXPECT_EQ(stats.num_allocs, 0);
+}
+
+TEST_F(StatsTest, RequestedAndGrantedBytes) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    init_buddy();
+    void *const ptr = alloc_buddy(&buddy, 5000);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(alloc_buddy(&buddy, 2 * storage_size), nullptr);
+    alloc_buddy_free(&buddy, ptr, 5000);
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_BUDDY, &stats);
+    EXPECT_EQ(stats.num_allocs, 1);
+    EXPECT_EQ(stats.num_failed, 1);
+    EXPECT_EQ(stats.bytes_requested, 5000);
+    EXPECT_EQ(stats.bytes_granted, 8192);
+    EXPECT_EQ(stats.bytes_freed, 8192);
+}
+
+TEST_F(StatsTest, PeakBytes) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    init_buddy();
+    constexpr size_t block_size = 64 * 1024;
+    void *ptrs[4];
+    for (void *&ptr : ptrs) {
+        ptr = alloc_buddy(&buddy, block_size);
+        ASSERT_NE(ptr, nullptr);
+    }
+    for (void *ptr : ptrs) {
+        alloc_buddy_free(&buddy, ptr, block_size);
+    }
+    alloc_buddy_free(&buddy, alloc_buddy(&buddy, block_size), block_size);
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_BUDDY, &stats);
+    EXPECT_EQ(stats.peak_bytes, 4 * block_size);
+}
+
+TEST_F(StatsTest, SamplesLatency) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    constexpr size_t num_ops = 100 << YTALLOC_STATS_SAMPLE_SHIFT;
+    for (size_t idx = 0; idx < num_ops; idx++) {
+        alloc_slab_free(&slab, alloc_slab(&slab));
+    }
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_SLAB, &stats);
+    const uint64_t num_sampled = num_samples(stats, ALLOC_STATS_OP_ALLOC) +
+                                 num_samples(stats, ALLOC_STATS_OP_FREE);
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    EXPECT_GE(num_sampled, 2 * num_ops / (1 << YTALLOC_STATS_SAMPLE_SHIFT) - 1);
+#endif
+    EXPECT_LE(num_sampled, 2 * num_ops / (1 << YTALLOC_STATS_SAMPLE_SHIFT) + 1);
+}
+
+TEST_F(StatsTest, CountsEveryThread) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    constexpr size_t num_threads = 4;
+    constexpr size_t num_allocs = 1000;
+    std::vector<std::thread> threads;
+    for (size_t thr = 0; thr < num_threads; thr++) {
+        threads.emplace_back([this, thr] {
+            alloc_slab_t heap;
+            uint8_t *const start = storage + thr * (storage_size / num_threads);
+            alloc_slab_init(&heap, start, storage_size / num_threads,
+                            item_size);
+            for (size_t idx = 0; idx < num_allocs; idx++) {
+                alloc_slab_free(&heap, alloc_slab(&heap));
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_SLAB, &stats);
+    EXPECT_EQ(stats.num_allocs, num_threads * num_allocs);
+    EXPECT_EQ(stats.num_frees, num_threads * num_allocs);
+}
+
+TEST_F(StatsTest, ResetZeroesStats) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    alloc_slab_free(&slab, alloc_slab(&slab));
+    alloc_stats_reset();
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_SLAB, &stats);
+    EXPECT_EQ(stats.num_allocs, 0);
+    EXPECT_EQ(stats.num_frees, 0);
+    EXPECT_EQ(stats.peak_bytes, 0);
+    EXPECT_EQ(dump(ALLOC_STATS_TEXT), "");
+}
+
+TEST_F(StatsTest, DumpText) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    void *const ptr = alloc_slab(&slab);
+    alloc_slab_free(&slab, alloc_slab(&slab));
+    alloc_slab_free(&slab, ptr);
+
+    const std::string text = dump(ALLOC_STATS_TEXT);
+    EXPECT_EQ(text.rfind("slab: allocs=2 frees=2 failed=0 bytes_requested=128 "
+                         "bytes_granted=128 bytes_freed=128 peak_bytes=128\n",
+                         0),
+              0)
+        << text;
+    EXPECT_EQ(text.back(), '\n');
+}
+
+TEST_F(StatsTest, DumpJson) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    init_buddy();
+    alloc_buddy_free(&buddy, alloc_buddy(&buddy, 100), 100);
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    alloc_slab_free(&slab, alloc_slab(&slab));
+
+    const std::string json = dump(ALLOC_STATS_JSON);
+    EXPECT_EQ(json.rfind("{\"buddy\":{\"allocs\":1,\"frees\":1,", 0), 0)
+        << json;
+    EXPECT_NE(json.find("},\"slab\":{\"allocs\":1,"), std::string::npos)
+        << json;
+    EXPECT_NE(json.find("\"alloc_latency\":["), std::string::npos);
+    EXPECT_NE(json.find("\"free_latency\":["), std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 3), "]}}");
+}
+
+TEST_F(StatsTest, DumpTruncates) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    alloc_slab_free(&slab, alloc_slab(&slab));
+
+    const std::string full = dump(ALLOC_STATS_JSON);
+    char buf[9];
+    EXPECT_EQ(alloc_stats_dump(ALLOC_STATS_JSON, buf, sizeof(buf)),
+              full.size());
+    EXPECT_EQ(std::string(buf), full.substr(0, sizeof(buf) - 1));
+}
+
+TEST_F(StatsTest, RewindAndResetCountAsFrees) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_static_t heap;
+    alloc_static_init(&heap, storage, storage_size);
+    ASSERT_NE(alloc_static(&heap, 64), nullptr);
+    const alloc_static_mark_t mark = alloc_static_mark(&heap);
+    ASSERT_NE(alloc_static(&heap, 64), nullptr);
+    ASSERT_NE(alloc_static(&heap, 64), nullptr);
+    alloc_static_rewind(&heap, mark);
+    alloc_static_rewind(&heap, mark);
+    ASSERT_NE(alloc_static(&heap, 64), nullptr);
+    alloc_static_reset(&heap);
+    ASSERT_NE(alloc_static(&heap, 64), nullptr);
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_STATIC, &stats);
+    EXPECT_EQ(stats.num_allocs, 5);
+    EXPECT_EQ(stats.num_frees, 2);
+    EXPECT_EQ(stats.bytes_freed, 2 * 128);
+    EXPECT_EQ(stats.peak_bytes, 3 * 64);
+}
+
+TEST_F(StatsTest, ExtendCountsTheDifference) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_static_t heap;
+    alloc_static_init(&heap, storage, storage_size);
+    void *const ptr = alloc_static(&heap, 64);
+    ASSERT_TRUE(alloc_static_extend(&heap, ptr, 256));
+    ASSERT_TRUE(alloc_static_extend(&heap, ptr, 32));
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_STATIC, &stats);
+    EXPECT_EQ(stats.bytes_granted, 256);
+    EXPECT_EQ(stats.bytes_freed, 256 - 32);
+    EXPECT_EQ(stats.peak_bytes, 256);
+}
+
+TEST_F(StatsTest, OpsResetCountsLiveBytesAsFreed) {
+    if (!alloc_stats_enabled()) { GTEST_SKIP(); }
+
+    alloc_slab_init(&slab, storage, storage_size, item_size);
+    for (int idx = 0; idx < 3; idx++) {
+        ASSERT_NE(alloc_slab_ops.alloc(&slab, item_size), nullptr);
+    }
+    alloc_slab_ops.reset(&slab);
+    ASSERT_NE(alloc_slab_ops.alloc(&slab, item_size), nullptr);
+
+    alloc_stats_t stats;
+    alloc_stats_get(ALLOC_KIND_SLAB, &stats);
+    EXPECT_EQ(stats.bytes_freed, 3 * item_size);
+    EXPECT_EQ(stats.peak_bytes, 3 * item_size);
+}